@@ -3,17 +3,35 @@
 #include <chrono>
 
 #ifndef _WIN32
+#include <cerrno>
 #include <ratio>
 #include <utility>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #endif
 
 #include <common/utils.h>
+#include "beat.h"
 #include "encoding.h"
 #include "log.h"
 
-#ifndef NDEBUG
 #include "common/sysutil.h"
-#endif
+
+static std::mutex gRunningLoopersMutex;
+static std::vector<AsyncLooper*> gRunningLoopers;
+
+static void addRunningLooper(AsyncLooper* l)
+{
+    std::unique_lock lock(gRunningLoopersMutex);
+    gRunningLoopers.push_back(l);
+}
+
+static void removeRunningLooper(AsyncLooper* l)
+{
+    std::unique_lock lock(gRunningLoopersMutex);
+    gRunningLoopers.erase(std::remove(gRunningLoopers.begin(), gRunningLoopers.end(), l), gRunningLoopers.end());
+}
 
 AsyncLooper::AsyncLooper(StringContentView tag, std::function<void()> func, unsigned rate_per_sec, bool single_inst) : 
     _tag(tag), _loopFunc(std::move(func))
@@ -62,6 +80,7 @@ void AsyncLooper::run()
     if (_running && !_inLoopBody)
     {
         _inLoopBody = true;
+        lunaticvibes::Time::beginFrame();
         _loopFunc();
         _inLoopBody = false;
     }
@@ -72,6 +91,57 @@ unsigned AsyncLooper::getRate()
     return _rate;
 }
 
+AsyncLooper::ThreadPolicy AsyncLooper::ThreadPolicy::parse(std::string_view cpus, std::string_view scheduler, int priority)
+{
+    ThreadPolicy p;
+
+    while (!cpus.empty())
+    {
+        auto token = cpus.substr(0, cpus.find(','));
+        cpus.remove_prefix(std::min(cpus.size(), token.size() + 1));
+
+        token = lunaticvibes::trim(token);
+        auto dash = token.find('-');
+        int first = toInt(lunaticvibes::trim(token.substr(0, dash)), -1);
+        int last = dash == token.npos ? first : toInt(lunaticvibes::trim(token.substr(dash + 1)), -1);
+        if (first < 0 || last < first || last >= 1024) continue;
+        for (int c = first; c <= last; ++c)
+            p.cpus.push_back((unsigned)c);
+    }
+
+    if (lunaticvibes::iequals(scheduler, "FIFO"))
+        p.scheduler = Scheduler::FIFO;
+    else if (lunaticvibes::iequals(scheduler, "RR"))
+        p.scheduler = Scheduler::RR;
+
+    p.priority = priority;
+    return p;
+}
+
+long long AsyncLooper::nextDeadline(long long deadline, long long period, long long now)
+{
+    deadline += period;
+    if (period > 0 && now - deadline >= period)
+        deadline += ((now - deadline) / period + 1) * period;
+    return deadline;
+}
+
+AsyncLooper::LoopStats AsyncLooper::getStats() const
+{
+    std::unique_lock lock(_statsMutex);
+    return _stats;
+}
+
+std::vector<std::pair<StringContent, AsyncLooper::LoopStats>> AsyncLooper::getAllStats()
+{
+    std::unique_lock lock(gRunningLoopersMutex);
+    std::vector<std::pair<StringContent, LoopStats>> ret;
+    ret.reserve(gRunningLoopers.size());
+    for (auto l : gRunningLoopers)
+        ret.emplace_back(l->_tag, l->getStats());
+    return ret;
+}
+
 #ifdef _WIN32
 
 void AsyncLooper::loopStart()
@@ -176,14 +246,112 @@ void AsyncLooper::loopEnd()
 }
 
 #else // FALLBACK
-void AsyncLooper::_loopWithSleep()
+
+static long long monotonicNs()
 {
-    const auto sleep_duration = std::chrono::nanoseconds(std::nano::den / _rate).count();
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * std::nano::den + ts.tv_nsec;
+}
+
+// Returns true if the thread now runs with a real-time scheduler.
+static bool applyThreadPolicy(const StringContent& tag, const AsyncLooper::ThreadPolicy& policy)
+{
+    if (!policy.cpus.empty())
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (unsigned c : policy.cpus)
+            if (c < CPU_SETSIZE)
+                CPU_SET(c, &set);
+        if (int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); ret != 0)
+        {
+            LOG_WARNING << "[Looper] " << tag << ": Set CPU affinity failed: " << safe_strerror(ret);
+        }
+    }
+
+    if (policy.scheduler != AsyncLooper::ThreadPolicy::Scheduler::NORMAL)
+    {
+        int sched = policy.scheduler == AsyncLooper::ThreadPolicy::Scheduler::FIFO ? SCHED_FIFO : SCHED_RR;
+        sched_param param{};
+        param.sched_priority = std::clamp(policy.priority, sched_get_priority_min(sched), sched_get_priority_max(sched));
+        if (int ret = pthread_setschedparam(pthread_self(), sched, &param); ret != 0)
+        {
+            // usually EPERM without CAP_SYS_NICE or an RLIMIT_RTPRIO limit
+            LOG_WARNING << "[Looper] " << tag << ": Real-time scheduling not available, using normal priority: " << safe_strerror(ret);
+        }
+        else
+        {
+            LOG_INFO << "[Looper] " << tag << ": Real-time scheduling, priority " << param.sched_priority;
+            return true;
+        }
+    }
+    return false;
+}
+
+static constexpr long REALTIME_MIN_SLEEP_NS = 50'000;
+
+// Each tick is scheduled at an absolute deadline (start + n * period) on CLOCK_MONOTONIC, the clock behind
+// lunaticvibes::Time, so time spent in the body does not push the schedule back.
+// A late tick runs immediately, or after REALTIME_MIN_SLEEP_NS with a real-time scheduler; if the loop falls a
+// whole period behind, the missed ticks are dropped instead of being run back to back.
+void AsyncLooper::_loopWithDeadlines()
+{
+    SetThreadName(_tag.c_str());
+    const bool realtime = applyThreadPolicy(_tag, _threadPolicy);
+
+    const long long period = _rate > 0 ? std::nano::den / _rate : 0;
+    long long deadline = monotonicNs();
+
+    LoopStats window;
+    long long windowStart = deadline;
+    long long lateSum = 0;
 
     while (_running)
     {
         run();
-        preciseSleep(sleep_duration);
+
+        long long now = monotonicNs();
+        if (period > 0 && now >= deadline + period)
+            window.overruns++;
+        deadline = nextDeadline(deadline, period, now);
+        if (now < deadline)
+        {
+            timespec ts;
+            ts.tv_sec = deadline / std::nano::den;
+            ts.tv_nsec = deadline % std::nano::den;
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+            now = monotonicNs();
+        }
+        else if (realtime)
+        {
+            // A real-time thread that never sleeps starves every normal thread on its CPU, and sched_yield() only
+            // gives way to threads of the same priority; sleep briefly even when behind
+            timespec ts{ 0, REALTIME_MIN_SLEEP_NS };
+            clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+            now = monotonicNs();
+        }
+
+        // without a rate there is no deadline to be late for
+        if (period > 0)
+        {
+            long long late = now - deadline;
+            lateSum += late;
+            window.lateMaxNs = std::max(window.lateMaxNs, late);
+        }
+        window.ticks++;
+
+        if (now - windowStart >= std::nano::den)
+        {
+            window.lateAvgNs = lateSum / window.ticks;
+            {
+                std::unique_lock lock(_statsMutex);
+                _stats = window;
+            }
+            window = {};
+            windowStart = now;
+            lateSum = 0;
+        }
     }
 }
 
@@ -191,13 +359,17 @@ void AsyncLooper::loopStart()
 {
     if (_running) return;
     _running = true;
-    handler = std::thread(&AsyncLooper::_loopWithSleep, this);
+    handler = std::thread(&AsyncLooper::_loopWithDeadlines, this);
+    addRunningLooper(this);
 }
 
 void AsyncLooper::loopEnd()
 {
     if (!_running) return;
+    removeRunningLooper(this);
     _running = false;
     handler.join();
+    std::unique_lock lock(_statsMutex);
+    _stats = {};
 }
 #endif
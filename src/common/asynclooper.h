@@ -3,6 +3,10 @@
 #include <functional>
 #include <shared_mutex>
 #include <map>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include "types.h"
 
 #ifdef _WIN32
@@ -41,9 +45,46 @@ protected:
     std::future<void> loopFuture;
     long long tStart = 0;
 #else
-    void _loopWithSleep();
+    void _loopWithDeadlines();
 #endif
 
+public:
+    // Loop timing over the last second. Only measured by the Linux loop.
+    struct LoopStats
+    {
+        unsigned ticks = 0;         // loop bodies run
+        unsigned overruns = 0;      // deadlines already passed when the body returned
+        long long lateAvgNs = 0;    // wake-up delay after the deadline
+        long long lateMaxNs = 0;
+    };
+
+protected:
+    mutable std::mutex _statsMutex;
+    LoopStats _stats;
+
+public:
+    // Scheduling of the loop thread, applied when the loop starts. Only applied by the Linux loop.
+    struct ThreadPolicy
+    {
+        enum class Scheduler
+        {
+            NORMAL,
+            FIFO,
+            RR,
+        };
+
+        std::vector<unsigned> cpus;     // empty: any CPU
+        Scheduler scheduler = Scheduler::NORMAL;
+        int priority = 0;               // FIFO / RR only
+
+        // cpus: list of CPUs and ranges, e.g. "2,3" or "4-7"; scheduler: "Normal", "FIFO" or "RR".
+        // Invalid parts are ignored.
+        static ThreadPolicy parse(std::string_view cpus, std::string_view scheduler, int priority);
+    };
+
+protected:
+    ThreadPolicy _threadPolicy;
+
 public:
     AsyncLooper() = delete;
     AsyncLooper(StringContentView tag, std::function<void()>, unsigned rate_per_sec, bool single_inst = false);
@@ -53,6 +94,16 @@ public:
     void loopEnd();
     bool isRunning() const { return _running; }
     unsigned getRate();
+    void setThreadPolicy(const ThreadPolicy& policy) { _threadPolicy = policy; }
+    LoopStats getStats() const;
+
+    // Deadline of the tick after the one due at `deadline`, when that tick's body returned at `now`.
+    // After overrunning a whole period or more, the missed ticks are skipped and the next one is due at the first
+    // period boundary after `now`, instead of running the missed ones back to back.
+    static long long nextDeadline(long long deadline, long long period, long long now);
+
+    // Stats of all running loopers, with their tags
+    static std::vector<std::pair<StringContent, LoopStats>> getAllStats();
 
 private:
     std::function<void()> _loopFunc;
@@ -7,23 +7,61 @@
 typedef unsigned Bar;
 typedef double BPM;
 
-class Metre : public fraction
+// Position or length in measures, stored as fixed-point ticks. A 4/4 measure is RESOLUTION ticks; the resolution is
+// a common multiple of the usual BMS / bmson divisions (up to 2^8, 3^3, 5^3, 7, 11, 13, 17, 19), so note positions
+// are exact and compare as plain integers. Other divisions are rounded to the nearest tick.
+class Metre
 {
-protected:
-	operator double() const { return fraction::operator double(); }
-
 public:
-	Metre() : fraction() {}
-	Metre(long long division_level, long long multiple_level) : fraction(division_level, multiple_level, false) {}
-	Metre(double value) : fraction(static_cast<long long>(value * 1e12), 1e12, true) {}
-	~Metre() override {}
+	static constexpr long long RESOLUTION = 279'351'072'000ll;
+
+private:
+	long long _ticks = 0;
 
-	double toDouble() const { return operator double(); }
-	bool operator==(const Metre& rhs) const { return fraction(division_level(), multiple_level(), true) == fraction(rhs.division_level(), rhs.multiple_level(), true); }
+	// value * num / den rounded half away from zero, without overflowing on large values
+	static constexpr long long scale(long long value, long long num, long long den)
+	{
+		if (den == 0 || num == 0) return 0;
+		if (den < 0) { num = -num; den = -den; }
+		long long q = value / den;
+		long long r = value % den;
+		if (r == 0 || (r < 0 ? -r : r) <= (std::numeric_limits<long long>::max() - den / 2) / (num < 0 ? -num : num))
+		{
+			long long p = r * num;
+			return q * num + (p < 0 ? p - den / 2 : p + den / 2) / den;
+		}
+		long double x = static_cast<long double>(r) * num / den;
+		return q * num + static_cast<long long>(x < 0 ? x - 0.5 : x + 0.5);
+	}
 
-	long long division_level() const { return _numerator; }
-	long long multiple_level() const { return _denominator; }
+public:
+	constexpr Metre() = default;
+	constexpr Metre(long long numerator, long long denominator) : _ticks(scale(numerator, RESOLUTION, denominator)) {}
+	explicit constexpr Metre(double value) : _ticks(static_cast<long long>(value * RESOLUTION + (value < 0 ? -0.5 : 0.5))) {}
+
+	static constexpr Metre fromTicks(long long ticks) { Metre m; m._ticks = ticks; return m; }
+	// Far beyond any chart, with room left for adding offsets
+	static constexpr Metre infinite() { return fromTicks(std::numeric_limits<long long>::max() / 4); }
+
+	constexpr long long ticks() const { return _ticks; }
+	constexpr double toDouble() const { return static_cast<double>(_ticks) / RESOLUTION; }
+
+	constexpr Metre operator+ (const Metre& rhs) const { return fromTicks(_ticks + rhs._ticks); }
+	constexpr Metre operator- (const Metre& rhs) const { return fromTicks(_ticks - rhs._ticks); }
+	constexpr Metre operator- () const { return fromTicks(-_ticks); }
+	constexpr Metre& operator+= (const Metre& rhs) { _ticks += rhs._ticks; return *this; }
+	constexpr Metre& operator-= (const Metre& rhs) { _ticks -= rhs._ticks; return *this; }
+	// Scale by a segment of the bar, e.g. note position in a bar of this length
+	Metre operator* (const fraction& rhs) const { return fromTicks(scale(_ticks, rhs._numerator, rhs._denominator)); }
+
+	constexpr bool operator== (const Metre& rhs) const { return _ticks == rhs._ticks; }
+	constexpr bool operator!= (const Metre& rhs) const { return _ticks != rhs._ticks; }
+	constexpr bool operator< (const Metre& rhs) const { return _ticks < rhs._ticks; }
+	constexpr bool operator> (const Metre& rhs) const { return _ticks > rhs._ticks; }
+	constexpr bool operator<= (const Metre& rhs) const { return _ticks <= rhs._ticks; }
+	constexpr bool operator>= (const Metre& rhs) const { return _ticks >= rhs._ticks; }
 };
+inline Metre operator* (const fraction& lhs, const Metre& rhs) { return rhs * lhs; }
 
 typedef fraction Segment;  // Normal rhythm indicator, must be normalized (value: [0, 1)).
 
@@ -32,6 +70,10 @@ typedef std::chrono::nanoseconds  timeHighRes; // High resolution time, expect n
 
 namespace lunaticvibes {
 
+// Game timing clock. Monotonic, so NTP or manual clock changes never shift timers or judge timing.
+// Timestamps only make sense within this process; don't store them.
+using Clock = std::chrono::steady_clock;
+
 #pragma warning(push)
 #pragma warning(disable:4244)
 class Time
@@ -39,14 +81,24 @@ class Time
 private:
 	decltype(std::declval<timeNormRes>().count()) _regular;
 	decltype(std::declval<timeHighRes>().count()) _highres;
+
+	static thread_local Time _frameTime;
+
 public:
-	// TODO: have a separate helper that would construct with current time.
+	// Reads the clock. Per-frame code should use frame() instead.
 	Time()
 	{
-		auto now = std::chrono::system_clock::now().time_since_epoch();
+		auto now = Clock::now().time_since_epoch();
 		_regular = std::chrono::duration_cast<timeNormRes>(now).count();
 		_highres = std::chrono::duration_cast<timeHighRes>(now).count();
 	}
+
+	// Snapshot of the clock taken at the start of the current loop iteration on this thread, so one frame sees
+	// one time. Reads the clock if no loop runs on this thread.
+	[[nodiscard]] static Time frame() { return _frameTime._highres != 0 ? _frameTime : Time(); }
+	// Takes the snapshot returned by frame(). Called once per iteration by AsyncLooper and the main loop.
+	static void beginFrame() { _frameTime = Time(); }
+
 	constexpr Time(long long n, bool init_with_high_resolution_timestamp = false) : _regular(), _highres()
 	{
 		if (init_with_high_resolution_timestamp || n > std::numeric_limits<long long>::max() / 1000000)
@@ -86,6 +138,8 @@ public:
 };
 #pragma warning(pop)
 
+inline thread_local Time Time::_frameTime{ 0 };
+
 } // namespace lunaticvibes
 
 struct Note
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace lunaticvibes {
+
+// Multi-producer multi-consumer FIFO with a fixed capacity.
+// push() blocks while the queue is full, which throttles fast producers down to the speed of the consumers.
+// After close(), push() fails and pop() drains the remaining items before failing.
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity) : _capacity(capacity > 0 ? capacity : 1) {}
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Returns false if the queue was closed.
+    bool push(T item)
+    {
+        std::unique_lock l(_mutex);
+        _notFull.wait(l, [&] { return _closed || _items.size() < _capacity; });
+        if (_closed)
+            return false;
+        _items.push_back(std::move(item));
+        l.unlock();
+        _notEmpty.notify_one();
+        return true;
+    }
+
+    // Returns false if the queue was closed and is empty.
+    bool pop(T& out)
+    {
+        std::unique_lock l(_mutex);
+        _notEmpty.wait(l, [&] { return _closed || !_items.empty(); });
+        if (_items.empty())
+            return false;
+        out = std::move(_items.front());
+        _items.pop_front();
+        l.unlock();
+        _notFull.notify_one();
+        return true;
+    }
+
+    // Non-blocking pop.
+    bool tryPop(T& out)
+    {
+        std::unique_lock l(_mutex);
+        if (_items.empty())
+            return false;
+        out = std::move(_items.front());
+        _items.pop_front();
+        l.unlock();
+        _notFull.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::unique_lock l(_mutex);
+            _closed = true;
+        }
+        _notFull.notify_all();
+        _notEmpty.notify_all();
+    }
+
+    // Drop everything still queued. Used when cancelling.
+    void clear()
+    {
+        {
+            std::unique_lock l(_mutex);
+            _items.clear();
+        }
+        _notFull.notify_all();
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        std::unique_lock l(_mutex);
+        return _items.size();
+    }
+
+private:
+    const size_t _capacity;
+    mutable std::mutex _mutex;
+    std::condition_variable _notFull;
+    std::condition_variable _notEmpty;
+    std::deque<T> _items;
+    bool _closed = false;
+};
+
+} // namespace lunaticvibes
@@ -1,5 +1,6 @@
 #include "chartformat.h"
 #include "chartformat_bms.h"
+#include "chartformat_bmson.h"
 #include <fstream>
 #include "common/log.h"
 
@@ -47,6 +48,38 @@ std::shared_ptr<ChartFormatBase> ChartFormatBase::createFromFile(const Path& pat
     case eChartFormat::BMS:
         return std::static_pointer_cast<ChartFormatBase>(std::make_shared<ChartFormatBMS>(filePath, randomSeed));
 
+    case eChartFormat::BMSON:
+        return std::static_pointer_cast<ChartFormatBase>(std::make_shared<ChartFormatBMSON>(filePath, randomSeed));
+
+    case eChartFormat::UNKNOWN:
+        LOG_WARNING << "[Chart] File type unknown: " << filePath;
+        return nullptr;
+
+    default:
+        LOG_WARNING << "[Chart] File type unsupported: " << filePath;
+        return nullptr;
+    }
+
+}
+
+std::shared_ptr<ChartFormatBase> ChartFormatBase::createMetadataFromFile(const Path& path, uint64_t randomSeed)
+{
+    Path filePath = fs::absolute(path);
+    std::ifstream fs(filePath.c_str());
+    if (fs.fail())
+    {
+        LOG_WARNING << "[Chart] File invalid: " << filePath;
+        return nullptr;
+    }
+
+    switch (analyzeChartType(path))
+    {
+    case eChartFormat::BMS:
+        return std::static_pointer_cast<ChartFormatBase>(ChartFormatBMS::createMetadataFromFile(filePath, randomSeed));
+
+    case eChartFormat::BMSON:
+        return std::static_pointer_cast<ChartFormatBase>(ChartFormatBMSON::createMetadataFromFile(filePath, randomSeed));
+
     case eChartFormat::UNKNOWN:
         LOG_WARNING << "[Chart] File type unknown: " << filePath;
         return nullptr;
@@ -55,7 +88,27 @@ std::shared_ptr<ChartFormatBase> ChartFormatBase::createFromFile(const Path& pat
         LOG_WARNING << "[Chart] File type unsupported: " << filePath;
         return nullptr;
     }
+}
 
+std::shared_ptr<ChartFormatBase> ChartFormatBase::createMetadataFromBuffer(const Path& path, std::string_view content, uint64_t randomSeed)
+{
+    Path filePath = fs::absolute(path);
+    switch (analyzeChartType(path))
+    {
+    case eChartFormat::BMS:
+        return std::static_pointer_cast<ChartFormatBase>(ChartFormatBMS::createMetadataFromBuffer(filePath, content, randomSeed));
+
+    case eChartFormat::BMSON:
+        return std::static_pointer_cast<ChartFormatBase>(ChartFormatBMSON::createMetadataFromBuffer(filePath, content, randomSeed));
+
+    case eChartFormat::UNKNOWN:
+        LOG_WARNING << "[Chart] File type unknown: " << filePath;
+        return nullptr;
+
+    default:
+        LOG_WARNING << "[Chart] File type unsupported: " << filePath;
+        return nullptr;
+    }
 }
 
 Path ChartFormatBase::getDirectory() const
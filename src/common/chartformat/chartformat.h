@@ -11,7 +11,7 @@
 #include "common/types.h"
 
 // Subset of chart formats.
-// Currently including BMS
+// Currently including BMS and BMSON
 
 enum class eChartFormat
 {
@@ -24,6 +24,8 @@ eChartFormat analyzeChartType(const Path& p);
 
 class ChartFormatBase: public std::enable_shared_from_this<ChartFormatBase>
 {
+    friend class ChartFormatCache;
+
 protected:
     eChartFormat _type = eChartFormat::UNKNOWN;
 public:
@@ -33,6 +35,10 @@ public:
     ChartFormatBase() = default;
     virtual ~ChartFormatBase() = default;
     static std::shared_ptr<ChartFormatBase> createFromFile(const Path& path, uint64_t randomSeed);
+    // Header info and statistics only (including totalLength / totalNotes), for indexing. Not playable.
+    static std::shared_ptr<ChartFormatBase> createMetadataFromFile(const Path& path, uint64_t randomSeed);
+    // Same as above, parsing the whole file content read by the caller, so the file is not read again.
+    static std::shared_ptr<ChartFormatBase> createMetadataFromBuffer(const Path& path, std::string_view content, uint64_t randomSeed);
 
 protected:
     bool loaded = false;
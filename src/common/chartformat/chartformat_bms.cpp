@@ -1,15 +1,19 @@
 #include "chartformat_bms.h"
 #include "common/log.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <set>
 #include <utility>
 #include <exception>
 #include <filesystem>
+#include <iterator>
 #include <numeric>
 #include <random>
 
 #include "common/encoding.h"
+#include "common/sysutil.h"
 #include "common/utils.h"
 #include "db/db_song.h"
 #include "re2/re2.h"
@@ -17,6 +21,88 @@
 
 class noteLineException : public std::exception {};
 
+// #xxxyy:..., same as regex #[\d]{3}[0-9A-Za-z]{2}:.*
+static bool isNoteLine(StringContentView buf)
+{
+    auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+    auto isAlnum = [&](char c) { return isDigit(c) || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'); };
+    return buf.length() >= 7 && buf[0] == '#' &&
+        isDigit(buf[1]) && isDigit(buf[2]) && isDigit(buf[3]) &&
+        isAlnum(buf[4]) && isAlnum(buf[5]) && buf[6] == ':';
+}
+
+// Index of keys like WAVxx, same as regex (?i)WAV[0-9A-Za-z]{1,2}. Returns -1 if the key does not match.
+static int getIndexedKey(StringContentView key, StringContentView prefix)
+{
+    if (key.length() <= prefix.length() || key.length() > prefix.length() + 2)
+        return -1;
+    if (!lunaticvibes::iequals(key.substr(0, prefix.length()), prefix))
+        return -1;
+    auto idx = key.substr(prefix.length());
+    for (auto c : idx)
+    {
+        if (!((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')))
+            return -1;
+    }
+    return idx.length() == 2 ? base36(idx[0], idx[1]) : base36(idx[0]);
+}
+
+// Channel objects collected while parsing, grouped into lanes afterwards
+struct ParsedObject
+{
+    LaneCode code;          // notes of both sides use NOTE1 / NOTEINV1 / NOTELN1 / NOTEMINE1
+    unsigned lane;          // note lane index 0-19, or BGM layer
+    unsigned bar;
+    unsigned segment;
+    unsigned resolution;
+    unsigned value;
+    unsigned flags;
+
+    bool before(const ParsedObject& rhs) const
+    {
+        return (unsigned long long)segment * rhs.resolution < (unsigned long long)rhs.segment * resolution;
+    }
+    bool sameLane(const ParsedObject& rhs) const
+    {
+        return code == rhs.code && lane == rhs.lane;
+    }
+};
+
+// lane, bar, then position. Objects at the same position keep the file order
+static bool laneOrder(const ParsedObject& lhs, const ParsedObject& rhs)
+{
+    if (lhs.code != rhs.code) return lhs.code < rhs.code;
+    if (lhs.lane != rhs.lane) return lhs.lane < rhs.lane;
+    if (lhs.bar != rhs.bar) return lhs.bar < rhs.bar;
+    return lhs.before(rhs);
+}
+
+// Decodes a channel line of base36 or base16 values. Returns the count of non-zero objects.
+template <typename F>
+static unsigned forEachSeqObject(StringContentView str, bool hex, F&& f)
+{
+    size_t length = 0;
+    for (auto c : str)
+    {
+        if (hex ? !((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f'))
+                : !((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')))
+            break;
+        length++;
+    }
+
+    unsigned resolution = static_cast<unsigned>(length / 2);
+    unsigned count = 0;
+    for (unsigned i = 0; i < resolution; i++)
+    {
+        unsigned value = hex ? base16(str[i * 2], str[i * 2 + 1]) : base36(str[i * 2], str[i * 2 + 1]);
+        if (value == 0) continue;
+
+        f(i, resolution, value);
+        count++;
+    }
+    return count;
+}
+
 bool ChartFormatBMS::getExtendedProperty(const std::string& key, void* ret)
 {
     if (lunaticvibes::iequals(key, "PLAYER"))
@@ -51,9 +137,28 @@ ChartFormatBMS::ChartFormatBMS(const Path& filePath, uint64_t randomSeed): Chart
     initWithFile(filePath, randomSeed);
 }
 
+std::shared_ptr<ChartFormatBMS> ChartFormatBMS::createMetadataFromFile(const Path& filePath, uint64_t randomSeed)
+{
+    auto p = std::make_shared<ChartFormatBMS>();
+    p->metadataOnly = true;
+    p->wavFiles = {};
+    p->bgaFiles = {};
+    p->initWithFile(filePath, randomSeed);
+    return p;
+}
+
+std::shared_ptr<ChartFormatBMS> ChartFormatBMS::createMetadataFromBuffer(const Path& filePath, std::string_view content, uint64_t randomSeed)
+{
+    auto p = std::make_shared<ChartFormatBMS>();
+    p->metadataOnly = true;
+    p->wavFiles = {};
+    p->bgaFiles = {};
+    p->initWithBuffer(filePath, content, randomSeed);
+    return p;
+}
+
 int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
 {
-    using err = ErrorCode;
     if (loaded)
     {
         //errorCode = err::ALREADY_INITIALIZED;
@@ -61,24 +166,32 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
         return 1;
     }
 
-    fileName = filePath.filename();
-    absolutePath = std::filesystem::absolute(filePath);
-    std::ifstream ifsFile(absolutePath.c_str());
-    if (ifsFile.fail())
+    // the file is read only once, for both parsing and hashing
+    lunaticvibes::MappedFile file;
+    if (!file.open(std::filesystem::absolute(filePath)))
     {
-        errorCode = err::FILE_ERROR;
+        fileName = filePath.filename();
+        absolutePath = std::filesystem::absolute(filePath);
+        errorCode = ErrorCode::FILE_ERROR;
         errorLine = 0;
         LOG_WARNING << "[BMS] " << absolutePath << " File ERROR";
         return 1;
     }
+    return initWithBuffer(filePath, std::string_view(file.data(), file.size()), randomSeed);
+}
+
+int ChartFormatBMS::initWithBuffer(const Path& filePath, std::string_view content, uint64_t randomSeed)
+{
+    using err = ErrorCode;
+    if (loaded)
+    {
+        return 1;
+    }
 
-    // copy the whole file into ram, once for all
-    std::stringstream bmsFile;
-    bmsFile << ifsFile.rdbuf();
-    bmsFile.sync();
-    ifsFile.close();
+    fileName = filePath.filename();
+    absolutePath = std::filesystem::absolute(filePath);
 
-    auto encoding = getFileEncoding(bmsFile);
+    auto encoding = getContentEncoding(content);
 
     LOG_DEBUG << "[BMS] File (" << getFileEncodingName(encoding) << "): " << absolutePath;
 
@@ -101,20 +214,33 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
     // implicit parameters
     bool hasDifficulty = false;
 
-    while (!bmsFile.eof())
-    {
-        StringContent lineBuf;
-        std::getline(bmsFile, lineBuf, '\n');
-        srcLine++;
-        if (lineBuf.length() <= 1) continue;
+    // Objects of all channels. In metadata mode only visible notes, LN channel notes merged by #LNOBJ,
+    // BPM changes and stops are kept; other channels are only counted.
+    std::vector<ParsedObject> objects;
+    objects.reserve(content.size() / 16);
+    std::array<unsigned long, 2> metaLNChannelNotes{}; // scratch, key
+    int metaLastObjectBar = -1;
 
-        lunaticvibes::trim_in_place(lineBuf);
+    // Lines are parsed in place. Keys and channel data are ASCII in every supported codepage,
+    // so only text values are converted, and only when they are not plain ASCII.
+    auto toText = [encoding](StringContentView value) -> StringContent
+    {
+        if (encoding == eFileEncoding::UTF8 || is_ascii(value))
+            return StringContent(value);
+        return to_utf8(StringContent(value), encoding);
+    };
 
-        // convert codepage
-        lineBuf = to_utf8(lineBuf, encoding);
+    // UTF-8 BOM
+    if (content.substr(0, 3) == "\xEF\xBB\xBF")
+        content.remove_prefix(3);
 
-        StringContentView buf(lineBuf);
-        if (buf[0] != '#') continue;
+    for (size_t lineBegin = 0; lineBegin < content.size();)
+    {
+        size_t lineEnd = std::min(content.size(), content.find('\n', lineBegin));
+        StringContentView buf = lunaticvibes::trim(content.substr(lineBegin, lineEnd - lineBegin));
+        lineBegin = lineEnd + 1;
+        srcLine++;
+        if (buf.length() <= 1 || buf[0] != '#') continue;
 
         // parsing
         try
@@ -250,8 +376,7 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
                 }
             }
 
-            static LazyRE2 regexNote{ R"(#[\d]{3}[0-9A-Za-z]{2}:.*)" };
-            if (!RE2::FullMatch(re2::StringPiece(buf.data(), buf.length()), *regexNote))
+            if (!isNoteLine(buf))
             {
                 auto spacePos = std::min(buf.length(), buf.find_first_of(' '));
                 if (spacePos <= 1) continue;
@@ -259,11 +384,6 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
                 StringContentView key = buf.substr(1, spacePos - 1);
                 StringContentView value = spacePos < buf.length() ? buf.substr(spacePos + 1) : "";
 
-                static LazyRE2 regexWav{ R"((?i)WAV[0-9A-Za-z]{1,2})" };
-                static LazyRE2 regexBga{ R"((?i)BMP[0-9A-Za-z]{1,2})" };
-                static LazyRE2 regexBpm{ R"((?i)BPM[0-9A-Za-z]{1,2})" };
-                static LazyRE2 regexStop{ R"((?i)STOP[0-9A-Za-z]{1,2})" };
-
                 if (key.empty()) continue;
                 if (value.empty()) continue;
 
@@ -289,19 +409,19 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
 
                 // strings
                 else if (lunaticvibes::iequals(key, "TITLE"))
-                    title.assign(value.begin(), value.end());
+                    title = toText(value);
                 else if (lunaticvibes::iequals(key, "SUBTITLE"))
-                    title2.assign(value.begin(), value.end());
+                    title2 = toText(value);
                 else if (lunaticvibes::iequals(key, "ARTIST"))
-                    artist.assign(value.begin(), value.end());
+                    artist = toText(value);
                 else if (lunaticvibes::iequals(key, "SUBARTIST"))
-                    artist2.assign(value.begin(), value.end());
+                    artist2 = toText(value);
                 else if (lunaticvibes::iequals(key, "GENRE"))
-                    genre.assign(value.begin(), value.end());
+                    genre = toText(value);
                 else if (lunaticvibes::iequals(key, "STAGEFILE"))
-                    stagefile.assign(value.begin(), value.end());
+                    stagefile = toText(value);
                 else if (lunaticvibes::iequals(key, "BANNER"))
-                    banner.assign(value.begin(), value.end());
+                    banner = toText(value);
                 else if (lunaticvibes::iequals(key, "LNOBJ") && value.length() >= 2)
                 {
                     if (!lnobjSet.empty())
@@ -313,37 +433,34 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
                 }
 
                 // #???xx
-                else if (RE2::FullMatch(re2::StringPiece(key.data(), key.length()), *regexWav))
+                else if (int wavIdx = getIndexedKey(key, "WAV"); wavIdx >= 0)
                 {
-                    int idx = base36(key[3], key[4]);
-                    wavFiles[idx].assign(value.begin(), value.end());
+                    if (!metadataOnly)
+                        wavFiles[wavIdx] = toText(value);
                     if (!ifStack.empty()) resourceStable = false;
                 }
-                else if (RE2::FullMatch(re2::StringPiece(key.data(), key.length()), *regexBga))
+                else if (int bmpIdx = getIndexedKey(key, "BMP"); bmpIdx >= 0)
                 {
-                    int idx = base36(key[3], key[4]);
-                    if (idx != 0)
+                    if (bmpIdx != 0 && !metadataOnly)
                     {
-                        bgaFiles[idx].assign(value.begin(), value.end());
+                        bgaFiles[bmpIdx] = toText(value);
                         if (!ifStack.empty()) resourceStable = false;
                     }
                 }
-                else if (RE2::FullMatch(re2::StringPiece(key.data(), key.length()), *regexBpm))
+                else if (int bpmIdx = getIndexedKey(key, "BPM"); bpmIdx >= 0)
                 {
-                    int idx = base36(key[3], key[4]);
-                    if (idx != 0)
-                        exBPM[idx] = toDouble(value);
+                    if (bpmIdx != 0)
+                        exBPM[bpmIdx] = toDouble(value);
                 }
-                else if (RE2::FullMatch(re2::StringPiece(key.data(), key.length()), *regexStop))
+                else if (int stopIdx = getIndexedKey(key, "STOP"); stopIdx >= 0)
                 {
-                    int idx = base36(key[4], key[5]);
-                    if (idx != 0)
-                        stop[idx] = toDouble(value);
+                    if (stopIdx != 0)
+                        stop[stopIdx] = toDouble(value);
                 }
 
                 // unknown
                 else
-                    extraCommands[std::string(key)] = StringContent(value.begin(), value.end());
+                    extraCommands[std::string(key)] = toText(value);
             }
             else // #zzzxy:......
             {
@@ -369,47 +486,76 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
                     int x_ = base36(key[3]);
                     int _y = base36(key[4]);
 
+                    auto collect = [&](LaneCode code, unsigned lane, bool hex, unsigned flags = 0)
+                    {
+                        return forEachSeqObject(value, hex, [&](unsigned segment, unsigned resolution, unsigned v)
+                            {
+                                objects.push_back({ code, lane, bar, segment, resolution, v, flags });
+                            });
+                    };
+                    auto metaCount = [&](bool hex = false)
+                    {
+                        unsigned count = forEachSeqObject(value, hex, [](unsigned, unsigned, unsigned) {});
+                        if (count > 0)
+                            metaLastObjectBar = std::max(metaLastObjectBar, static_cast<int>(bar));
+                        return count;
+                    };
+
                     if (x_ == 0) // 0x: basic info
                     {
                         switch (_y)
                         {
                         case 1:            // 01: BGM
-                            seqToLane36(chBGM[bgmLayersCount[bar]][bar], value);
+                            if (metadataOnly)
+                            {
+                                metaCount();
+                                break;
+                            }
+                            collect(LaneCode::BGM, bgmLayersCount[bar], false);
                             ++bgmLayersCount[bar];
                             break;
 
                         case 2:            // 02: Bar Length
-                            metres[bar] = toDouble(value);
+                            metres[bar] = Metre(toDouble(value));
                             haveMetricMod = true;
                             break;
 
                         case 3:            // 03: BPM change
-                            seqToLane16(chBPMChange[bar], value);
+                            collect(LaneCode::BPM, 0, true);
                             haveBPMChange = true;
                             break;
 
                         case 4:            // 04: BGA Base
-                            seqToLane36(chBGABase[bar], value);
+                            if (metadataOnly)
+                                metaCount();
+                            else
+                                collect(LaneCode::BGABASE, 0, false);
                             haveBGA = true;
                             break;
 
                         case 6:            // 06: BGA Poor
-                            seqToLane36(chBGAPoor[bar], value);
+                            if (metadataOnly)
+                                metaCount();
+                            else
+                                collect(LaneCode::BGAPOOR, 0, false);
                             haveBGA = true;
                             break;
 
                         case 7:            // 07: BGA Layer
-                            seqToLane36(chBGALayer[bar], value);
+                            if (metadataOnly)
+                                metaCount();
+                            else
+                                collect(LaneCode::BGALAYER, 0, false);
                             haveBGA = true;
                             break;
 
                         case 8:            // 08: ExBPM
-                            seqToLane36(chExBPMChange[bar], value);
+                            collect(LaneCode::EXBPM, 0, false);
                             haveBPMChange = true;
                             break;
 
                         case 9:            // 09: Stop
-                            seqToLane36(chStop[bar], value);
+                            collect(LaneCode::STOP, 0, false);
                             haveStop = true;
                             break;
                         }
@@ -430,13 +576,17 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
                             {
                             case 1:            // 1x: 1P visible
                             case 2:            // 2x: 2P visible
-                                seqToLane36(chNotesRegular[chIdx][bar], value);
+                                if (collect(LaneCode::NOTE1, chIdx, false) > 0)
+                                    metaLastObjectBar = std::max(metaLastObjectBar, static_cast<int>(bar));
                                 haveNote = true;
                                 if (side == 1) haveAny_2 = true;
                                 break;
                             case 3:            // 3x: 1P invisible
                             case 4:            // 4x: 2P invisible
-                                seqToLane36(chNotesInvisible[chIdx][bar], value);
+                                if (metadataOnly)
+                                    metaCount();
+                                else
+                                    collect(LaneCode::NOTEINV1, chIdx, false);
                                 haveInvisible = true;
                                 if (side == 1) haveAny_2 = true;
                                 break;
@@ -446,40 +596,26 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
                                 if (!lnobjSet.empty())
                                 {
                                     // Note: there is so many possibilities of conflicting LN definition. Add all LN channel notes as regular notes
-                                    channel noteLane;
-                                    seqToLane36(noteLane, value, channel::NoteParseValue::LN);
-                                    unsigned scale = chNotesRegular[chIdx][bar].relax(noteLane.resolution) / noteLane.resolution;
-                                    for (auto& note : noteLane.notes)
-                                    {
-                                        note.segment *= scale;
-                                        bool noteInserted = false;
-                                        channel& chTarget = chNotesRegular[chIdx][bar];
-                                        for (auto it = chTarget.notes.begin(); it != chTarget.notes.end(); ++it)
-                                        {
-                                            if (it->segment > note.segment || (it->segment == note.segment && it->value > note.value))
-                                            {
-                                                chTarget.notes.insert(it, note);
-                                                noteInserted = true;
-                                                break;
-                                            }
-                                        }
-                                        if (!noteInserted)
-                                        {
-                                            chTarget.notes.push_back(note);
-                                        }
-                                    }
+                                    if (collect(LaneCode::NOTE1, chIdx, false, channel::NoteParseValue::LN) > 0)
+                                        metaLastObjectBar = std::max(metaLastObjectBar, static_cast<int>(bar));
                                 }
                                 else
                                 {
                                     // #LNTYPE 1
-                                    seqToLane36(chNotesLN[chIdx][bar], value, channel::NoteParseValue::LN);
+                                    if (metadataOnly)
+                                        metaLNChannelNotes[idx == 0 ? 0 : 1] += metaCount();
+                                    else
+                                        collect(LaneCode::NOTELN1, chIdx, false, channel::NoteParseValue::LN);
                                     haveLN = true;
                                     if (side == 1) haveAny_2 = true;
                                 }
                                 break;
                             case 0xD:        // Dx: 1P mine
                             case 0xE:        // Ex: 2P mine
-                                seqToLane36(chMines[chIdx][bar], value);
+                                if (metadataOnly)
+                                    notes_mine += metaCount();
+                                else
+                                    notes_mine += collect(LaneCode::NOTEMINE1, chIdx, false);
                                 haveMine = true;
                                 break;
                             }
@@ -534,178 +670,66 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
 
     // implicit subtitle
     if (title2.empty())
-    {
-        static const LazyRE2 subTitleRegex[]
-        {
-            { R"((.+?) *(-.*?-))" },
-            { R"((.+?) *(〜.*?〜))" },
-            { R"((.+?) *(\(.*?\)))" },
-            { R"((.+?) *(\[.*?\]))" },
-            { R"((.+?) *(<.*?>))" },
-        };
-        for (auto& reg : subTitleRegex)
-        {
-            std::string title1, title2;
-            if (RE2::FullMatch(title, *reg, &title1, &title2))
-            {
-                this->title = title1;
-                this->title2 = title2;
-                break;
-            }
-        }
-    }
+        setImplicitSubtitle();
 
     // implicit difficulty
     if (!hasDifficulty)
-    {
-        static const LazyRE2 difficultyRegex[]
-        {
-            { "" },
-            { R"((?i)(easy|beginner|light))" },
-            { R"((?i)(normal|standard))" },
-            { R"((?i)(hard|hyper))" },
-            { R"((?i)(ex|another|insane|lunatic|maniac))" },
-        };
-        difficulty = 2; // defaults to normal
-        for (int i = 4; i >= 1; --i)
-        {
-            if (RE2::PartialMatch(version, *difficultyRegex[i]))
-            {
-                difficulty = i;
-                break;
-            }
-            if (RE2::PartialMatch(title2, *difficultyRegex[i]))
-            {
-                difficulty = i;
-                break;
-            }
-            if (RE2::PartialMatch(title, *difficultyRegex[i]))
-            {
-                difficulty = i;
-                break;
-            }
-        }
-    }
+        setImplicitDifficulty();
 
     for (size_t i = 0; i <= lastBarIdx; i++)
-        if (metres[i].toDouble() == 0.0)
+        if (metres[i] == Metre())
             metres[i] = Metre(4, 4);
 
+    std::stable_sort(objects.begin(), objects.end(), laneOrder);
+
     // pick LNs out of notes for each lane
-    if (!lnobjSet.empty() || haveLNchannels)
     {
-        for (unsigned chIdx = 0; chIdx < 20; ++chIdx)
+        auto [itBegin, itEnd] = std::equal_range(objects.begin(), objects.end(), ParsedObject{ LaneCode::NOTE1 },
+            [](const ParsedObject& lhs, const ParsedObject& rhs) { return lhs.code < rhs.code; });
+        ParsedObject* LNhead = nullptr;
+        for (auto it = itBegin; it != itEnd; ++it)
         {
-            if (chNotesRegular.find(chIdx) == chNotesRegular.end()) continue;
-
-            std::list<size_t> modifiedChannels;
-            decltype(std::declval<channel>().notes.begin()) LNhead;
-            unsigned bar_head = 0;
-            unsigned resolution_head = 1;
-            unsigned bar_curr = 0;
-            bool hasHead = false;
+            if (LNhead != nullptr && LNhead->lane != it->lane)
+                LNhead = nullptr;
 
-            // find next LN head
-            for (; bar_curr <= lastBarIdx; bar_curr++)
+            // Regular note inside a LN (can be seen with o2mania + #LNTYPE 1) is not allowed. Handle any following note as LN tail.
+            if (LNhead != nullptr && (lnobjSet.count(it->value) || (LNhead->flags & channel::NoteParseValue::LN)))
             {
-                if (chNotesRegular[chIdx][bar_curr].notes.empty()) continue;
-
-                auto& noteList = chNotesRegular[chIdx][bar_curr].notes;
-                auto itNote = noteList.begin();
-                while (itNote != noteList.end())
-                {
-                    // Regular note inside a LN (can be seen with o2mania + #LNTYPE 1) is not allowed. Handle any following note as LN tail.
-                    if (hasHead && (lnobjSet.count(itNote->value) || (LNhead->flags & channel::NoteParseValue::LN)))
-                    {
-                        unsigned segment = LNhead->segment * chNotesLN[chIdx][bar_head].relax(resolution_head) / resolution_head;
-                        unsigned value = LNhead->value;
-                        unsigned resolution_tail = chNotesRegular[chIdx][bar_curr].resolution;
-                        unsigned segment2 = itNote->segment * chNotesLN[chIdx][bar_curr].relax(resolution_tail) / resolution_tail;
-                        unsigned value2 = itNote->value;
-                        chNotesLN[chIdx][bar_head].notes.push_back({ segment, value });
-                        chNotesLN[chIdx][bar_curr].notes.push_back({ segment2, value2 });
-
-                        haveLN = true;
-
-                        chNotesRegular[chIdx][bar_head].notes.erase(LNhead);
-                        auto itPrev = itNote;
-                        bool resetItNote = (itNote == noteList.begin());
-                        if (!resetItNote) itPrev--;
-                        chNotesRegular[chIdx][bar_curr].notes.erase(itNote);
-                        itNote = resetItNote ? noteList.begin() : ++itPrev;
-
-                        modifiedChannels.push_back(bar_head);
-                        modifiedChannels.push_back(bar_curr);
-
-                        bar_head = 0;
-                        resolution_head = 1;
-                        hasHead = false;
-                    }
-                    else
-                    {
-                        LNhead = itNote;
-                        bar_head = bar_curr;
-                        resolution_head = chNotesRegular[chIdx][bar_curr].resolution;
-                        hasHead = true;
-
-                        ++itNote;
-                    }
-                }
+                LNhead->code = LaneCode::NOTELN1;
+                it->code = LaneCode::NOTELN1;
+                haveLN = true;
+                LNhead = nullptr;
             }
-
-            if (bar_head <= lastBarIdx) chNotesLN[chIdx][bar_head].sortNotes();
-            if (bar_curr <= lastBarIdx) chNotesLN[chIdx][bar_curr].sortNotes();
-        }
-    }
-
-    // Get statistics
-    if (haveNote)
-    {
-        for (unsigned bar = 0; bar <= lastBarIdx; bar++)
-        {
-            notes_scratch += chNotesRegular[0][bar].notes.size() + chNotesRegular[10][bar].notes.size();
-        }
-
-        for (unsigned lane = 0; lane < chNotesRegular.size(); ++lane)
-        {
-            if (lane == 0 || lane == 10) continue;
-            for (const auto& [barIdx, ch]: chNotesRegular[lane])
+            else
             {
-                notes_key += ch.notes.size();
+                LNhead = &*it;
             }
         }
-        notes_total += notes_scratch + notes_key;
     }
 
-    if (haveLN)
+    // Get statistics
     {
-        for (unsigned bar = 0; bar <= lastBarIdx; bar++)
+        std::array<unsigned long, 2> regularNotes{}; // scratch, key
+        std::array<unsigned long, 2> lnNotes = metaLNChannelNotes;
+        for (const auto& obj : objects)
         {
-            notes_scratch_ln += chNotesLN[0][bar].notes.size() + chNotesLN[10][bar].notes.size();
+            const size_t area = (obj.lane == 0 || obj.lane == 10) ? 0 : 1;
+            if (obj.code == LaneCode::NOTE1)
+                regularNotes[area]++;
+            else if (obj.code == LaneCode::NOTELN1)
+                lnNotes[area]++;
         }
-        notes_scratch_ln /= 2;
-
-        for (unsigned lane = 0; lane < chNotesLN.size(); ++lane)
+        if (haveNote)
         {
-            if (lane == 0 || lane == 10) continue;
-            for (const auto& [barIdx, ch] : chNotesLN[lane])
-            {
-                notes_key_ln += ch.notes.size();
-            }
+            notes_scratch = regularNotes[0];
+            notes_key = regularNotes[1];
+            notes_total += notes_scratch + notes_key;
         }
-        notes_key_ln /= 2;
-
-        notes_total += notes_scratch_ln + notes_key_ln;
-    }
-
-    if (haveMine)
-    {
-        for (const auto& [chIdx, chLane] : chMines)
+        if (haveLN)
         {
-            for (const auto& [barIdx, ch] : chLane)
-            {
-                notes_mine += ch.notes.size();
-            }
+            notes_scratch_ln = lnNotes[0] / 2;
+            notes_key_ln = lnNotes[1] / 2;
+            notes_total += notes_scratch_ln + notes_key_ln;
         }
     }
 
@@ -714,21 +738,19 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
     startBPM = bpm;
     if (haveBPMChange)
     {
-        for (unsigned m = 0; m <= lastBarIdx; m++)
+        for (const auto& ns : objects)
         {
-            for (const auto& ns : chBPMChange[m].notes)
-            {
-                if (ns.value > maxBPM) maxBPM = ns.value;
-                if (ns.value < minBPM) minBPM = ns.value;
-            }
-            for (const auto& ns : chExBPMChange[m].notes)
-            {
-                if (exBPM[ns.value] > maxBPM) maxBPM = exBPM[ns.value];
-                if (exBPM[ns.value] < minBPM) minBPM = exBPM[ns.value];
-            }
+            if (ns.code != LaneCode::BPM && ns.code != LaneCode::EXBPM) continue;
+            double value = ns.code == LaneCode::BPM ? double(ns.value) : exBPM[ns.value];
+            if (value > maxBPM) maxBPM = value;
+            if (value < minBPM) minBPM = value;
         }
     }
 
+    // PMS lanes 6-9 are mapped after parsing, see getLaneIndexPMS
+    std::array<unsigned, 20> pmsLaneMap;
+    std::iota(pmsLaneMap.begin(), pmsLaneMap.end(), 0);
+    auto swapLane = [&pmsLaneMap](unsigned lhs, unsigned rhs) { std::swap(pmsLaneMap[lhs], pmsLaneMap[rhs]); };
     if (isPMS)
     {
         gamemode = 9;
@@ -736,14 +758,8 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
         {
             // 11	12	13	14	15	18	19	16	17	not known or well known
             player = 1;
-            std::swap(chNotesRegular[6], chNotesRegular[8]);
-            std::swap(chNotesRegular[7], chNotesRegular[9]);
-            std::swap(chNotesInvisible[6], chNotesInvisible[8]);
-            std::swap(chNotesInvisible[7], chNotesInvisible[9]);
-            std::swap(chNotesLN[6], chNotesLN[8]);
-            std::swap(chNotesLN[7], chNotesLN[9]);
-			std::swap(chMines[6], chMines[8]);
-			std::swap(chMines[7], chMines[9]);
+            swapLane(6, 8);
+            swapLane(7, 9);
             have67 = true;
 
             if (have67_2)
@@ -752,12 +768,8 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
                 // 18KEYS is not supported. Parse as 9KEYS
                 gamemode = 9;
                 player = 1;
-                std::swap(chNotesRegular[16], chNotesRegular[18]);
-                std::swap(chNotesRegular[17], chNotesRegular[19]);
-                std::swap(chNotesInvisible[16], chNotesInvisible[18]);
-                std::swap(chNotesInvisible[17], chNotesInvisible[19]);
-                std::swap(chNotesLN[16], chNotesLN[18]);
-                std::swap(chNotesLN[17], chNotesLN[19]);
+                swapLane(16, 18);
+                swapLane(17, 19);
                 have67_2 = true;
             }
         }
@@ -765,22 +777,10 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
         {
             // 11	12	13	14	15	22	23	24	25	standard PMS
             player = 1;
-            std::swap(chNotesRegular[6], chNotesRegular[12]);
-            std::swap(chNotesRegular[7], chNotesRegular[13]);
-            std::swap(chNotesRegular[8], chNotesRegular[14]);
-            std::swap(chNotesRegular[9], chNotesRegular[15]);
-            std::swap(chNotesInvisible[6], chNotesInvisible[12]);
-            std::swap(chNotesInvisible[7], chNotesInvisible[13]);
-            std::swap(chNotesInvisible[8], chNotesInvisible[14]);
-            std::swap(chNotesInvisible[9], chNotesInvisible[15]);
-            std::swap(chNotesLN[6], chNotesLN[12]);
-            std::swap(chNotesLN[7], chNotesLN[13]);
-            std::swap(chNotesLN[8], chNotesLN[14]);
-            std::swap(chNotesLN[9], chNotesLN[15]);
-			std::swap(chMines[6], chMines[12]);
-            std::swap(chMines[7], chMines[13]);
-            std::swap(chMines[8], chMines[14]);
-            std::swap(chMines[9], chMines[15]);
+            swapLane(6, 12);
+            swapLane(7, 13);
+            swapLane(8, 14);
+            swapLane(9, 15);
             have67 = true;
             have89 = true;
             haveAny_2 = false;
@@ -804,102 +804,190 @@ int ChartFormatBMS::initWithFile(const Path& filePath, uint64_t randomSeed)
         }
     }
 
-    fileHash = md5file(absolutePath);
-    LOG_INFO << "[BMS] File (" << getFileEncodingName(encoding) << "): " << absolutePath << " MD5: " << fileHash.hexdigest();
-
-    loaded = true;
-
-    return 0;
-}
-
-std::string ChartFormatBMS::getError()
-{
-    using err = ErrorCode;
-    switch (errorCode)
+    // Length, following the timing rules of ChartObjectBMS::loadBMS: the chart ends at the bar after the last object
+    if (metadataOnly)
     {
-    // TODO: i18n
-    case err::OK: return "OK";
-    case bms::ErrorCode::FILE_ERROR: return "File error";
-    case bms::ErrorCode::ALREADY_INITIALIZED: return "Already initialized";
-    case bms::ErrorCode::VALUE_ERROR: return "Value error";
-    case bms::ErrorCode::TYPE_MISMATCH: return "Type mismatch";
-    case bms::ErrorCode::NOTE_LINE_ERROR: return "Note line error";
-    }
-    abort();
-}
+        std::vector<ParsedObject> metaTimings;
+        std::copy_if(objects.begin(), objects.end(), std::back_inserter(metaTimings), [](const ParsedObject& obj)
+            {
+                return obj.code == LaneCode::BPM || obj.code == LaneCode::EXBPM || obj.code == LaneCode::STOP;
+            });
 
-int ChartFormatBMS::seqToLane36(channel& ch, StringContentView str, unsigned flags)
-{
-    //if (str.length() % 2 != 0)
-    //    throw new noteLineException;
+        // process order inside a bar is [BPM > ExBPM > Stop] when placed together
+        std::stable_sort(metaTimings.begin(), metaTimings.end(), [](const ParsedObject& lhs, const ParsedObject& rhs)
+            {
+                if (lhs.bar != rhs.bar) return lhs.bar < rhs.bar;
+                if (lhs.before(rhs)) return true;
+                if (rhs.before(lhs)) return false;
+                return lhs.code < rhs.code;
+            });
+
+        std::vector<lunaticvibes::Time> barTimestamp(lastBarIdx + 1);
+        lunaticvibes::Time basetime{ 0 };
+        BPM currentBPM = bpm;
+        bool bpmInvalid = currentBPM <= 0;
+        auto beatLength = lunaticvibes::Time::singleBeatLengthFromBPM(bpmInvalid ? 130.0 : currentBPM);
+        int lastObjectBar = metaLastObjectBar;
+
+        auto itTiming = metaTimings.cbegin();
+        for (unsigned m = 0; m <= lastBarIdx && !bpmInvalid; m++)
+        {
+            barTimestamp[m] = basetime;
+            Segment lastBPMChangedSegment(0, 1);
+            Metre barMetre = metres[m];
 
-    size_t length = 0;
+            for (; itTiming != metaTimings.cend() && itTiming->bar == m && !bpmInvalid; ++itTiming)
+            {
+                Segment noteSegment(itTiming->segment, itTiming->resolution);
+                double metreFromBPMChange = ((noteSegment - lastBPMChangedSegment) * barMetre).toDouble();
+                lunaticvibes::Time notetime = basetime + beatLength * (metreFromBPMChange * 4);
 
-    for (auto c : str)
+                if (itTiming->code == LaneCode::STOP)
+                {
+                    lastObjectBar = std::max(lastObjectBar, static_cast<int>(m));
+                    double noteStopMetre = stop[itTiming->value] / 192.0;
+                    if (noteStopMetre <= 0) continue;
+                    basetime += lunaticvibes::Time{ (long long)std::floor(beatLength.hres() * noteStopMetre * 4), true };
+                }
+                else
+                {
+                    BPM newBPM = itTiming->code == LaneCode::BPM ? BPM(itTiming->value) : exBPM[itTiming->value];
+                    if (newBPM == currentBPM) continue;
+                    lastObjectBar = std::max(lastObjectBar, static_cast<int>(m));
+                    if (newBPM <= 0)
+                    {
+                        // the chart stops here
+                        bpmInvalid = true;
+                        basetime = notetime;
+                        break;
+                    }
+                    basetime = notetime;
+                    lastBPMChangedSegment = noteSegment;
+                    currentBPM = newBPM;
+                    beatLength = lunaticvibes::Time::singleBeatLengthFromBPM(currentBPM);
+                }
+            }
+            if (!bpmInvalid)
+                basetime += beatLength * (1.0 - lastBPMChangedSegment) * barMetre.toDouble() * 4;
+        }
+
+        if (lastObjectBar < 0) lastObjectBar = static_cast<int>(lastBarIdx);
+        lunaticvibes::Time length = (!bpmInvalid && static_cast<unsigned>(lastObjectBar) + 1 <= lastBarIdx) ? barTimestamp[lastObjectBar + 1] : basetime +
+            lunaticvibes::Time(std::min(2000'000'000ll, std::max(500'000'000ll, static_cast<long long>(beatLength.hres()) * 4)), true);    // last measure + 1
+        totalLength = static_cast<int>(length.norm() / 1000);
+        totalNotes = static_cast<int>(notes_total);
+    }
+    else
     {
-        if (!((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')))
+        if (isPMS)
         {
-            //throw new noteLineException;
-            break;
+            for (auto& obj : objects)
+            {
+                if (obj.code >= LaneCode::NOTE1 && obj.code <= LaneCode::NOTEMINE2)
+                    obj.lane = pmsLaneMap[obj.lane];
+            }
+        }
+        std::stable_sort(objects.begin(), objects.end(), laneOrder);
+
+        // Group the objects by lane and bar. Each bar has its own resolution, the LCM of its lines
+        laneNotes.reserve(objects.size());
+        for (auto it = objects.begin(); it != objects.end();)
+        {
+            auto itEnd = it;
+            unsigned resolution = 1;
+            for (; itEnd != objects.end() && itEnd->sameLane(*it) && itEnd->bar == it->bar; ++itEnd)
+                resolution = std::lcm(resolution, itEnd->resolution);
+
+            auto& lanes = laneIndex[(size_t)it->code];
+            if (lanes.size() <= it->lane)
+                lanes.resize(it->lane + 1);
+            auto& bars = lanes[it->lane];
+            if (bars.empty())
+                bars.resize(lastBarIdx + 1);
+            bars[it->bar] = { static_cast<unsigned>(laneNotes.size()), static_cast<unsigned>(itEnd - it), resolution };
+
+            for (; it != itEnd; ++it)
+                laneNotes.push_back({ it->segment * (resolution / it->resolution), it->value, it->flags });
         }
-        length++;
     }
-    if (length / 2 == 0) return 1;
 
-    unsigned resolution = static_cast<unsigned>(length / 2);
-    unsigned scale = ch.relax(resolution) / resolution;
-    for (unsigned i = 0; i < resolution; i++)
-    {
-        unsigned segment = i * scale;
-        unsigned value = base36(str[i * 2], str[i * 2 + 1]);
-        if (value == 0) continue;
+    fileHash = md5(content);
+    LOG_INFO << "[BMS] File (" << getFileEncodingName(encoding) << "): " << absolutePath << " MD5: " << fileHash.hexdigest();
 
-        ch.notes.push_back({ segment, value, flags });
-    }
-    ch.sortNotes();
+    loaded = true;
 
     return 0;
 }
-int ChartFormatBMS::seqToLane36(channel& ch, const StringContent& str, unsigned flags)
-{
-    return seqToLane36(ch, StringContentView(str), flags);
-}
 
-int ChartFormatBMS::seqToLane16(channel& ch, StringContentView str)
+// Splits a subtitle like "Title -Another-" or "Title [EX]" out of the title.
+void ChartFormatBMS::setImplicitSubtitle()
 {
-    //if (str.length() % 2 != 0)
-    //    throw new noteLineException;
-
-    size_t length = 0;
-
-    for (auto c : str)
+    static const LazyRE2 subTitleRegex[]
+    {
+        { R"((.+?) *(-.*?-))" },
+        { R"((.+?) *(〜.*?〜))" },
+        { R"((.+?) *(\(.*?\)))" },
+        { R"((.+?) *(\[.*?\]))" },
+        { R"((.+?) *(<.*?>))" },
+    };
+    for (auto& reg : subTitleRegex)
     {
-        if (!((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f')))
+        std::string title1, title2;
+        if (RE2::FullMatch(title, *reg, &title1, &title2))
         {
-            //throw new noteLineException;
+            this->title = title1;
+            this->title2 = title2;
             break;
         }
-        length++;
     }
-    if (length / 2 == 0) return 1;
+}
 
-    unsigned resolution = static_cast<unsigned>(length / 2);
-    unsigned scale = ch.relax(resolution) / resolution;
-    for (unsigned i = 0; i < resolution; i++)
+// Guesses difficulty from the difficulty name or titles. Defaults to normal.
+void ChartFormatBMS::setImplicitDifficulty()
+{
+    static const LazyRE2 difficultyRegex[]
     {
-        unsigned segment = i * scale;
-        unsigned value = base16(str[i * 2], str[i * 2 + 1]);
-        if (value == 0) continue;
-
-        ch.notes.push_back({ segment, value });
+        { "" },
+        { R"((?i)(easy|beginner|light))" },
+        { R"((?i)(normal|standard))" },
+        { R"((?i)(hard|hyper))" },
+        { R"((?i)(ex|another|insane|lunatic|maniac))" },
+    };
+    difficulty = 2; // defaults to normal
+    for (int i = 4; i >= 1; --i)
+    {
+        if (RE2::PartialMatch(version, *difficultyRegex[i]))
+        {
+            difficulty = i;
+            break;
+        }
+        if (RE2::PartialMatch(title2, *difficultyRegex[i]))
+        {
+            difficulty = i;
+            break;
+        }
+        if (RE2::PartialMatch(title, *difficultyRegex[i]))
+        {
+            difficulty = i;
+            break;
+        }
     }
-    ch.sortNotes();
-
-    return 0;
 }
-int ChartFormatBMS::seqToLane16(channel& ch, const StringContent& str)
+
+std::string ChartFormatBMS::getError()
 {
-    return seqToLane16(ch, StringContentView(str));
+    using err = ErrorCode;
+    switch (errorCode)
+    {
+    // TODO: i18n
+    case err::OK: return "OK";
+    case bms::ErrorCode::FILE_ERROR: return "File error";
+    case bms::ErrorCode::ALREADY_INITIALIZED: return "Already initialized";
+    case bms::ErrorCode::VALUE_ERROR: return "Value error";
+    case bms::ErrorCode::TYPE_MISMATCH: return "Type mismatch";
+    case bms::ErrorCode::NOTE_LINE_ERROR: return "Note line error";
+    }
+    abort();
 }
 
 std::pair<int, int> ChartFormatBMS::getLaneIndexBME(int x_, int _y)
@@ -982,81 +1070,30 @@ std::pair<int, int> ChartFormatBMS::getLaneIndexPMS(int x_, int _y)
     return { side, idx };
 }
 
-auto ChartFormatBMS::getLane(LaneCode code, unsigned chIdx, unsigned barIdx) const -> const channel&
+auto ChartFormatBMS::getLane(LaneCode code, unsigned chIdx, unsigned barIdx) const -> channel
 {
-    static const channel emptyChannel;
-    if (barIdx <= lastBarIdx)
+    if (barIdx > lastBarIdx)
     {
-        auto getCommonLane = [](const LaneMap& ch, unsigned barIdx) -> const channel&
-        {
-            if (ch.find(barIdx) != ch.end())
-            {
-                return ch.at(barIdx);
-            }
-            else
-            {
-                return emptyChannel;
-            }
-        };
-
-        auto getNoteLane = [&](const std::map<unsigned, LaneMap>& ch, unsigned chIdx, unsigned barIdx) -> const channel&
-        {
-            if (ch.find(chIdx) != ch.end())
-            {
-                return getCommonLane(ch.at(chIdx), barIdx);
-            }
-            else
-            {
-                return emptyChannel;
-            }
-        };
-
-        using eC = LaneCode;
-        switch (code)
-        {
-        case eC::BGM:          return getNoteLane(chBGM, chIdx, barIdx); 
-        case eC::BPM:          return getCommonLane(chBPMChange, barIdx); 
-        case eC::EXBPM:        return getCommonLane(chExBPMChange, barIdx); 
-        case eC::STOP:         return getCommonLane(chStop, barIdx); 
-        case eC::BGABASE:      return getCommonLane(chBGABase, barIdx); 
-        case eC::BGALAYER:     return getCommonLane(chBGALayer, barIdx); 
-        case eC::BGAPOOR:      return getCommonLane(chBGAPoor, barIdx); 
-        case eC::NOTE1:        return getNoteLane(chNotesRegular, chIdx, barIdx); 
-        case eC::NOTE2:        return getNoteLane(chNotesRegular, chIdx + 10, barIdx); 
-        case eC::NOTEINV1:     return getNoteLane(chNotesInvisible, chIdx, barIdx); 
-        case eC::NOTEINV2:     return getNoteLane(chNotesInvisible, chIdx + 10, barIdx);
-        case eC::NOTELN1:      return getNoteLane(chNotesLN, chIdx, barIdx); 
-        case eC::NOTELN2:      return getNoteLane(chNotesLN, chIdx + 10, barIdx); 
-        case eC::NOTEMINE1:    return getNoteLane(chMines, chIdx, barIdx); 
-        case eC::NOTEMINE2:    return getNoteLane(chMines, chIdx + 10, barIdx); 
-        default: break;
-        }
+        assert(false);
+        return {};
     }
 
-    assert(false);
-    return emptyChannel;
-}
-
-unsigned ChartFormatBMS::channel::relax(unsigned target_resolution)
-{
-    unsigned target = std::lcm(target_resolution, resolution);
-    unsigned pow = target / resolution;
-    if (pow == 1) return target;
-
-    resolution = target;
-    for (auto& n : notes)
+    using eC = LaneCode;
+    switch (code)
     {
-        n.segment *= pow;
+    case eC::NOTE2:        code = eC::NOTE1;     chIdx += 10; break;
+    case eC::NOTEINV2:     code = eC::NOTEINV1;  chIdx += 10; break;
+    case eC::NOTELN2:      code = eC::NOTELN1;   chIdx += 10; break;
+    case eC::NOTEMINE2:    code = eC::NOTEMINE1; chIdx += 10; break;
+    case eC::LANECODE_COUNT: assert(false); return {};
+    default: break;
     }
-    return target;
-}
 
-void ChartFormatBMS::channel::sortNotes()
-{
-    std::vector<NoteParseValue> vec(notes.begin(), notes.end());
-    std::stable_sort(vec.begin(), vec.end(), [](const NoteParseValue& lhs, const NoteParseValue& rhs)
-        {
-            return lhs.segment < rhs.segment;
-        });
-    notes.assign(vec.begin(), vec.end());
-}
\ No newline at end of file
+    const auto& lanes = laneIndex[(size_t)code];
+    if (chIdx >= lanes.size() || lanes[chIdx].empty())
+        return {};
+
+    const BarRange& range = lanes[chIdx][barIdx];
+    const channel::NoteParseValue* first = laneNotes.data() + range.offset;
+    return { { first, first + range.count }, range.resolution };
+}
@@ -1,10 +1,12 @@
 #pragma once
 #include <array>
+#include <iterator>
 #include <string>
 #include <list>
 #include <map>
 #include <set>
 #include <regex>
+#include <vector>
 
 #include "chartformat.h"
 #include "common/types.h"
@@ -48,6 +50,7 @@ namespace bms
         NOTELN2,
         NOTEMINE1,
         NOTEMINE2,
+        LANECODE_COUNT
     };
 }
 
@@ -97,6 +100,8 @@ public:
 
 public:
     ChartFormatBMSMeta() { _type = eChartFormat::BMS; }
+    // For BMS-like formats sharing the same metadata, e.g. BMSON
+    explicit ChartFormatBMSMeta(eChartFormat type) { _type = type; }
     ~ChartFormatBMSMeta() override = default;
 };
 
@@ -105,6 +110,7 @@ class ChartFormatBMS: public ChartFormatBMSMeta
 {
     friend class SceneSelect;
     friend class SongDB;
+    friend class ChartFormatCache;
 
 public:
     bool getExtendedProperty(const std::string& key, void* ret) override;
@@ -114,8 +120,20 @@ public:
     ChartFormatBMS(const Path& absolutePath, uint64_t randomSeed = 0);
     ~ChartFormatBMS() override = default;
 
+    // Parse headers, flags and statistics only, for indexing. Lanes and resource lists are left empty;
+    // totalLength and totalNotes are calculated while parsing instead. The result cannot be played.
+    static std::shared_ptr<ChartFormatBMS> createMetadataFromFile(const Path& absolutePath, uint64_t randomSeed = 0);
+    // Same as above, parsing the file content already read by the caller. fileHash is calculated from it.
+    static std::shared_ptr<ChartFormatBMS> createMetadataFromBuffer(const Path& absolutePath, std::string_view content, uint64_t randomSeed = 0);
+    bool isMetadataOnly() const { return metadataOnly; }
+
 protected:
     int initWithFile(const Path& absolutePath, uint64_t randomSeed = 0);
+    int initWithBuffer(const Path& absolutePath, std::string_view content, uint64_t randomSeed = 0);
+    bool metadataOnly = false;
+
+    void setImplicitSubtitle();
+    void setImplicitDifficulty();
 
 protected:
     ErrorCode errorCode = ErrorCode::OK;
@@ -124,6 +142,7 @@ public:
     std::string getError();
 
 public:
+    // Objects of one lane in one bar, sorted by segment. Points into the lane storage of the chart.
     struct channel {
         struct NoteParseValue
         {
@@ -136,33 +155,34 @@ public:
             };
             unsigned flags;
         };
-        std::list<NoteParseValue> notes{};
+        struct NoteRange
+        {
+            const NoteParseValue* first = nullptr;
+            const NoteParseValue* last = nullptr;
+            const NoteParseValue* begin() const { return first; }
+            const NoteParseValue* end() const { return last; }
+            auto rbegin() const { return std::make_reverse_iterator(last); }
+            auto rend() const { return std::make_reverse_iterator(first); }
+            bool empty() const { return first == last; }
+            size_t size() const { return static_cast<size_t>(last - first); }
+        };
+        NoteRange notes{};
         unsigned resolution = 1;
-
-        unsigned relax(unsigned target_resolution);
-        void sortNotes();
     };
-    typedef std::map<unsigned, channel> LaneMap;    // bar -> channel
-    
+
 protected:
     // Lanes.
-    int seqToLane36(channel&, const StringContent& str, unsigned flags = 0);
-    int seqToLane36(channel&, StringContentView str, unsigned flags = 0);
-    int seqToLane16(channel&, const StringContent& str);
-    int seqToLane16(channel&, StringContentView str);
-
-    std::map<unsigned, LaneMap> chBGM{}; // lane -> [bar -> channel]
-    LaneMap chStop{};
-    LaneMap chBPMChange{};
-    LaneMap chExBPMChange{};
-    LaneMap chBGABase{};
-    LaneMap chBGALayer{};
-    LaneMap chBGAPoor{};
-    
-    std::map<unsigned, LaneMap> chNotesRegular{};   // lane -> [bar -> channel]
-    std::map<unsigned, LaneMap> chNotesInvisible{};
-    std::map<unsigned, LaneMap> chNotesLN{};
-    std::map<unsigned, LaneMap> chMines{};
+    // Objects of every lane are stored in one array, grouped by lane and bar. Notes of both sides are kept
+    // under NOTE1 / NOTEINV1 / NOTELN1 / NOTEMINE1 with lane index 0-19; BGM uses the layer as lane index.
+    std::vector<channel::NoteParseValue> laneNotes;
+    struct BarRange
+    {
+        unsigned offset = 0;
+        unsigned count = 0;
+        unsigned resolution = 1;
+    };
+    // LaneCode -> lane -> bar. Vectors are left empty for unused lanes.
+    std::array<std::vector<std::vector<BarRange>>, (size_t)LaneCode::LANECODE_COUNT> laneIndex{};
 
     std::pair<int, int> getLaneIndexBME(int x_, int _y);
     std::pair<int, int> getLaneIndexPMS(int x_, int _y);
@@ -179,5 +199,5 @@ public:
     std::array<unsigned, MAXBARIDX + 1> bgmLayersCount{};
 
 public:
-    auto getLane(LaneCode, unsigned chIdx, unsigned measureIdx) const -> const channel&;
+    auto getLane(LaneCode, unsigned chIdx, unsigned measureIdx) const -> channel;
 };
@@ -0,0 +1,792 @@
+#include "chartformat_bmson.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <tao/json/events/from_string.hpp>
+
+#include "common/log.h"
+#include "common/sysutil.h"
+
+namespace
+{
+
+// Fields of bmson 1.0 used by the game. Numbers are kept as double, as bmson writers don't agree on integers.
+struct BmsonData
+{
+    StringContent version;
+
+    StringContent title;
+    StringContent subtitle;
+    StringContent artist;
+    std::vector<StringContent> subartists;
+    StringContent genre;
+    StringContent modeHint = "beat-7k";
+    StringContent chartName;
+    double level = 0;
+    double initBPM = 130.0;
+    double judgeRank = 100;
+    double total = 100;
+    StringContent backImage;
+    StringContent eyecatchImage;
+    StringContent bannerImage;
+    StringContent previewMusic;
+    double resolution = 240;
+
+    struct Event
+    {
+        double y = 0;
+        double value = 0;   // BPM, stop duration in pulses or BGA id
+    };
+    struct Note
+    {
+        double x = 0;
+        double y = 0;
+        double l = 0;       // length in pulses, LN if > 0
+        double damage = 0;  // mines only
+        bool c = false;     // continues the previous slice of the channel
+        unsigned channel = 0;
+    };
+
+    std::vector<double> lines;
+    std::vector<Event> bpmEvents;
+    std::vector<Event> stopEvents;
+    std::vector<StringContent> soundChannels;
+    std::vector<Note> notes;
+    std::vector<StringContent> keyChannels;
+    std::vector<Note> invisibleNotes;
+    std::vector<Note> mineNotes;
+
+    std::vector<std::pair<double, StringContent>> bgaHeader;
+    enum BgaEventType { BGA_BASE, BGA_LAYER, BGA_POOR, BGA_EVENT_TYPE_COUNT };
+    std::array<std::vector<Event>, BGA_EVENT_TYPE_COUNT> bgaEvents;
+};
+
+// Consumer of tao::json events. Tracks the containers we are inside of and stores values by key, so the document
+// is never built in memory. Unknown keys and containers are skipped.
+class BmsonConsumer
+{
+public:
+    explicit BmsonConsumer(BmsonData& data) : _data(data) {}
+
+    void null() {}
+    void boolean(const bool v)
+    {
+        if (top() == Ctx::SOUND_NOTE && _key == "c")
+            _data.notes.back().c = v;
+    }
+    void number(const std::int64_t v) { value(static_cast<double>(v)); }
+    void number(const std::uint64_t v) { value(static_cast<double>(v)); }
+    void number(const double v) { value(v); }
+    void string(const std::string_view v)
+    {
+        switch (top())
+        {
+        case Ctx::ROOT:
+            if (_key == "version") _data.version = v;
+            break;
+        case Ctx::INFO:
+            if (_key == "title") _data.title = v;
+            else if (_key == "subtitle") _data.subtitle = v;
+            else if (_key == "artist") _data.artist = v;
+            else if (_key == "genre") _data.genre = v;
+            else if (_key == "mode_hint") _data.modeHint = v;
+            else if (_key == "chart_name") _data.chartName = v;
+            else if (_key == "back_image") _data.backImage = v;
+            else if (_key == "eyecatch_image") _data.eyecatchImage = v;
+            else if (_key == "banner_image") _data.bannerImage = v;
+            else if (_key == "preview_music") _data.previewMusic = v;
+            break;
+        case Ctx::SUBARTISTS:
+            _data.subartists.emplace_back(v);
+            break;
+        case Ctx::SOUND_CHANNEL:
+            if (_key == "name") _data.soundChannels.back() = v;
+            break;
+        case Ctx::KEY_CHANNEL:
+            if (_key == "name") _data.keyChannels.back() = v;
+            break;
+        case Ctx::BGA_HEADER_ITEM:
+            if (_key == "name") _data.bgaHeader.back().second = v;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void begin_array(const std::size_t = 0)
+    {
+        Ctx ctx = Ctx::IGNORED;
+        switch (top())
+        {
+        case Ctx::ROOT:
+            if (_key == "lines") ctx = Ctx::LINES;
+            else if (_key == "bpm_events") ctx = Ctx::BPM_EVENTS;
+            else if (_key == "stop_events") ctx = Ctx::STOP_EVENTS;
+            else if (_key == "sound_channels") ctx = Ctx::SOUND_CHANNELS;
+            else if (_key == "key_channels") ctx = Ctx::KEY_CHANNELS;
+            else if (_key == "mine_channels") ctx = Ctx::MINE_CHANNELS;
+            break;
+        case Ctx::INFO:
+            if (_key == "subartists") ctx = Ctx::SUBARTISTS;
+            break;
+        case Ctx::SOUND_CHANNEL:
+            if (_key == "notes") ctx = Ctx::SOUND_NOTES;
+            break;
+        case Ctx::KEY_CHANNEL:
+            if (_key == "notes") ctx = Ctx::KEY_NOTES;
+            break;
+        case Ctx::MINE_CHANNEL:
+            if (_key == "notes") ctx = Ctx::MINE_NOTES;
+            break;
+        case Ctx::BGA:
+            if (_key == "bga_header") ctx = Ctx::BGA_HEADER;
+            else if (_key == "bga_events") { ctx = Ctx::BGA_EVENTS; _bgaEventType = BmsonData::BGA_BASE; }
+            else if (_key == "layer_events") { ctx = Ctx::BGA_EVENTS; _bgaEventType = BmsonData::BGA_LAYER; }
+            else if (_key == "poor_events") { ctx = Ctx::BGA_EVENTS; _bgaEventType = BmsonData::BGA_POOR; }
+            break;
+        default:
+            break;
+        }
+        _stack.push_back(ctx);
+    }
+    void element() {}
+    void end_array(const std::size_t = 0) { _stack.pop_back(); }
+
+    void begin_object(const std::size_t = 0)
+    {
+        Ctx ctx = Ctx::IGNORED;
+        switch (top())
+        {
+        case Ctx::NONE:
+            ctx = Ctx::ROOT;
+            break;
+        case Ctx::ROOT:
+            if (_key == "info") ctx = Ctx::INFO;
+            else if (_key == "bga") ctx = Ctx::BGA;
+            break;
+        case Ctx::LINES:
+            ctx = Ctx::LINE;
+            break;
+        case Ctx::BPM_EVENTS:
+            ctx = Ctx::BPM_EVENT;
+            _data.bpmEvents.emplace_back();
+            break;
+        case Ctx::STOP_EVENTS:
+            ctx = Ctx::STOP_EVENT;
+            _data.stopEvents.emplace_back();
+            break;
+        case Ctx::SOUND_CHANNELS:
+            ctx = Ctx::SOUND_CHANNEL;
+            _data.soundChannels.emplace_back();
+            break;
+        case Ctx::SOUND_NOTES:
+            ctx = Ctx::SOUND_NOTE;
+            _data.notes.emplace_back().channel = static_cast<unsigned>(_data.soundChannels.size() - 1);
+            break;
+        case Ctx::KEY_CHANNELS:
+            ctx = Ctx::KEY_CHANNEL;
+            _data.keyChannels.emplace_back();
+            break;
+        case Ctx::KEY_NOTES:
+            ctx = Ctx::KEY_NOTE;
+            _data.invisibleNotes.emplace_back().channel = static_cast<unsigned>(_data.keyChannels.size() - 1);
+            break;
+        case Ctx::MINE_CHANNELS:
+            ctx = Ctx::MINE_CHANNEL;
+            break;
+        case Ctx::MINE_NOTES:
+            ctx = Ctx::MINE_NOTE;
+            _data.mineNotes.emplace_back();
+            break;
+        case Ctx::BGA_HEADER:
+            ctx = Ctx::BGA_HEADER_ITEM;
+            _data.bgaHeader.emplace_back();
+            break;
+        case Ctx::BGA_EVENTS:
+            ctx = Ctx::BGA_EVENT;
+            _data.bgaEvents[_bgaEventType].emplace_back();
+            break;
+        default:
+            break;
+        }
+        _stack.push_back(ctx);
+    }
+    void key(const std::string_view k) { _key = k; }
+    void member() {}
+    void end_object(const std::size_t = 0) { _stack.pop_back(); }
+
+private:
+    enum class Ctx
+    {
+        NONE,
+        ROOT,
+        INFO,
+        SUBARTISTS,
+        LINES,
+        LINE,
+        BPM_EVENTS,
+        BPM_EVENT,
+        STOP_EVENTS,
+        STOP_EVENT,
+        SOUND_CHANNELS,
+        SOUND_CHANNEL,
+        SOUND_NOTES,
+        SOUND_NOTE,
+        KEY_CHANNELS,
+        KEY_CHANNEL,
+        KEY_NOTES,
+        KEY_NOTE,
+        MINE_CHANNELS,
+        MINE_CHANNEL,
+        MINE_NOTES,
+        MINE_NOTE,
+        BGA,
+        BGA_HEADER,
+        BGA_HEADER_ITEM,
+        BGA_EVENTS,
+        BGA_EVENT,
+        IGNORED,
+    };
+
+    BmsonData& _data;
+    std::vector<Ctx> _stack;
+    std::string _key;
+    BmsonData::BgaEventType _bgaEventType = BmsonData::BGA_BASE;
+
+    Ctx top() const { return _stack.empty() ? Ctx::NONE : _stack.back(); }
+
+    void value(const double v)
+    {
+        switch (top())
+        {
+        case Ctx::INFO:
+            if (_key == "level") _data.level = v;
+            else if (_key == "init_bpm") _data.initBPM = v;
+            else if (_key == "judge_rank") _data.judgeRank = v;
+            else if (_key == "total") _data.total = v;
+            else if (_key == "resolution") _data.resolution = v;
+            break;
+        case Ctx::LINE:
+            if (_key == "y") _data.lines.push_back(v);
+            break;
+        case Ctx::BPM_EVENT:
+            if (_key == "y") _data.bpmEvents.back().y = v;
+            else if (_key == "bpm") _data.bpmEvents.back().value = v;
+            break;
+        case Ctx::STOP_EVENT:
+            if (_key == "y") _data.stopEvents.back().y = v;
+            else if (_key == "duration") _data.stopEvents.back().value = v;
+            break;
+        case Ctx::SOUND_NOTE:
+        case Ctx::KEY_NOTE:
+        case Ctx::MINE_NOTE:
+        {
+            auto& note = top() == Ctx::SOUND_NOTE ? _data.notes.back() :
+                top() == Ctx::KEY_NOTE ? _data.invisibleNotes.back() : _data.mineNotes.back();
+            if (_key == "x") note.x = v;
+            else if (_key == "y") note.y = v;
+            else if (_key == "l") note.l = v;
+            else if (_key == "damage") note.damage = v;
+            break;
+        }
+        case Ctx::BGA_HEADER_ITEM:
+            if (_key == "id") _data.bgaHeader.back().first = v;
+            break;
+        case Ctx::BGA_EVENT:
+            if (_key == "y") _data.bgaEvents[_bgaEventType].back().y = v;
+            else if (_key == "id") _data.bgaEvents[_bgaEventType].back().value = v;
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+struct BmsonMode
+{
+    const char* name;
+    unsigned gamemode;
+    int player;
+    bool isPMS;
+    // bmson x (1-based) -> lane index, 0: scratch, 1-9: keys, +10: 2P side
+    std::vector<unsigned> lanes;
+};
+
+const BmsonMode* getBmsonMode(const StringContent& modeHint)
+{
+    static const BmsonMode modes[] =
+    {
+        { "beat-5k",  5,  1, false, { 1, 2, 3, 4, 5, 0 } },
+        { "beat-7k",  7,  1, false, { 1, 2, 3, 4, 5, 6, 7, 0 } },
+        { "beat-10k", 10, 3, false, { 1, 2, 3, 4, 5, 0, 11, 12, 13, 14, 15, 10 } },
+        { "beat-14k", 14, 3, false, { 1, 2, 3, 4, 5, 6, 7, 0, 11, 12, 13, 14, 15, 16, 17, 10 } },
+        { "popn-5k",  9,  1, true,  { 3, 4, 5, 6, 7 } },
+        { "popn-9k",  9,  1, true,  { 1, 2, 3, 4, 5, 6, 7, 8, 9 } },
+    };
+    for (const auto& mode : modes)
+        if (modeHint == mode.name)
+            return &mode;
+    return nullptr;
+}
+
+} // namespace
+
+ChartFormatBMSON::ChartFormatBMSON() : ChartFormatBMS()
+{
+    _type = eChartFormat::BMSON;
+}
+
+ChartFormatBMSON::ChartFormatBMSON(const Path& filePath, uint64_t randomSeed) : ChartFormatBMS()
+{
+    _type = eChartFormat::BMSON;
+    initWithFile(filePath, randomSeed);
+}
+
+std::shared_ptr<ChartFormatBMSON> ChartFormatBMSON::createMetadataFromFile(const Path& filePath, uint64_t randomSeed)
+{
+    auto p = std::make_shared<ChartFormatBMSON>();
+    p->metadataOnly = true;
+    p->wavFiles = {};
+    p->bgaFiles = {};
+    p->initWithFile(filePath, randomSeed);
+    return p;
+}
+
+std::shared_ptr<ChartFormatBMSON> ChartFormatBMSON::createMetadataFromBuffer(const Path& filePath, std::string_view content, uint64_t randomSeed)
+{
+    auto p = std::make_shared<ChartFormatBMSON>();
+    p->metadataOnly = true;
+    p->wavFiles = {};
+    p->bgaFiles = {};
+    p->initWithBuffer(filePath, content, randomSeed);
+    return p;
+}
+
+int ChartFormatBMSON::initWithFile(const Path& filePath, uint64_t randomSeed)
+{
+    if (loaded)
+        return 1;
+
+    lunaticvibes::MappedFile file;
+    if (!file.open(std::filesystem::absolute(filePath)))
+    {
+        fileName = filePath.filename();
+        absolutePath = std::filesystem::absolute(filePath);
+        errorCode = ErrorCode::FILE_ERROR;
+        errorLine = 0;
+        LOG_WARNING << "[BMSON] " << absolutePath << " File ERROR";
+        return 1;
+    }
+    return initWithBuffer(filePath, std::string_view(file.data(), file.size()), randomSeed);
+}
+
+// bmson has no #RANDOM; randomSeed is ignored
+int ChartFormatBMSON::initWithBuffer(const Path& filePath, std::string_view content, uint64_t randomSeed)
+{
+    if (loaded)
+        return 1;
+
+    fileName = filePath.filename();
+    absolutePath = std::filesystem::absolute(filePath);
+    errorLine = 0;
+
+    LOG_DEBUG << "[BMSON] File: " << absolutePath;
+
+    BmsonData data;
+    try
+    {
+        BmsonConsumer consumer(data);
+        tao::json::events::from_string(consumer, content);
+    }
+    catch (const std::exception& e)
+    {
+        errorCode = ErrorCode::VALUE_ERROR;
+        LOG_WARNING << "[BMSON] " << absolutePath << " Parse error: " << e.what();
+        return 1;
+    }
+
+    if (data.version.empty())
+    {
+        errorCode = ErrorCode::TYPE_MISMATCH;
+        LOG_WARNING << "[BMSON] " << absolutePath << " Legacy bmson is not supported";
+        return 1;
+    }
+    const BmsonMode* mode = getBmsonMode(data.modeHint);
+    if (mode == nullptr)
+    {
+        errorCode = ErrorCode::TYPE_MISMATCH;
+        LOG_WARNING << "[BMSON] " << absolutePath << " Mode not supported: " << data.modeHint;
+        return 1;
+    }
+    if (data.resolution <= 0 || data.initBPM <= 0)
+    {
+        errorCode = ErrorCode::VALUE_ERROR;
+        LOG_WARNING << "[BMSON] " << absolutePath << " Invalid resolution or BPM";
+        return 1;
+    }
+
+    // Header
+    modeHint = data.modeHint;
+    resolution = std::llround(data.resolution);
+    title = data.title;
+    title2 = data.subtitle;
+    artist = data.artist;
+    for (const auto& s : data.subartists)
+    {
+        if (!artist2.empty()) artist2 += " ";
+        artist2 += s;
+    }
+    genre = data.genre;
+    version = data.chartName;
+    playLevel = static_cast<int>(data.level);
+    stagefile = data.eyecatchImage;
+    backbmp = data.backImage;
+    banner = data.bannerImage;
+    if (!data.previewMusic.empty())
+        extraCommands["PREVIEW"] = data.previewMusic;
+
+    gamemode = mode->gamemode;
+    player = mode->player;
+    isPMS = mode->isPMS;
+
+    // judge_rank is a percentage, where 100 is as wide as #RANK 3
+    rank = std::clamp(static_cast<int>(std::lround(data.judgeRank / 25.0)) - 1, 0, 4);
+    // total is a percentage of the default gauge gain
+    total = (data.total <= 0 || data.total == 100) ? -1 : static_cast<int>(std::lround(160 * data.total / 100));
+
+    bpm = data.initBPM;
+    startBPM = bpm;
+    minBPM = bpm;
+    maxBPM = bpm;
+
+    if (title2.empty())
+        setImplicitSubtitle();
+    setImplicitDifficulty();
+
+    // Objects, in pulses
+    struct Object
+    {
+        LaneCode code;
+        unsigned lane;
+        long long y;
+        unsigned value;
+        unsigned bar = 0;
+    };
+    std::vector<Object> objects;
+    objects.reserve(data.notes.size() + data.invisibleNotes.size() + data.mineNotes.size() + 64);
+
+    auto laneOf = [&](double x, unsigned& lane)
+    {
+        long long idx = std::llround(x);
+        if (idx < 1 || idx > static_cast<long long>(mode->lanes.size()))
+            return false;
+        lane = mode->lanes[idx - 1];
+        return true;
+    };
+    auto sampleOf = [](size_t channel) -> unsigned
+    {
+        return channel + 1 <= MAXSAMPLEIDX ? static_cast<unsigned>(channel + 1) : 0;
+    };
+    if (data.soundChannels.size() + data.keyChannels.size() > MAXSAMPLEIDX)
+        LOG_WARNING << "[BMSON] " << absolutePath << " Too many sound channels, only " << MAXSAMPLEIDX << " are loaded";
+
+    // Sound notes. Notes overlapping a LN or another note in the same lane are dropped, as lanes can't hold them.
+    {
+        std::vector<const BmsonData::Note*> sorted;
+        sorted.reserve(data.notes.size());
+        for (const auto& n : data.notes)
+            if (n.y >= 0)
+                sorted.push_back(&n);
+        std::stable_sort(sorted.begin(), sorted.end(), [](const BmsonData::Note* lhs, const BmsonData::Note* rhs) { return lhs->y < rhs->y; });
+
+        std::array<long long, 20> laneBusyUntil;
+        laneBusyUntil.fill(-1);
+        size_t overlapped = 0;
+        for (const auto* n : sorted)
+        {
+            const long long y = std::llround(n->y);
+            const unsigned sample = n->c ? 0 : sampleOf(n->channel);
+            unsigned lane = 0;
+            if (!laneOf(n->x, lane))
+            {
+                // continued BGM slices keep playing by themselves
+                if (!n->c)
+                    objects.push_back({ LaneCode::BGM, 0, y, sample });
+                continue;
+            }
+            if (y <= laneBusyUntil[lane])
+            {
+                ++overlapped;
+                continue;
+            }
+            const long long l = std::llround(n->l);
+            if (l > 0)
+            {
+                objects.push_back({ LaneCode::NOTELN1, lane, y, sample });
+                objects.push_back({ LaneCode::NOTELN1, lane, y + l, sample });
+                laneBusyUntil[lane] = y + l;
+                haveLN = true;
+                (lane == 0 || lane == 10 ? notes_scratch_ln : notes_key_ln)++;
+            }
+            else
+            {
+                objects.push_back({ LaneCode::NOTE1, lane, y, sample });
+                laneBusyUntil[lane] = y;
+                haveNote = true;
+                (lane == 0 || lane == 10 ? notes_scratch : notes_key)++;
+            }
+            if (lane >= 10) haveAny_2 = true;
+            if (lane == 6 || lane == 7) have67 = true;
+            if (lane == 16 || lane == 17) have67_2 = true;
+            if (lane == 8 || lane == 9) have89 = true;
+            if (lane == 18 || lane == 19) have89_2 = true;
+        }
+        if (overlapped > 0)
+            LOG_WARNING << "[BMSON] " << absolutePath << " " << overlapped << " overlapping notes are dropped";
+        notes_total = notes_scratch + notes_key + notes_scratch_ln + notes_key_ln;
+    }
+    for (const auto& n : data.invisibleNotes)
+    {
+        unsigned lane = 0;
+        if (n.y < 0 || !laneOf(n.x, lane))
+            continue;
+        objects.push_back({ LaneCode::NOTEINV1, lane, std::llround(n.y), sampleOf(data.soundChannels.size() + n.channel) });
+        haveInvisible = true;
+    }
+    for (const auto& n : data.mineNotes)
+    {
+        unsigned lane = 0;
+        if (n.y < 0 || !laneOf(n.x, lane))
+            continue;
+        // damage in percent, the same as the mine value of BMS divided by 2
+        unsigned value = static_cast<unsigned>(std::clamp(std::lround(n.damage * 2), 1l, static_cast<long>(MAXSAMPLEIDX - 1)));
+        objects.push_back({ LaneCode::NOTEMINE1, lane, std::llround(n.y), value });
+        haveMine = true;
+        notes_mine++;
+    }
+
+    // BPM changes and stops are indexed into exBPM / stop. Events not changing anything are dropped, the same as
+    // ChartObjectBMS does, so they don't count as objects for the chart length.
+    struct Timing
+    {
+        long long y;
+        bool isStop;
+        double value;
+    };
+    std::vector<Timing> timings;
+    {
+        std::vector<BmsonData::Event> bpmEvents = data.bpmEvents;
+        std::stable_sort(bpmEvents.begin(), bpmEvents.end(), [](const auto& lhs, const auto& rhs) { return lhs.y < rhs.y; });
+        std::map<double, unsigned> bpmIndex;
+        double currentBPM = bpm;
+        for (const auto& e : bpmEvents)
+        {
+            if (e.y < 0 || e.value == currentBPM) continue;
+            auto [it, inserted] = bpmIndex.emplace(e.value, static_cast<unsigned>(bpmIndex.size() + 1));
+            if (it->second > MAXSAMPLEIDX)
+            {
+                LOG_WARNING << "[BMSON] " << absolutePath << " Too many distinct BPM values";
+                break;
+            }
+            if (inserted)
+                exBPM[it->second] = e.value;
+            objects.push_back({ LaneCode::EXBPM, 0, std::llround(e.y), it->second });
+            timings.push_back({ std::llround(e.y), false, e.value });
+            currentBPM = e.value;
+            haveBPMChange = true;
+            if (e.value > 0)
+            {
+                minBPM = std::min(minBPM, e.value);
+                maxBPM = std::max(maxBPM, e.value);
+            }
+        }
+
+        std::map<double, unsigned> stopIndex;
+        for (const auto& e : data.stopEvents)
+        {
+            if (e.y < 0 || e.value <= 0) continue;
+            auto [it, inserted] = stopIndex.emplace(e.value, static_cast<unsigned>(stopIndex.size() + 1));
+            if (it->second > MAXSAMPLEIDX)
+            {
+                LOG_WARNING << "[BMSON] " << absolutePath << " Too many distinct stop durations";
+                break;
+            }
+            if (inserted)
+                stop[it->second] = e.value * 48 / resolution; // in 1/192 of a 4/4 bar
+            objects.push_back({ LaneCode::STOP, 0, std::llround(e.y), it->second });
+            timings.push_back({ std::llround(e.y), true, e.value });
+            haveStop = true;
+        }
+
+        // BPM change before stop at the same pulse
+        std::stable_sort(timings.begin(), timings.end(), [](const Timing& lhs, const Timing& rhs)
+            {
+                return lhs.y < rhs.y || (lhs.y == rhs.y && !lhs.isStop && rhs.isStop);
+            });
+    }
+
+    // BGA
+    if (!data.bgaHeader.empty())
+    {
+        std::map<long long, unsigned> bgaIndex;
+        for (const auto& [id, name] : data.bgaHeader)
+        {
+            unsigned idx = static_cast<unsigned>(bgaIndex.size() + 1);
+            if (idx > MAXSAMPLEIDX) break;
+            if (bgaIndex.emplace(std::llround(id), idx).second && !metadataOnly)
+                bgaFiles[idx] = name;
+        }
+        const std::array<LaneCode, BmsonData::BGA_EVENT_TYPE_COUNT> bgaLanes = { LaneCode::BGABASE, LaneCode::BGALAYER, LaneCode::BGAPOOR };
+        for (size_t i = 0; i < bgaLanes.size(); ++i)
+        {
+            for (const auto& e : data.bgaEvents[i])
+            {
+                if (auto it = bgaIndex.find(std::llround(e.value)); it != bgaIndex.end() && e.y >= 0)
+                {
+                    objects.push_back({ bgaLanes[i], 0, std::llround(e.y), it->second });
+                    haveBGA = true;
+                }
+            }
+        }
+    }
+
+    // Bars. Lines are bar lines; bars after the last line, or all bars if there are none, are 4/4.
+    const long long barLength44 = resolution * 4;
+    std::vector<long long> barStarts{ 0 };
+    for (double line : data.lines)
+        if (line > 0)
+            barStarts.push_back(std::llround(line));
+    std::sort(barStarts.begin(), barStarts.end());
+    barStarts.erase(std::unique(barStarts.begin(), barStarts.end()), barStarts.end());
+
+    long long lastObjectY = -1;
+    for (const auto& obj : objects)
+        lastObjectY = std::max(lastObjectY, obj.y);
+    while (barStarts.back() + barLength44 <= lastObjectY && barStarts.size() <= MAXBARIDX + 1)
+        barStarts.push_back(barStarts.back() + barLength44);
+
+    auto barOf = [&barStarts](long long y)
+    {
+        return static_cast<unsigned>(std::upper_bound(barStarts.begin(), barStarts.end(), y) - barStarts.begin() - 1);
+    };
+    int lastObjectBar = lastObjectY < 0 ? -1 : static_cast<int>(barOf(lastObjectY));
+    if (lastObjectBar > static_cast<int>(MAXBARIDX))
+    {
+        LOG_WARNING << "[BMSON] " << absolutePath << " Objects after bar " << MAXBARIDX << " are dropped";
+        lastObjectBar = MAXBARIDX;
+    }
+    // leave a bar after the last object, where the chart ends
+    lastBarIdx = std::min(static_cast<unsigned>(lastObjectBar + 1), MAXBARIDX);
+    while (barStarts.size() < lastBarIdx + 2)
+        barStarts.push_back(barStarts.back() + barLength44);
+    if (barStarts.size() > MAXBARIDX + 2)
+        barStarts.resize(MAXBARIDX + 2);
+
+    for (unsigned i = 0; i <= lastBarIdx; ++i)
+    {
+        long long length = barStarts[i + 1] - barStarts[i];
+        metres[i] = Metre(length, barLength44);
+        if (length != barLength44)
+            haveMetricMod = true;
+    }
+
+    // Length, following the timing rules of ChartObjectBMS::loadBMS: the chart ends at the bar after the last object
+    {
+        double seconds = 0;
+        double currentBPM = bpm;
+        long long lastY = 0;
+        const long long endY = static_cast<unsigned>(lastObjectBar + 1) <= lastBarIdx ? barStarts[lastObjectBar + 1] : barStarts[lastBarIdx + 1];
+        bool bpmInvalid = false;
+        for (const auto& t : timings)
+        {
+            if (t.y >= endY) break;
+            seconds += (t.y - lastY) / static_cast<double>(resolution) * 60.0 / currentBPM;
+            lastY = t.y;
+            if (t.isStop)
+            {
+                seconds += t.value / resolution * 60.0 / currentBPM;
+            }
+            else if (t.value <= 0)
+            {
+                // the chart stops here
+                bpmInvalid = true;
+                break;
+            }
+            else
+            {
+                currentBPM = t.value;
+            }
+        }
+        if (!bpmInvalid)
+            seconds += (endY - lastY) / static_cast<double>(resolution) * 60.0 / currentBPM;
+        if (bpmInvalid || static_cast<unsigned>(lastObjectBar + 1) > lastBarIdx)
+            seconds += std::clamp(4 * 60.0 / currentBPM, 0.5, 2.0); // last measure + 1
+        totalLength = static_cast<int>(seconds);
+        totalNotes = static_cast<int>(notes_total);
+    }
+
+    if (!metadataOnly)
+    {
+        for (size_t i = 0; i < data.soundChannels.size() && i + 1 <= MAXSAMPLEIDX; ++i)
+            wavFiles[i + 1] = data.soundChannels[i];
+        for (size_t i = 0; i < data.keyChannels.size() && data.soundChannels.size() + i + 1 <= MAXSAMPLEIDX; ++i)
+            wavFiles[data.soundChannels.size() + i + 1] = data.keyChannels[i];
+
+        for (auto& obj : objects)
+            obj.bar = barOf(obj.y);
+        objects.erase(std::remove_if(objects.begin(), objects.end(), [this](const Object& obj) { return obj.bar > lastBarIdx; }),
+            objects.end());
+        std::stable_sort(objects.begin(), objects.end(), [](const Object& lhs, const Object& rhs)
+            {
+                if (lhs.code != rhs.code) return lhs.code < rhs.code;
+                if (lhs.lane != rhs.lane) return lhs.lane < rhs.lane;
+                return lhs.y < rhs.y;
+            });
+
+        // BGM objects at the same pulse are spread into layers
+        {
+            auto [itBegin, itEnd] = std::equal_range(objects.begin(), objects.end(), Object{ LaneCode::BGM },
+                [](const Object& lhs, const Object& rhs) { return lhs.code < rhs.code; });
+            for (auto it = itBegin; it != itEnd; ++it)
+            {
+                it->lane = (it != itBegin && std::prev(it)->y == it->y) ? std::prev(it)->lane + 1 : 0;
+                bgmLayersCount[it->bar] = std::max(bgmLayersCount[it->bar], it->lane + 1);
+            }
+            std::stable_sort(itBegin, itEnd, [](const Object& lhs, const Object& rhs) { return lhs.lane < rhs.lane; });
+        }
+
+        // Group the objects by lane and bar. Segments are pulses from the start of the bar
+        laneNotes.reserve(objects.size());
+        for (auto it = objects.begin(); it != objects.end();)
+        {
+            auto itEnd = it;
+            while (itEnd != objects.end() && itEnd->code == it->code && itEnd->lane == it->lane && itEnd->bar == it->bar)
+                ++itEnd;
+
+            auto& lanes = laneIndex[(size_t)it->code];
+            if (lanes.size() <= it->lane)
+                lanes.resize(it->lane + 1);
+            auto& bars = lanes[it->lane];
+            if (bars.empty())
+                bars.resize(lastBarIdx + 1);
+            const long long barStart = barStarts[it->bar];
+            const unsigned barLength = static_cast<unsigned>(barStarts[it->bar + 1] - barStart);
+            bars[it->bar] = { static_cast<unsigned>(laneNotes.size()), static_cast<unsigned>(itEnd - it), barLength };
+
+            for (; it != itEnd; ++it)
+                laneNotes.push_back({ static_cast<unsigned>(it->y - barStart), it->value, 0 });
+        }
+    }
+
+    fileHash = md5(content);
+    LOG_INFO << "[BMSON] File: " << absolutePath << " MD5: " << fileHash.hexdigest();
+
+    loaded = true;
+    return 0;
+}
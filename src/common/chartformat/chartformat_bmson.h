@@ -1,2 +1,33 @@
 #pragma once
-// placeholder
\ No newline at end of file
+#include <memory>
+#include <string_view>
+
+#include "chartformat_bms.h"
+
+// bmson 1.0 charts. The JSON is parsed as a stream of events, without building a document, and the objects are
+// stored into the same lanes as BMS, so the chart is played through ChartObjectBMS.
+//
+// Limitations:
+//  - Sliced keysounds are not supported. Each sound channel is one sample; notes continuing the previous slice
+//    (c = true) don't restart the sample. Continued BGM notes are dropped, continued key notes are silent.
+//  - Bars, BPM changes and stops are limited the same way as BMS (MAXBARIDX bars, MAXSAMPLEIDX distinct values).
+//  - Legacy bmson (0.21, no "version" field), scroll events and keyboard / generic modes are not supported.
+class ChartFormatBMSON : public ChartFormatBMS
+{
+public:
+    ChartFormatBMSON();
+    ChartFormatBMSON(const Path& absolutePath, uint64_t randomSeed = 0);
+    ~ChartFormatBMSON() override = default;
+
+    static std::shared_ptr<ChartFormatBMSON> createMetadataFromFile(const Path& absolutePath, uint64_t randomSeed = 0);
+    static std::shared_ptr<ChartFormatBMSON> createMetadataFromBuffer(const Path& absolutePath, std::string_view content, uint64_t randomSeed = 0);
+
+protected:
+    int initWithFile(const Path& absolutePath, uint64_t randomSeed = 0);
+    int initWithBuffer(const Path& absolutePath, std::string_view content, uint64_t randomSeed = 0);
+
+public:
+    StringContent modeHint;
+    // bmson resolution, pulses per beat
+    long long resolution = 240;
+};
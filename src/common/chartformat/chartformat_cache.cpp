@@ -0,0 +1,399 @@
+#include "chartformat_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+#include "chartformat_bms.h"
+#include "common/log.h"
+#include "common/sysutil.h"
+
+namespace {
+
+constexpr char CACHE_MAGIC[8] = { 'L', 'V', 'C', 'H', 'A', 'R', 'T', '\0' };
+// Bump whenever the serialized fields of any chart format change.
+constexpr uint32_t CACHE_VERSION = 2;
+constexpr uint32_t CACHE_BYTE_ORDER = 0x01020304;
+constexpr const char* CACHE_EXTENSION = ".chart";
+
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t format;        // eChartFormat
+    uint32_t haveRandom;
+    uint64_t randomSeed;
+    HashMD5 fileHash;
+    FileSignature fileSignature;
+    uint64_t bodySize;
+};
+
+static_assert(std::is_trivially_copyable_v<HashMD5>, "HashMD5 is stored in cache entries as raw bytes");
+
+class CacheWriter
+{
+public:
+    template <typename T>
+    void pod(const T& v)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        _buf.append(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+    void str(const std::string& s)
+    {
+        pod(static_cast<uint32_t>(s.size()));
+        _buf.append(s);
+    }
+    template <typename T>
+    void podVector(const std::vector<T>& v)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        pod(static_cast<uint64_t>(v.size()));
+        _buf.append(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+    }
+    template <typename T, typename F>
+    void vector(const std::vector<T>& v, F&& f)
+    {
+        pod(static_cast<uint64_t>(v.size()));
+        for (const auto& e : v) f(const_cast<T&>(e));
+    }
+    template <typename K, typename V, typename F>
+    void map(const std::map<K, V>& m, F&& f)
+    {
+        pod(static_cast<uint64_t>(m.size()));
+        for (const auto& [k, v] : m) f(const_cast<K&>(k), const_cast<V&>(v));
+    }
+    template <typename T>
+    void podSet(const std::set<T>& s)
+    {
+        pod(static_cast<uint64_t>(s.size()));
+        for (const auto& v : s) pod(v);
+    }
+
+    const std::string& buffer() const { return _buf; }
+
+private:
+    std::string _buf;
+};
+
+// Stops reading at the first out of bounds access; check ok() afterwards.
+class CacheReader
+{
+public:
+    explicit CacheReader(std::string_view buf) : _buf(buf) {}
+
+    template <typename T>
+    void pod(T& v)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (!take(sizeof(T))) return;
+        std::memcpy(&v, _buf.data() + _pos - sizeof(T), sizeof(T));
+    }
+    void str(std::string& s)
+    {
+        uint32_t size = 0;
+        pod(size);
+        if (!take(size)) return;
+        s.assign(_buf.data() + _pos - size, size);
+    }
+    template <typename T>
+    void podVector(std::vector<T>& v)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        uint64_t size = 0;
+        pod(size);
+        if (!_ok || size > (_buf.size() - _pos) / sizeof(T)) { _ok = false; return; }
+        v.resize(size);
+        take(size * sizeof(T));
+        std::memcpy(v.data(), _buf.data() + _pos - size * sizeof(T), size * sizeof(T));
+    }
+    template <typename T, typename F>
+    void vector(std::vector<T>& v, F&& f)
+    {
+        uint64_t size = 0;
+        pod(size);
+        // every element takes at least one byte
+        if (!_ok || size > _buf.size() - _pos) { _ok = false; return; }
+        v.resize(size);
+        for (auto& e : v) f(e);
+    }
+    template <typename K, typename V, typename F>
+    void map(std::map<K, V>& m, F&& f)
+    {
+        uint64_t size = 0;
+        pod(size);
+        m.clear();
+        for (uint64_t i = 0; i < size && _ok; ++i)
+        {
+            K k{};
+            V v{};
+            f(k, v);
+            m.emplace(std::move(k), std::move(v));
+        }
+    }
+    template <typename T>
+    void podSet(std::set<T>& s)
+    {
+        uint64_t size = 0;
+        pod(size);
+        s.clear();
+        for (uint64_t i = 0; i < size && _ok; ++i)
+        {
+            T v{};
+            pod(v);
+            s.insert(v);
+        }
+    }
+
+    bool ok() const { return _ok; }
+    bool atEnd() const { return _pos == _buf.size(); }
+
+private:
+    bool take(size_t bytes)
+    {
+        if (!_ok || bytes > _buf.size() - _pos) { _ok = false; return false; }
+        _pos += bytes;
+        return true;
+    }
+
+    std::string_view _buf;
+    size_t _pos = 0;
+    bool _ok = true;
+};
+
+} // namespace
+
+// Fields of ChartFormatBase and ChartFormatBMS, in cache order. Do not reorder without bumping CACHE_VERSION.
+// Paths are not stored; they are set from the chart file on load.
+struct ChartFormatCache::BMSFields
+{
+    template <typename Archive>
+    static void transfer(Archive& ar, ChartFormatBMS& c)
+    {
+        ar.pod(c.fileHash);
+        ar.pod(c.folderHash);
+        ar.pod(c.addTime);
+        ar.pod(c.gamemode);
+        for (auto* s : { &c.title, &c.title2, &c.artist, &c.artist2, &c.genre, &c.version,
+                         &c.stagefile, &c.backbmp, &c.banner, &c.text1, &c.text2, &c.text3 })
+            ar.str(*s);
+        ar.pod(c.playLevel);
+        ar.pod(c.difficulty);
+        ar.pod(c.levelEstimated);
+        ar.pod(c.totalLength);
+        ar.pod(c.totalNotes);
+        ar.pod(c.minBPM);
+        ar.pod(c.maxBPM);
+        ar.pod(c.startBPM);
+        ar.vector(c.wavFiles, [&](StringContent& s) { ar.str(s); });
+        ar.vector(c.bgaFiles, [&](StringContent& s) { ar.str(s); });
+        ar.vector(c.metres, [&](Metre& m) { long long ticks = m.ticks(); ar.pod(ticks); m = Metre::fromTicks(ticks); });
+        ar.pod(c.resourceStable);
+
+        ar.pod(c.player);
+        ar.pod(c.rank);
+        ar.pod(c.total);
+        ar.pod(c.bpm);
+        for (auto* b : { &c.isPMS, &c.haveNote, &c.haveAny_2, &c.have67, &c.have67_2, &c.have89, &c.have89_2,
+                         &c.haveLN, &c.haveMine, &c.haveInvisible, &c.haveMetricMod, &c.haveStop, &c.haveBPMChange,
+                         &c.haveBGA, &c.haveRandom, &c.haveLNchannels })
+            ar.pod(*b);
+        for (auto* n : { &c.notes_total, &c.notes_key, &c.notes_scratch, &c.notes_key_ln, &c.notes_scratch_ln, &c.notes_mine })
+            ar.pod(*n);
+        ar.pod(c.lastBarIdx);
+
+        ar.map(c.extraCommands, [&](std::string& k, StringContent& v) { ar.str(k); ar.str(v); });
+        ar.podSet(c.lnobjSet);
+
+        ar.pod(c.exBPM);
+        ar.pod(c.stop);
+        ar.pod(c.bgmLayersCount);
+
+        ar.podVector(c.laneNotes);
+        for (auto& lanes : c.laneIndex)
+            ar.vector(lanes, [&](std::vector<ChartFormatBMS::BarRange>& bars) { ar.podVector(bars); });
+    }
+
+    // Ranges must stay inside the note array, as getLane() hands out pointers without checking.
+    static bool validate(const ChartFormatBMS& c)
+    {
+        if (c.lastBarIdx > MAXBARIDX || c.metres.size() != MAXBARIDX + 1)
+            return false;
+        for (const auto& lanes : c.laneIndex)
+        {
+            for (const auto& bars : lanes)
+            {
+                if (!bars.empty() && bars.size() != c.lastBarIdx + 1)
+                    return false;
+                for (const auto& r : bars)
+                {
+                    if (r.offset > c.laneNotes.size() || r.count > c.laneNotes.size() - r.offset || r.resolution == 0)
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+ChartFormatCache::ChartFormatCache(const Path& directory, size_t maxEntries) :
+    _directory(directory), _maxEntries(maxEntries)
+{
+}
+
+Path ChartFormatCache::getEntryPath(const HashMD5& hash, bool haveRandom, uint64_t randomSeed) const
+{
+    std::stringstream ss;
+    ss << hash.hexdigest();
+    if (haveRandom)
+        ss << "_" << std::hex << std::setw(16) << std::setfill('0') << randomSeed;
+    ss << CACHE_EXTENSION;
+    return _directory / ss.str();
+}
+
+std::shared_ptr<ChartFormatBase> ChartFormatCache::load(const Path& chartPath, const HashMD5& hash, uint64_t randomSeed) const
+{
+    std::error_code ec;
+    Path filePath = fs::absolute(chartPath, ec);
+    FileSignature signature;
+    if (ec || analyzeChartType(filePath) != eChartFormat::BMS || !getFileSignature(filePath, signature))
+        return nullptr;
+
+    HashMD5 fileHash = hash.empty() ? md5file(filePath) : hash;
+    if (fileHash.empty())
+        return nullptr;
+
+    // charts without #RANDOM are saved without seed
+    for (const Path& entryPath : { getEntryPath(fileHash, false, 0), getEntryPath(fileHash, true, randomSeed) })
+    {
+        lunaticvibes::MappedFile file;
+        if (!file.open(entryPath))
+            continue;
+
+        CacheHeader header;
+        if (file.size() < sizeof(header))
+            return nullptr;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 || header.version != CACHE_VERSION ||
+            header.byteOrder != CACHE_BYTE_ORDER || header.format != static_cast<uint32_t>(eChartFormat::BMS))
+        {
+            LOG_DEBUG << "[Chart] Cache entry format mismatch: " << entryPath;
+            return nullptr;
+        }
+        if (header.fileHash != fileHash || header.fileSignature != signature ||
+            (header.haveRandom && header.randomSeed != randomSeed))
+        {
+            LOG_DEBUG << "[Chart] Cache entry is stale: " << entryPath;
+            return nullptr;
+        }
+        if (header.bodySize != file.size() - sizeof(header))
+        {
+            LOG_WARNING << "[Chart] Cache entry is corrupted: " << entryPath;
+            return nullptr;
+        }
+
+        auto bms = std::make_shared<ChartFormatBMS>();
+        CacheReader ar(std::string_view(file.data() + sizeof(header), header.bodySize));
+        BMSFields::transfer(ar, *bms);
+        if (!ar.ok() || !ar.atEnd() || !BMSFields::validate(*bms))
+        {
+            LOG_WARNING << "[Chart] Cache entry is corrupted: " << entryPath;
+            return nullptr;
+        }
+        bms->fileName = filePath.filename();
+        bms->absolutePath = filePath;
+        bms->loaded = true;
+        LOG_DEBUG << "[Chart] Loaded from cache: " << filePath;
+        return bms;
+    }
+    return nullptr;
+}
+
+bool ChartFormatCache::save(const ChartFormatBase& chart, uint64_t randomSeed)
+{
+    if (!chart.loaded || chart._type != eChartFormat::BMS)
+        return false;
+    const auto& bms = static_cast<const ChartFormatBMS&>(chart);
+    if (bms.isMetadataOnly() || bms.fileHash.empty())
+        return false;
+
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.byteOrder = CACHE_BYTE_ORDER;
+    header.format = static_cast<uint32_t>(eChartFormat::BMS);
+    header.haveRandom = bms.haveRandom;
+    header.randomSeed = bms.haveRandom ? randomSeed : 0;
+    header.fileHash = bms.fileHash;
+    if (!getFileSignature(bms.absolutePath, header.fileSignature))
+        return false;
+
+    CacheWriter ar;
+    BMSFields::transfer(ar, const_cast<ChartFormatBMS&>(bms));
+    header.bodySize = ar.buffer().size();
+
+    std::unique_lock l(_saveMutex);
+
+    std::error_code ec;
+    fs::create_directories(_directory, ec);
+    Path entryPath = getEntryPath(bms.fileHash, bms.haveRandom, randomSeed);
+    Path tmpPath = entryPath;
+    tmpPath += ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(ar.buffer().data(), ar.buffer().size());
+        out.close();
+        if (!out)
+        {
+            LOG_WARNING << "[Chart] Write cache entry " << tmpPath << " failed";
+            fs::remove(tmpPath, ec);
+            return false;
+        }
+    }
+    fs::rename(tmpPath, entryPath, ec);
+    if (ec)
+    {
+        LOG_WARNING << "[Chart] Replace cache entry " << entryPath << " failed: " << ec.message();
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+
+    prune();
+    return true;
+}
+
+std::shared_ptr<ChartFormatBase> ChartFormatCache::loadOrParse(const Path& chartPath, const HashMD5& hash, uint64_t randomSeed)
+{
+    if (auto chart = load(chartPath, hash, randomSeed))
+        return chart;
+
+    auto chart = ChartFormatBase::createFromFile(chartPath, randomSeed);
+    if (chart && chart->isLoaded())
+        save(*chart, randomSeed);
+    return chart;
+}
+
+void ChartFormatCache::prune()
+{
+    std::vector<std::pair<fs::file_time_type, Path>> entries;
+    std::error_code ec;
+    for (const auto& f : fs::directory_iterator(_directory, ec))
+    {
+        if (f.path().extension() == CACHE_EXTENSION)
+            entries.emplace_back(f.last_write_time(ec), f.path());
+    }
+    if (entries.size() <= _maxEntries)
+        return;
+
+    std::sort(entries.begin(), entries.end());
+    for (size_t i = 0; i < entries.size() - _maxEntries; ++i)
+        fs::remove(entries[i].second, ec);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <memory>
+#include <mutex>
+
+#include "chartformat.h"
+#include "common/hash.h"
+#include "common/types.h"
+
+// On-disk cache of parsed charts, so retrying, replaying or previewing a chart doesn't parse the file again.
+// Entries are keyed by file hash, plus the random seed for charts using #RANDOM. An entry is ignored if it was
+// saved by another cache version, or if the chart file's size or modification time has changed since.
+// Metadata-only charts are never cached.
+class ChartFormatCache
+{
+public:
+    explicit ChartFormatCache(const Path& directory, size_t maxEntries = 256);
+    ChartFormatCache(const ChartFormatCache&) = delete;
+    ChartFormatCache& operator=(const ChartFormatCache&) = delete;
+
+    // Returns nullptr if there is no valid entry. hash is calculated from the file if empty.
+    std::shared_ptr<ChartFormatBase> load(const Path& chartPath, const HashMD5& hash, uint64_t randomSeed) const;
+    bool save(const ChartFormatBase& chart, uint64_t randomSeed);
+
+    // Loads from cache, or parses the file and saves the result.
+    std::shared_ptr<ChartFormatBase> loadOrParse(const Path& chartPath, const HashMD5& hash, uint64_t randomSeed);
+
+private:
+    struct BMSFields;
+
+    Path _directory;
+    size_t _maxEntries;
+    std::mutex _saveMutex;
+
+    Path getEntryPath(const HashMD5& hash, bool haveRandom, uint64_t randomSeed) const;
+    // Removes the least recently written entries beyond _maxEntries.
+    void prune();
+};
@@ -31,14 +31,12 @@ CourseLr2crs::CourseLr2crs(const Path& filePath)
 
 	// convert codepage
 	auto encoding = getFileEncoding(ss);
+	std::stringstream ssConverted(to_utf8_buffer(ss.str(), encoding));
 	std::stringstream ssUTF8;
 	std::string lineBuf;
-	while (!ss.eof())
+	while (!ssConverted.eof())
 	{
-		std::getline(ss, lineBuf);
-
-		// convert codepage
-		lineBuf = to_utf8(lineBuf, encoding);
+		std::getline(ssConverted, lineBuf);
 		lunaticvibes::trim_in_place(lineBuf);
 
 		ssUTF8 << lineBuf;
@@ -1,7 +1,9 @@
 #include "encoding.h"
 
+#include <cstring>
 #include <fstream>
 #include <istream>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -9,26 +11,64 @@
 #include "common/log.h"
 #include "common/sysutil.h"
 
-bool is_ascii(const std::string_view str)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ENCODING_SSE2
+#endif
+
+// Length of the leading run of ASCII bytes. Most of a chart or skin file is ASCII, so the validators below
+// skip these runs a vector at a time and only walk multi-byte sequences byte by byte.
+static size_t ascii_prefix_length(const std::string_view str)
 {
-    for (auto it = str.begin(); it != str.end(); ++it)
+    const char* p = str.data();
+    const size_t size = str.size();
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 32 <= size; i += 32)
     {
-        uint8_t c = *it;
-        if (c > 0x7f)
-            return false;
+        if (_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i))) != 0)
+            break;
     }
-    return true;
+#elif defined(ENCODING_SSE2)
+    for (; i + 16 <= size; i += 16)
+    {
+        if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i))) != 0)
+            break;
+    }
+#else
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, p + i, sizeof(word));
+        if (word & 0x8080808080808080ull)
+            break;
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        if (static_cast<uint8_t>(p[i]) > 0x7f)
+            break;
+    }
+    return i;
+}
+
+bool is_ascii(const std::string_view str)
+{
+    return ascii_prefix_length(str) == str.size();
 }
 
 bool is_shiftjis(const std::string_view str)
 {
-    for (auto it = str.begin(); it != str.end(); ++it)
+    for (size_t i = 0; i < str.size(); ++i)
     {
-        uint8_t c = *it;
-
         // ascii
-        if (c <= 0x7f)
-            continue;
+        i += ascii_prefix_length(str.substr(i));
+        if (i == str.size())
+            break;
+
+        uint8_t c = str[i];
 
         // hankaku gana
         if ((c >= 0xa1 && c <= 0xdf))
@@ -37,8 +77,8 @@ bool is_shiftjis(const std::string_view str)
         // JIS X 0208
         else if ((c >= 0x81 && c <= 0x9f) || (c >= 0xe0 && c <= 0xef))
         {
-            if (++it == str.end()) return false;
-            uint8_t cc = *it;
+            if (++i == str.size()) return false;
+            uint8_t cc = str[i];
             if ((cc >= 0x40 && cc <= 0x7e) || (cc >= 0x80 && cc <= 0xfc))
                 continue;
         }
@@ -46,8 +86,8 @@ bool is_shiftjis(const std::string_view str)
         // user defined
         else if (c >= 0xf0 && c <= 0xfc)
         {
-            if (++it == str.end()) return false;
-            uint8_t cc = *it;
+            if (++i == str.size()) return false;
+            uint8_t cc = str[i];
             if ((cc >= 0x40 && cc <= 0x7e) || (cc >= 0x80 && cc <= 0xfc))
                 continue;
         }
@@ -60,13 +100,14 @@ bool is_shiftjis(const std::string_view str)
 
 bool is_euckr(const std::string_view str)
 {
-    for (auto it = str.begin(); it != str.end(); ++it)
+    for (size_t i = 0; i < str.size(); ++i)
     {
-        uint8_t c = *it;
-
         // ascii
-        if (c <= 0x7f)
-            continue;
+        i += ascii_prefix_length(str.substr(i));
+        if (i == str.size())
+            break;
+
+        uint8_t c = str[i];
 
         // euc-jp
         if (c == 0x8e || c == 0x8f)
@@ -79,8 +120,8 @@ bool is_euckr(const std::string_view str)
         // shared range
         else if (c >= 0xa1 && c <= 0xfe)
         {
-            if (++it == str.end()) return false;
-            uint8_t cc = *it;
+            if (++i == str.size()) return false;
+            uint8_t cc = str[i];
             if (cc >= 0xa1 && cc <= 0xfe)
                 continue;
         }
@@ -93,19 +134,20 @@ bool is_euckr(const std::string_view str)
 
 bool is_utf8(const std::string_view str)
 {
-    for (auto it = str.begin(); it != str.end(); ++it)
+    for (size_t i = 0; i < str.size(); ++i)
     {
-        uint8_t c = *it;
+        // 1 byte (ascii)
+        i += ascii_prefix_length(str.substr(i));
+        if (i == str.size())
+            break;
+
+        uint8_t c = str[i];
         int bytes = 0;
 
         // invalid
         if ((c & 0b1100'0000) == 0b1000'0000 || (c & 0b1111'1110) == 0b1111'1110)
             return false;
 
-        // 1 byte (ascii)
-        else if ((c & 0b1000'0000) == 0)
-            continue;
-
         // 2~6 bytes
         else if ((c & 0b1110'0000) == 0b1100'0000) bytes = 2;
         else if ((c & 0b1111'0000) == 0b1110'0000) bytes = 3;
@@ -116,8 +158,8 @@ bool is_utf8(const std::string_view str)
 
         while (--bytes)
         {
-            if (++it == str.end()) return false;
-            uint8_t cc = *it;
+            if (++i == str.size()) return false;
+            uint8_t cc = str[i];
             if ((cc & 0b1100'0000) != 0b10000000) return false;
         }
     }
@@ -128,12 +170,12 @@ bool is_utf8(const std::string_view str)
 
 eFileEncoding getFileEncoding(const Path& path)
 {
-    std::ifstream fs(path);
-    if (fs.fail())
+    lunaticvibes::MappedFile file;
+    if (!file.open(path))
     {
         return eFileEncoding::LATIN1;
     }
-    return getFileEncoding(fs);
+    return getContentEncoding(std::string_view(file.data(), file.size()));
 }
 
 eFileEncoding getFileEncoding(std::istream& is)
@@ -143,34 +185,48 @@ eFileEncoding getFileEncoding(std::istream& is)
     is.clear();
     is.seekg(0);
 
-    std::string buf;
+    std::string content{ std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>() };
+    eFileEncoding enc = getContentEncoding(content);
+
+    is.clear();
+    is.seekg(oldPos);
+
+    return enc;
+}
+
+eFileEncoding getContentEncoding(std::string_view content)
+{
     eFileEncoding enc = eFileEncoding::LATIN1;
-    while (!is.eof())
+    for (size_t begin = 0; begin < content.size();)
     {
-        std::getline(is, buf, '\n');
+        // only lines with non-ASCII bytes are checked
+        size_t pos = begin + ascii_prefix_length(content.substr(begin));
+        if (pos == content.size())
+            break;
 
-        if (is_ascii(buf)) continue;
+        size_t lineBegin = content.find_last_of('\n', pos);
+        lineBegin = (lineBegin == content.npos || lineBegin < begin) ? begin : lineBegin + 1;
+        size_t lineEnd = std::min(content.size(), content.find('\n', pos));
+        std::string_view line = content.substr(lineBegin, lineEnd - lineBegin);
+        begin = lineEnd + 1;
 
-        if (is_utf8(buf))
+        if (is_utf8(line))
         {
             enc = eFileEncoding::UTF8;
             break;
         }
-        if (is_euckr(buf))
+        if (is_euckr(line))
         {
             enc = eFileEncoding::EUC_KR;
             break;
         }
-        if (is_shiftjis(buf))
+        if (is_shiftjis(line))
         {
             enc = eFileEncoding::SHIFT_JIS;
             break;
         }
     }
 
-    is.clear();
-    is.seekg(oldPos);
-
     if (enc == eFileEncoding::EUC_KR)
     {
         LOG_WARNING << "beep, boop, detected EUC-KR encoding (rare occurrence)";
@@ -261,8 +317,59 @@ std::string from_utf8(const std::string& input, eFileEncoding toEncoding)
     return ret;
 }
 
+std::string to_utf8_buffer(std::string_view input, eFileEncoding fromEncoding)
+{
+    int cp = CP_UTF8;
+    switch (fromEncoding)
+    {
+    case eFileEncoding::SHIFT_JIS:  cp = 932; break;
+    case eFileEncoding::EUC_KR:     cp = 949; break;
+    case eFileEncoding::LATIN1:     cp = 1252; break; // not CP_ACP, which depends on the system locale
+    default:                        cp = CP_UTF8; break;
+    }
+    if (cp == CP_UTF8 || input.empty()) return std::string(input);
+
+    // lengths are given explicitly, so the buffer may contain NULs and needs no terminator
+    std::wstring wstr;
+    int wlen = MultiByteToWideChar(cp, MB_ERR_INVALID_CHARS, input.data(), static_cast<int>(input.size()), NULL, 0);
+    if (wlen > 0)
+    {
+        wstr.resize(wlen);
+        MultiByteToWideChar(cp, MB_ERR_INVALID_CHARS, input.data(), static_cast<int>(input.size()), wstr.data(), wlen);
+    }
+    else
+    {
+        // invalid sequences: convert one character at a time, replacing each rejected byte with '?' as iconv does
+        wstr.reserve(input.size());
+        size_t i = 0;
+        while (i < input.size())
+        {
+            int charLen = (IsDBCSLeadByteEx(cp, static_cast<BYTE>(input[i])) && i + 1 < input.size()) ? 2 : 1;
+            wchar_t wc[2];
+            int n = MultiByteToWideChar(cp, MB_ERR_INVALID_CHARS, input.data() + i, charLen, wc, 2);
+            if (n > 0)
+            {
+                wstr.append(wc, n);
+                i += charLen;
+            }
+            else
+            {
+                wstr.push_back(L'?');
+                i += 1;
+            }
+        }
+        wlen = static_cast<int>(wstr.size());
+    }
+
+    int len = WideCharToMultiByte(CP_UTF8, NULL, wstr.data(), wlen, NULL, 0, NULL, FALSE);
+    std::string ret(len, '\0');
+    WideCharToMultiByte(CP_UTF8, NULL, wstr.data(), wlen, ret.data(), len, NULL, FALSE);
+    return ret;
+}
+
 #else
 
+#include <array>
 #include <cerrno>
 #include <cstring>
 #include <memory>
@@ -297,47 +404,90 @@ struct IcdDeleter {
 };
 using IcdPtr = std::unique_ptr<std::remove_pointer<iconv_t>::type, IcdDeleter>;
 
-static std::string convert(const std::string& input, eFileEncoding from, eFileEncoding to)
+// iconv_open() loads conversion tables each time, so descriptors are kept for the lifetime of each thread.
+// Returns (iconv_t)-1 on failure.
+static iconv_t get_iconv(eFileEncoding from, eFileEncoding to)
 {
-    const auto* source_encoding_name = get_iconv_encoding_name(from);
-    const auto* target_encoding_name = get_iconv_encoding_name(to);
+    thread_local std::array<std::array<IcdPtr, 4>, 4> descriptors;
+    auto& icd = descriptors[static_cast<size_t>(from)][static_cast<size_t>(to)];
+    if (icd)
+    {
+        // reset shift state left by the previous call
+        iconv(icd.get(), nullptr, nullptr, nullptr, nullptr);
+        return icd.get();
+    }
 
-    auto icd = IcdPtr(iconv_open(target_encoding_name, source_encoding_name));
-    if (reinterpret_cast<size_t>(icd.get()) == static_cast<size_t>(-1)) {
+    iconv_t handle = iconv_open(get_iconv_encoding_name(to), get_iconv_encoding_name(from));
+    if (reinterpret_cast<size_t>(handle) == static_cast<size_t>(-1)) {
         const int error = errno;
         LOG_ERROR << "iconv_open() error: " << safe_strerror(error) << " (" << error << ")";
+        return handle;
+    }
+    icd.reset(handle);
+    return handle;
+}
+
+// With `lossy`, bytes that cannot be converted are replaced with '?' instead of failing the whole input.
+static std::string convert(std::string_view input, eFileEncoding from, eFileEncoding to, bool lossy)
+{
+    iconv_t icd = get_iconv(from, to);
+    if (reinterpret_cast<size_t>(icd) == static_cast<size_t>(-1)) {
         return "(conversion descriptor opening error)";
     }
 
-    static constexpr size_t BUF_SIZE = 1024l * 32l;
-    // I wanted to avoid manually allocating here so that we don't have
-    // to clean up manually in all return paths.
-    char out_buf[BUF_SIZE] = { 0 };
+    // enough for most text, grown on E2BIG
+    std::string output(input.size() * 2 + 16, '\0');
+    size_t output_pos = 0;
 
     // BRUH-cast.
-    char* buf_ptr = const_cast<char*>(input.c_str());
+    char* buf_ptr = const_cast<char*>(input.data());
     std::size_t buf_len = input.length();
-    char* out_ptr = static_cast<char*>(out_buf);
-    std::size_t out_len = sizeof(out_buf);
+    while (buf_len > 0)
+    {
+        char* out_ptr = output.data() + output_pos;
+        std::size_t out_len = output.size() - output_pos;
+        std::size_t iconv_ret = iconv(icd, &buf_ptr, &buf_len, &out_ptr, &out_len);
+        output_pos = out_ptr - output.data();
+        if (iconv_ret != static_cast<size_t>(-1))
+            break;
 
-    std::size_t iconv_ret = iconv(icd.get(), &buf_ptr, &buf_len, &out_ptr, &out_len);
-    if (iconv_ret == static_cast<size_t>(-1)) {
         const int error = errno;
-        LOG_ERROR << "iconv() error: " << safe_strerror(error) << " (" << error << ")";
-        return "(conversion error)";
+        if (error == E2BIG) {
+            output.resize(output.size() * 2);
+        }
+        else if (lossy && (error == EILSEQ || error == EINVAL)) {
+            if (output_pos == output.size())
+                output.resize(output.size() * 2);
+            output[output_pos++] = '?';
+            ++buf_ptr;
+            --buf_len;
+            iconv(icd, nullptr, nullptr, nullptr, nullptr);
+        }
+        else {
+            LOG_ERROR << "iconv() error: " << safe_strerror(error) << " (" << error << ")";
+            return "(conversion error)";
+        }
     }
 
-    return std::string{static_cast<char*>(out_buf)};
+    output.resize(output_pos);
+    return output;
 }
 
 std::string to_utf8(const std::string& input, eFileEncoding fromEncoding)
 {
-    return convert(input, fromEncoding, eFileEncoding::UTF8);
+    return convert(input, fromEncoding, eFileEncoding::UTF8, false);
 }
 
 std::string from_utf8(const std::string& input, eFileEncoding toEncoding)
 {
-    return convert(input, eFileEncoding::UTF8, toEncoding);
+    return convert(input, eFileEncoding::UTF8, toEncoding, false);
+}
+
+std::string to_utf8_buffer(std::string_view input, eFileEncoding fromEncoding)
+{
+    if (fromEncoding == eFileEncoding::UTF8)
+        return std::string(input);
+    return convert(input, fromEncoding, eFileEncoding::UTF8, true);
 }
 
 #endif // _WIN32
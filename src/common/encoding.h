@@ -8,11 +8,17 @@ enum class eFileEncoding
 	EUC_KR,
 	UTF8,
 };
+bool is_ascii(std::string_view str);
+
 eFileEncoding getFileEncoding(const Path& path);
 eFileEncoding getFileEncoding(std::istream& is);
+eFileEncoding getContentEncoding(std::string_view content);
 const char* getFileEncodingName(eFileEncoding enc);
 
 std::string to_utf8(const std::string& str, eFileEncoding fromEncoding);
+// Converts a whole buffer, e.g. file content, in one call. Unlike to_utf8(), bytes invalid in the source
+// encoding are replaced instead of failing the conversion.
+std::string to_utf8_buffer(std::string_view input, eFileEncoding fromEncoding);
 std::string from_utf8(const std::string& input, eFileEncoding toEncoding);
 std::u32string to_utf32(const std::string& str, eFileEncoding fromEncoding);
 std::string from_utf32(const std::u32string& input, eFileEncoding toEncoding);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace lunaticvibes {
+
+// Single-producer single-consumer FIFO on a fixed array. Neither side locks, blocks or allocates:
+// tryPush() fails while the ring is full and tryPop() fails while it is empty.
+// One thread pushes and one thread pops at a time; switching threads on a side needs outside synchronization.
+template <typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+public:
+    SpscRing() = default;
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    bool tryPush(const T& item)
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _headCache == Capacity)
+        {
+            _headCache = _head.load(std::memory_order_acquire);
+            if (tail - _headCache == Capacity)
+                return false;
+        }
+        _items[tail & (Capacity - 1)] = item;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& out)
+    {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tailCache)
+        {
+            _tailCache = _tail.load(std::memory_order_acquire);
+            if (head == _tailCache)
+                return false;
+        }
+        out = _items[head & (Capacity - 1)];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Only a hint while the other side is running.
+    [[nodiscard]] size_t size() const
+    {
+        size_t head = _head.load(std::memory_order_acquire);
+        return _tail.load(std::memory_order_acquire) - head;
+    }
+
+    [[nodiscard]] static constexpr size_t capacity() { return Capacity; }
+
+private:
+    // producer and consumer indices on their own cache lines, each with a cached copy of the other side's
+    alignas(64) std::atomic<size_t> _head{ 0 };
+    size_t _tailCache = 0;
+    alignas(64) std::atomic<size_t> _tail{ 0 };
+    size_t _headCache = 0;
+    alignas(64) std::array<T, Capacity> _items{};
+};
+
+} // namespace lunaticvibes
@@ -78,6 +78,18 @@ long long getFileTimeNow();
 // Unix epoch time.
 long long getFileLastWriteTime(const Path& p);
 
+// Size, modification time and file id, used to detect changed files without reading them.
+struct FileSignature
+{
+    long long size = 0;
+    long long mtime = 0; // nanoseconds, platform epoch
+    long long inode = 0; // file index on Windows
+    bool operator==(const FileSignature& rhs) const { return size == rhs.size && mtime == rhs.mtime && inode == rhs.inode; }
+    bool operator!=(const FileSignature& rhs) const { return !(*this == rhs); }
+};
+// Returns false if the file could not be queried.
+bool getFileSignature(const Path& p, FileSignature& out);
+
 enum class Languages
 {
 	EN,
@@ -104,4 +116,27 @@ namespace lunaticvibes {
 // Open link, file or a folder.
 bool open(const std::string& link);
 
+// Read-only memory mapping of a whole file. Pages are loaded on first access.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false if the file could not be opened or mapped. An empty file maps to an empty view.
+    bool open(const Path& path);
+    void close();
+
+    [[nodiscard]] bool isOpen() const { return _open; }
+    [[nodiscard]] const char* data() const { return _data; }
+    [[nodiscard]] size_t size() const { return _size; }
+
+private:
+    const char* _data = nullptr;
+    size_t _size = 0;
+    bool _open = false;
+};
+
 } // namespace lunaticvibes
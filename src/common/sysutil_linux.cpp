@@ -12,6 +12,8 @@
 
 #include <boost/format.hpp>
 
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/prctl.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -76,6 +78,19 @@ long long getFileLastWriteTime(const Path& p)
     return static_cast<long long>(sb.st_mtim.tv_sec);
 }
 
+bool getFileSignature(const Path& p, FileSignature& out)
+{
+    struct stat sb;
+    if (stat(p.native().c_str(), &sb) != 0)
+    {
+        return false;
+    }
+    out.size = static_cast<long long>(sb.st_size);
+    out.mtime = static_cast<long long>(sb.st_mtim.tv_sec) * 1'000'000'000 + sb.st_mtim.tv_nsec;
+    out.inode = static_cast<long long>(sb.st_ino);
+    return true;
+}
+
 namespace portable_strerror_r_detail {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-function"
@@ -118,4 +133,50 @@ bool lunaticvibes::open(const std::string& link)
     return true;
 }
 
+bool lunaticvibes::MappedFile::open(const Path& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    _size = static_cast<size_t>(st.st_size);
+    if (_size == 0)
+    {
+        _data = "";
+    }
+    else
+    {
+        void* p = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            ::close(fd);
+            _size = 0;
+            return false;
+        }
+        _data = static_cast<const char*>(p);
+    }
+    // the mapping stays valid after closing the descriptor
+    ::close(fd);
+    _open = true;
+    return true;
+}
+
+void lunaticvibes::MappedFile::close()
+{
+    if (_open && _size > 0)
+        munmap(const_cast<char*>(_data), _size);
+    _data = nullptr;
+    _size = 0;
+    _open = false;
+}
+
 #endif // __linux__
@@ -101,6 +101,28 @@ long long getFileLastWriteTime(const Path& p)
     return std::chrono::duration_cast<std::chrono::seconds>(fs::last_write_time(p).time_since_epoch()).count() - 11644473600;
 }
 
+bool getFileSignature(const Path& p, FileSignature& out)
+{
+    HANDLE hFile = CreateFileW(p.native().c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL ok = GetFileInformationByHandle(hFile, &info);
+    CloseHandle(hFile);
+    if (!ok)
+    {
+        return false;
+    }
+    out.size = (static_cast<long long>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    // FILETIME is in 100ns units
+    out.mtime = ((static_cast<long long>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime) * 100;
+    out.inode = (static_cast<long long>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    return true;
+}
+
 const char* safe_strerror(int errnum, char* buffer, size_t buffer_length)
 {
     strerror_s(buffer, buffer_length, errnum);
@@ -115,4 +137,60 @@ bool lunaticvibes::open(const std::string& link)
     return res > 32;
 }
 
+bool lunaticvibes::MappedFile::open(const Path& path)
+{
+    close();
+
+    HANDLE hFile = CreateFileW(path.native().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(hFile, &fileSize))
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    _size = static_cast<size_t>(fileSize.QuadPart);
+    if (_size == 0)
+    {
+        // CreateFileMapping fails on empty files
+        CloseHandle(hFile);
+        _data = "";
+        _open = true;
+        return true;
+    }
+
+    HANDLE hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(hFile);
+    if (hMapping == NULL)
+    {
+        _size = 0;
+        return false;
+    }
+    // the view keeps the mapping alive
+    void* p = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hMapping);
+    if (p == NULL)
+    {
+        _size = 0;
+        return false;
+    }
+    _data = static_cast<const char*>(p);
+    _open = true;
+    return true;
+}
+
+void lunaticvibes::MappedFile::close()
+{
+    if (_open && _size > 0)
+        UnmapViewOfFile(_data);
+    _data = nullptr;
+    _size = 0;
+    _open = false;
+}
+
 #endif
\ No newline at end of file
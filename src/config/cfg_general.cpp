@@ -21,7 +21,18 @@ void ConfigGeneral::setDefaults() noexcept
 	set(E_LR2PATH, ".");
 	set(E_FOLDERS, std::vector<std::string>());
 	set(E_TABLES, std::vector<std::string>());
+	set(E_SCAN_ALWAYS_HASH, false);
+	set(E_WATCH_FOLDERS, true);
 	set(E_LOG_LEVEL, E_LOG_LEVEL_INFO);
+	set(E_THREAD_INPUT_CPUS, "");
+	set(E_THREAD_INPUT_SCHED, E_THREAD_SCHED_NORMAL);
+	set(E_THREAD_INPUT_PRIORITY, 80);
+	set(E_THREAD_SOUND_CPUS, "");
+	set(E_THREAD_SOUND_SCHED, E_THREAD_SCHED_NORMAL);
+	set(E_THREAD_SOUND_PRIORITY, 70);
+	set(E_THREAD_UPDATE_CPUS, "");
+	set(E_THREAD_UPDATE_SCHED, E_THREAD_SCHED_NORMAL);
+	set(E_THREAD_UPDATE_PRIORITY, 60);
 }
 
 
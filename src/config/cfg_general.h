@@ -73,6 +73,8 @@ namespace cfg {
     constexpr char E_LR2PATH[] = "LR2Path";
     constexpr char E_FOLDERS[] = "Folders";
     constexpr char E_TABLES[] = "Tables";
+    constexpr char E_SCAN_ALWAYS_HASH[] = "ScanAlwaysHash";
+    constexpr char E_WATCH_FOLDERS[] = "WatchFolders";
 
     constexpr char E_LOG_LEVEL[] = "LogLevel";
     constexpr char E_LOG_LEVEL_DEBUG[] = "Debug";
@@ -80,6 +82,21 @@ namespace cfg {
     constexpr char E_LOG_LEVEL_WARNING[] = "Warning";
     constexpr char E_LOG_LEVEL_ERROR[] = "Error";
 
+    // Looper threads (Linux). CPUs: list of CPUs and ranges like "2,3" or "4-7", empty for any.
+    // Real-time scheduling needs CAP_SYS_NICE or an RLIMIT_RTPRIO limit, otherwise normal priority is kept.
+    constexpr char E_THREAD_INPUT_CPUS[] = "InputThreadCPUs";
+    constexpr char E_THREAD_INPUT_SCHED[] = "InputThreadScheduler";
+    constexpr char E_THREAD_INPUT_PRIORITY[] = "InputThreadPriority";
+    constexpr char E_THREAD_SOUND_CPUS[] = "SoundThreadCPUs";
+    constexpr char E_THREAD_SOUND_SCHED[] = "SoundThreadScheduler";
+    constexpr char E_THREAD_SOUND_PRIORITY[] = "SoundThreadPriority";
+    constexpr char E_THREAD_UPDATE_CPUS[] = "UpdateThreadCPUs";
+    constexpr char E_THREAD_UPDATE_SCHED[] = "UpdateThreadScheduler";
+    constexpr char E_THREAD_UPDATE_PRIORITY[] = "UpdateThreadPriority";
+    constexpr char E_THREAD_SCHED_NORMAL[] = "Normal";
+    constexpr char E_THREAD_SCHED_FIFO[] = "FIFO";
+    constexpr char E_THREAD_SCHED_RR[] = "RR";
+
     constexpr char PROFILE_DEFAULT[] = "default";
 
 }
@@ -1,3 +1,6 @@
+#include <cassert>
+#include <cstring>
+#include <sstream>
 #include <string>
 #include <string_view>
 
@@ -5,7 +8,23 @@
 #include "db_conn.h"
 #include "common/log.h"
 
-SQLite::SQLite(const char* path, std::string tag_) : tag(std::move(tag_))
+// How long a connection waits for a lock before failing with SQLITE_BUSY.
+static constexpr int BUSY_TIMEOUT_MS = 5000;
+
+struct SQLite::ReadConnection
+{
+    sqlite3* db = nullptr;
+    // only used by the thread that checked out the connection
+    SQLiteStatementCache stmtCache;
+
+    ~ReadConnection()
+    {
+        stmtCache.clear();
+        sqlite3_close(db);
+    }
+};
+
+SQLite::SQLite(const char* path, std::string tag_) : tag(std::move(tag_)), _path(path)
 {
     int ret = sqlite3_open(path, &_db);
     if (ret != SQLITE_OK)
@@ -14,13 +33,81 @@ SQLite::SQLite(const char* path, std::string tag_) : tag(std::move(tag_))
                   << errmsg();
     }
 
+    sqlite3_busy_timeout(_db, BUSY_TIMEOUT_MS);
     exec("PRAGMA temp_store = memory");
     exec("PRAGMA mmap_size = 536870912"); // 512MB
 }
 
-SQLite::~SQLite() { sqlite3_close(_db); }
+SQLite::~SQLite()
+{
+    {
+        std::unique_lock l(_readPoolMutex);
+        assert(_idleReaders.size() == _readers.size());
+        _idleReaders.clear();
+        _readers.clear();
+    }
+    {
+        std::unique_lock l(_stmtCacheMutex);
+        _stmtCache.clear();
+    }
+    sqlite3_close(_db);
+}
 const char* SQLite::errmsg() const { return sqlite3_errmsg(_db); }
 
+bool SQLite::enableReadPool(size_t maxReaders)
+{
+    if (_path.empty() || _path == ":memory:" || _path.find("mode=memory") != std::string::npos)
+        return false;
+
+    auto mode = queryAs<std::string>("PRAGMA journal_mode = WAL");
+    if (mode.empty() || std::get<0>(mode[0]) != "wal")
+    {
+        LOG_WARNING << "[sqlite3] " << tag << ": WAL journaling unavailable, reads share the main connection";
+        return false;
+    }
+    // WAL is consistent with NORMAL; a power loss may only lose the latest commits
+    exec("PRAGMA synchronous = NORMAL");
+
+    std::unique_lock l(_readPoolMutex);
+    _maxReaders = maxReaders;
+    LOG_DEBUG << "[sqlite3] " << tag << ": WAL enabled, up to " << maxReaders << " read connections";
+    return true;
+}
+
+SQLite::ReadConnection* SQLite::acquireReader() const
+{
+    std::unique_lock l(_readPoolMutex);
+    if (!_idleReaders.empty())
+    {
+        ReadConnection* reader = _idleReaders.back();
+        _idleReaders.pop_back();
+        return reader;
+    }
+    if (_readers.size() >= _maxReaders)
+    {
+        // all busy or no pool, use the main connection
+        return nullptr;
+    }
+
+    auto reader = std::make_unique<ReadConnection>();
+    int ret = sqlite3_open_v2(_path.c_str(), &reader->db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+    if (ret != SQLITE_OK)
+    {
+        LOG_WARNING << "[sqlite3] " << tag << ": open read connection failed: [" << ret << "] " << sqlite3_errmsg(reader->db);
+        _maxReaders = _readers.size();
+        return nullptr;
+    }
+    sqlite3_busy_timeout(reader->db, BUSY_TIMEOUT_MS);
+    sqlite3_exec(reader->db, "PRAGMA temp_store = memory; PRAGMA mmap_size = 536870912", nullptr, nullptr, nullptr);
+    return _readers.emplace_back(std::move(reader)).get();
+}
+
+void SQLite::releaseReader(ReadConnection* reader) const
+{
+    std::unique_lock l(_readPoolMutex);
+    _idleReaders.push_back(reader);
+}
+
 std::string any_to_str(const std::any& a)
 {
     std::stringstream ss;
@@ -47,6 +134,35 @@ void sql_bind_any(sqlite3_stmt* stmt, int i, const std::any& a)
     else if (a.type() == typeid(nullptr)) sqlite3_bind_null(stmt, i);
     else assert(false); // type error
 }
+void sql_bind(sqlite3_stmt* stmt, int i, int v) { sqlite3_bind_int(stmt, i, v); }
+void sql_bind(sqlite3_stmt* stmt, int i, unsigned v) { sqlite3_bind_int64(stmt, i, v); }
+void sql_bind(sqlite3_stmt* stmt, int i, bool v) { sqlite3_bind_int(stmt, i, int(v)); }
+void sql_bind(sqlite3_stmt* stmt, int i, long v) { sqlite3_bind_int64(stmt, i, v); }
+void sql_bind(sqlite3_stmt* stmt, int i, long long v) { sqlite3_bind_int64(stmt, i, v); }
+void sql_bind(sqlite3_stmt* stmt, int i, double v) { sqlite3_bind_double(stmt, i, v); }
+void sql_bind(sqlite3_stmt* stmt, int i, std::string_view v) { sqlite3_bind_text(stmt, i, v.data(), (int)v.length(), SQLITE_TRANSIENT); }
+void sql_bind(sqlite3_stmt* stmt, int i, const std::string& v) { sqlite3_bind_text(stmt, i, v.c_str(), (int)v.length(), SQLITE_TRANSIENT); }
+void sql_bind(sqlite3_stmt* stmt, int i, const char* v) { sqlite3_bind_text(stmt, i, v, (int)strlen(v), SQLITE_TRANSIENT); }
+void sql_bind(sqlite3_stmt* stmt, int i, std::nullptr_t) { sqlite3_bind_null(stmt, i); }
+
+void sql_column(sqlite3_stmt* stmt, int i, int& out) { out = sqlite3_column_int(stmt, i); }
+void sql_column(sqlite3_stmt* stmt, int i, bool& out) { out = sqlite3_column_int(stmt, i) != 0; }
+void sql_column(sqlite3_stmt* stmt, int i, long long& out) { out = sqlite3_column_int64(stmt, i); }
+void sql_column(sqlite3_stmt* stmt, int i, double& out) { out = sqlite3_column_double(stmt, i); }
+void sql_column(sqlite3_stmt* stmt, int i, std::string& out)
+{
+    const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
+    if (text)
+        out.assign(text, sqlite3_column_bytes(stmt, i));
+    else
+        out.clear();
+}
+void sql_column(sqlite3_stmt* stmt, int i, std::string_view& out)
+{
+    const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
+    out = text ? std::string_view(text, sqlite3_column_bytes(stmt, i)) : std::string_view();
+}
+
 void sql_bind_any(sqlite3_stmt* stmt, const std::initializer_list<std::any>& args)
 {
     int i = 1;
@@ -56,17 +172,156 @@ void sql_bind_any(sqlite3_stmt* stmt, const std::initializer_list<std::any>& arg
     }
 }
 
-std::vector<std::vector<std::any>> SQLite::query(const std::string_view zsql, std::initializer_list<std::any> args) const
+sqlite3_stmt* SQLite::acquireStatement(const std::string& sql) const
 {
-    _lastSql = zsql;
+    {
+        std::unique_lock l(_stmtCacheMutex);
+        _lastSql = sql;
+        if (sqlite3_stmt* stmt = _stmtCache.take(sql))
+            return stmt;
+    }
 
     sqlite3_stmt* stmt = nullptr;
-    int ret = sqlite3_prepare_v3(_db, zsql.data(), static_cast<int>(zsql.size()), 0, &stmt, nullptr);
+    int ret = sqlite3_prepare_v3(_db, sql.data(), static_cast<int>(sql.size()), SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
     if (ret != 0)
     {
-        LOG_ERROR << "[sqlite3] sql \"" << zsql << "\" prepare error: [" << ret << "] " << errmsg();
+        LOG_ERROR << "[sqlite3] sql \"" << sql << "\" prepare error: [" << ret << "] " << errmsg();
+        sqlite3_finalize(stmt);
+        return nullptr;
+    }
+    return stmt;
+}
+
+void SQLite::releaseStatement(const std::string& sql, sqlite3_stmt* stmt) const
+{
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    std::unique_lock l(_stmtCacheMutex);
+    _stmtCache.put(sql, stmt);
+}
+
+sqlite3_stmt* SQLiteStatementCache::take(const std::string& sql)
+{
+    auto it = _entries.find(sql);
+    if (it == _entries.end())
+        return nullptr;
+    _lru.splice(_lru.begin(), _lru, it->second.lru);
+    if (it->second.stmts.empty())
+        return nullptr;
+    sqlite3_stmt* stmt = it->second.stmts.back();
+    it->second.stmts.pop_back();
+    return stmt;
+}
+
+void SQLiteStatementCache::put(const std::string& sql, sqlite3_stmt* stmt)
+{
+    auto it = _entries.find(sql);
+    if (it == _entries.end())
+    {
+        if (_entries.size() >= _capacity && !_lru.empty())
+        {
+            // statements of the evicted SQL still checked out are put back as a new entry later
+            auto victim = _entries.find(_lru.back());
+            for (auto* s : victim->second.stmts)
+                sqlite3_finalize(s);
+            _entries.erase(victim);
+            _lru.pop_back();
+        }
+        _lru.push_front(sql);
+        it = _entries.emplace(sql, Entry{ {}, _lru.begin() }).first;
+    }
+    else
+    {
+        _lru.splice(_lru.begin(), _lru, it->second.lru);
+    }
+    it->second.stmts.push_back(stmt);
+}
+
+void SQLiteStatementCache::clear()
+{
+    for (auto& [sql, entry] : _entries)
+        for (auto* stmt : entry.stmts)
+            sqlite3_finalize(stmt);
+    _entries.clear();
+    _lru.clear();
+}
+
+SQLite::CachedStatement::CachedStatement(const SQLite& db, std::string_view sql, bool readOnly) : _db(db), _sql(sql)
+{
+    if (readOnly)
+        _reader = _db.acquireReader();
+    if (!_reader)
+    {
+        _stmt = _db.acquireStatement(_sql);
+        return;
+    }
+
+    if ((_stmt = _reader->stmtCache.take(_sql)))
+        return;
+    int ret = sqlite3_prepare_v3(_reader->db, _sql.data(), static_cast<int>(_sql.size()), SQLITE_PREPARE_PERSISTENT, &_stmt, nullptr);
+    if (ret != SQLITE_OK)
+    {
+        LOG_ERROR << "[sqlite3] sql \"" << _sql << "\" prepare error: [" << ret << "] " << sqlite3_errmsg(_reader->db);
+        sqlite3_finalize(_stmt);
+        _stmt = nullptr;
+    }
+}
+
+SQLite::CachedStatement::~CachedStatement()
+{
+    if (_reader)
+    {
+        if (_stmt)
+        {
+            sqlite3_reset(_stmt);
+            sqlite3_clear_bindings(_stmt);
+            _reader->stmtCache.put(_sql, _stmt);
+        }
+        _db.releaseReader(_reader);
+    }
+    else if (_stmt)
+    {
+        _db.releaseStatement(_sql, _stmt);
+    }
+}
+
+bool SQLite::CachedStatement::step()
+{
+    return sqlite3_step(_stmt) == SQLITE_ROW;
+}
+
+int SQLite::CachedStatement::run()
+{
+    int ret = sqlite3_step(_stmt);
+    if (ret != SQLITE_OK && ret != SQLITE_ROW && ret != SQLITE_DONE)
+    {
+        LOG_ERROR << "[sqlite3] " << _db.tag << ": " << " exec " << _sql << ": " << sqlite3_errmsg(sqlite3_db_handle(_stmt));
+        return ret;
+    }
+    return SQLITE_OK;
+}
+
+std::vector<std::vector<std::any>> SQLite::query(const std::string_view zsql, std::initializer_list<std::any> args) const
+{
+    CachedStatement cached(*this, zsql);
+    return fetchRows(cached, zsql, args);
+}
+
+std::vector<std::vector<std::any>> SQLite::queryRead(const std::string_view zsql, std::initializer_list<std::any> args) const
+{
+    CachedStatement cached(*this, zsql, true);
+    return fetchRows(cached, zsql, args);
+}
+
+std::vector<std::vector<std::any>> SQLite::fetchRows(CachedStatement& cached, std::string_view zsql,
+                                                     std::initializer_list<std::any> args) const
+{
+    if (!cached)
+    {
         return {};
     }
+    sqlite3_stmt* stmt = cached.get();
 
     const int columnCount = sqlite3_column_count(stmt);
     if (columnCount == 0)
@@ -108,30 +363,23 @@ std::vector<std::vector<std::any>> SQLite::query(const std::string_view zsql, st
     LOG_VERBOSE << ss.str();
 #endif
 
-    sqlite3_finalize(stmt);
     return out;
 }
 
 int SQLite::exec(const std::string_view zsql, std::initializer_list<std::any> args)
 {
-    _lastSql = zsql;
-
-    sqlite3_stmt* stmt = nullptr;
-    int ret = sqlite3_prepare_v3(_db, zsql.data(), static_cast<int>(zsql.size()), 0, &stmt, nullptr);
-    if (ret != 0)
+    CachedStatement cached(*this, zsql);
+    if (!cached)
     {
-        LOG_ERROR << "[sqlite3] sql \"" << zsql << "\" prepare error: [" << ret << "] " << errmsg();
-        return ret;
+        return sqlite3_errcode(_db);
     }
+    sqlite3_stmt* stmt = cached.get();
 
     sql_bind_any(stmt, args);
 
-    ret = sqlite3_step(stmt);
-
-    if (ret != SQLITE_OK && ret != SQLITE_ROW && ret != SQLITE_DONE)
+    int ret = cached.run();
+    if (ret != SQLITE_OK)
     {
-        LOG_ERROR << "[sqlite3] " << tag << ": " << " exec " << zsql << ": " << errmsg();
-        sqlite3_finalize(stmt);
         return ret;
     }
 
@@ -150,7 +398,6 @@ int SQLite::exec(const std::string_view zsql, std::initializer_list<std::any> ar
         LOG_VERBOSE << ss.str();
 #endif
 
-    sqlite3_finalize(stmt);
     return SQLITE_OK;
 }
 
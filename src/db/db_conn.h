@@ -1,14 +1,21 @@
 #pragma once
 #include <any>
+#include <cstddef>
+#include <list>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <exception>
+#include <memory>
 
 #include <common/types.h>
 
 struct sqlite3;
+struct sqlite3_stmt;
 
 #if defined(_MSC_VER)
   typedef __int64 sqlite_int64;
@@ -27,13 +34,74 @@ inline std::string  ANY_STR(const std::any& a) { return std::any_cast<std::strin
 
 #define SQLITE_OK 0
 
+// Typed bindings, index starts from 1
+void sql_bind(sqlite3_stmt* stmt, int i, int v);
+void sql_bind(sqlite3_stmt* stmt, int i, unsigned v);
+void sql_bind(sqlite3_stmt* stmt, int i, bool v);
+void sql_bind(sqlite3_stmt* stmt, int i, long v);
+void sql_bind(sqlite3_stmt* stmt, int i, long long v);
+void sql_bind(sqlite3_stmt* stmt, int i, double v);
+void sql_bind(sqlite3_stmt* stmt, int i, std::string_view v);
+void sql_bind(sqlite3_stmt* stmt, int i, const std::string& v);
+void sql_bind(sqlite3_stmt* stmt, int i, const char* v);
+void sql_bind(sqlite3_stmt* stmt, int i, std::nullptr_t);
+
+// Typed column reads, index starts from 0. NULL reads as 0 or empty string.
+void sql_column(sqlite3_stmt* stmt, int i, int& out);
+void sql_column(sqlite3_stmt* stmt, int i, bool& out);
+void sql_column(sqlite3_stmt* stmt, int i, long long& out);
+void sql_column(sqlite3_stmt* stmt, int i, double& out);
+void sql_column(sqlite3_stmt* stmt, int i, std::string& out);
+// Points into the statement's buffer; only valid until the next step or reset.
+void sql_column(sqlite3_stmt* stmt, int i, std::string_view& out);
+
+// Idle prepared statements keyed by SQL text. Holds at most `capacity` distinct texts; statements of the
+// least recently used text are finalized first, so SQL built at runtime cannot grow it without bound.
+class SQLiteStatementCache
+{
+public:
+    explicit SQLiteStatementCache(size_t capacity = 64) : _capacity(capacity) {}
+    ~SQLiteStatementCache() { clear(); }
+    SQLiteStatementCache(const SQLiteStatementCache&) = delete;
+    SQLiteStatementCache& operator=(const SQLiteStatementCache&) = delete;
+
+    // Returns nullptr if no idle statement of this SQL is cached.
+    sqlite3_stmt* take(const std::string& sql);
+    void put(const std::string& sql, sqlite3_stmt* stmt);
+    void clear();
+    size_t size() const { return _entries.size(); }
+
+private:
+    struct Entry
+    {
+        std::vector<sqlite3_stmt*> stmts;
+        std::list<std::string>::iterator lru;
+    };
+    size_t _capacity;
+    std::unordered_map<std::string, Entry> _entries;
+    std::list<std::string> _lru;    // most recently used first
+};
+
 class SQLite
 {
 private:
     mutable sqlite3* _db = NULL;
     mutable std::string _lastSql;
     std::string tag;
+    std::string _path;
     bool inTransaction = false;
+
+    // Read-only connections for queryRead*(), opened on demand. A connection is checked out while in use.
+    struct ReadConnection;
+    mutable size_t _maxReaders = 0;
+    mutable std::mutex _readPoolMutex;
+    mutable std::vector<std::unique_ptr<ReadConnection>> _readers;
+    mutable std::vector<ReadConnection*> _idleReaders;
+
+    // Prepared statements keyed by SQL text. A statement is checked out while in use, so concurrent callers
+    // of the same SQL get separate statements instead of sharing one.
+    mutable std::mutex _stmtCacheMutex;
+    mutable SQLiteStatementCache _stmtCache;
 public:
     SQLite() = delete;
     SQLite(const char* path, std::string tag);
@@ -43,11 +111,99 @@ public:
     virtual ~SQLite();
 
 protected:
+    // Switch to WAL journaling and serve queryRead/queryReadAs from up to maxReaders read-only connections,
+    // so readers neither wait for nor block a writer. Readers only see committed data.
+    // Returns false for in-memory DBs or if WAL is not supported; reads then go to the main connection.
+    bool enableReadPool(size_t maxReaders);
+
+    // Checks out a cached prepared statement; bindings are cleared and the statement is reset when returned.
+    // With readOnly, the statement runs on a pooled read-only connection if one is available.
+    class CachedStatement
+    {
+    public:
+        CachedStatement(const SQLite& db, std::string_view sql, bool readOnly = false);
+        ~CachedStatement();
+        CachedStatement(const CachedStatement&) = delete;
+        CachedStatement& operator=(const CachedStatement&) = delete;
+
+        sqlite3_stmt* get() const { return _stmt; }
+        explicit operator bool() const { return _stmt != nullptr; }
+        // Returns true while there is a row to read.
+        bool step();
+        // Runs to completion, returns SQLITE_OK or the error code.
+        int run();
+
+    private:
+        const SQLite& _db;
+        std::string _sql;
+        sqlite3_stmt* _stmt = nullptr;
+        ReadConnection* _reader = nullptr;
+    };
+
     [[nodiscard]] std::vector<std::vector<std::any>> query(std::string_view stmt,
                                                            std::initializer_list<std::any> args = {}) const;
+    // Same as query(), on a read-only connection. See enableReadPool().
+    [[nodiscard]] std::vector<std::vector<std::any>> queryRead(std::string_view stmt,
+                                                               std::initializer_list<std::any> args = {}) const;
     int exec(std::string_view stmt, std::initializer_list<std::any> args = {});
     void commit();
 
+    // Typed variants of query/exec. Arguments are bound without boxing, and rows are decoded straight into tuples:
+    //     for (auto& [md5, size] : queryAs<std::string, long long>("SELECT md5,size FROM song WHERE parent=?", parent))
+    template <typename... Cols, typename... Args>
+    [[nodiscard]] std::vector<std::tuple<Cols...>> queryAs(std::string_view sql, const Args&... args) const
+    {
+        CachedStatement stmt(*this, sql);
+        return fetchAll<Cols...>(stmt, args...);
+    }
+    template <typename... Cols, typename... Args>
+    [[nodiscard]] std::vector<std::tuple<Cols...>> queryReadAs(std::string_view sql, const Args&... args) const
+    {
+        CachedStatement stmt(*this, sql, true);
+        return fetchAll<Cols...>(stmt, args...);
+    }
+    template <typename... Args>
+    int execAs(std::string_view sql, const Args&... args)
+    {
+        CachedStatement stmt(*this, sql);
+        if (!stmt)
+            return -1;
+        bindAll(stmt.get(), args...);
+        return stmt.run();
+    }
+
+private:
+    template <typename... Cols, typename... Args>
+    static std::vector<std::tuple<Cols...>> fetchAll(CachedStatement& stmt, const Args&... args)
+    {
+        std::vector<std::tuple<Cols...>> out;
+        if (!stmt)
+            return out;
+        bindAll(stmt.get(), args...);
+        while (stmt.step())
+        {
+            readRow(stmt.get(), out.emplace_back(), std::index_sequence_for<Cols...>{});
+        }
+        return out;
+    }
+    std::vector<std::vector<std::any>> fetchRows(CachedStatement& stmt, std::string_view sql,
+                                                 std::initializer_list<std::any> args) const;
+    template <typename... Args>
+    static void bindAll(sqlite3_stmt* stmt, const Args&... args)
+    {
+        [[maybe_unused]] int i = 1;
+        (sql_bind(stmt, i++, args), ...);
+    }
+    template <typename Tuple, size_t... I>
+    static void readRow(sqlite3_stmt* stmt, Tuple& row, std::index_sequence<I...>)
+    {
+        (sql_column(stmt, static_cast<int>(I), std::get<I>(row)), ...);
+    }
+    sqlite3_stmt* acquireStatement(const std::string& sql) const;
+    void releaseStatement(const std::string& sql, sqlite3_stmt* stmt) const;
+    ReadConnection* acquireReader() const;
+    void releaseReader(ReadConnection* reader) const;
+
 public:
     void transactionStart();
     void transactionStop();
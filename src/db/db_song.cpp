@@ -4,18 +4,16 @@
 #include <set>
 #include <thread>
 
+#include "common/bounded_queue.h"
 #include "common/chartformat/chartformat_types.h"
 #include "common/log.h"
 #include "common/sysutil.h"
 #include "common/utils.h"
+#include "db_song_watcher.h"
 #include "game/chart/chart_types.h"
 
 #include <re2/re2.h>
 
-#define BOOST_ASIO_NO_EXCEPTIONS
-#include <boost/asio/post.hpp>
-#include <boost/asio/thread_pool.hpp>
-
 const char* CREATE_FOLDER_TABLE_STR =
 "CREATE TABLE IF NOT EXISTS folder( "
 "pathmd5 TEXT PRIMARY KEY UNIQUE NOT NULL, "
@@ -58,9 +56,60 @@ const char* CREATE_SONG_TABLE_STR =
 "bga INTEGER, "                // 27
 "random INTEGER, "             // 28
 "addtime INTEGER, "            // 29
+"filesize INTEGER NOT NULL DEFAULT 0, "  // 30
+"filemtime INTEGER NOT NULL DEFAULT 0, " // 31
+"fileino INTEGER NOT NULL DEFAULT 0, "   // 32
 "CONSTRAINT pk_pf PRIMARY KEY (parent,file) "
 ");";
 static constexpr size_t SONG_PARAM_COUNT = 30;
+
+// Full text index over the searchable columns of song. External content, kept in sync with song by triggers.
+// The trigram tokenizer matches arbitrary substrings, which is what a search box wants for CJK titles too.
+const char* CREATE_SONG_FTS_TABLE_STR =
+"CREATE VIRTUAL TABLE IF NOT EXISTS song_fts USING fts5("
+"title, title2, artist, artist2, genre, version, "
+"content='song', content_rowid='rowid', tokenize='trigram'"
+");";
+const char* CREATE_SONG_FTS_TRIGGERS_STR[] =
+{
+"CREATE TRIGGER IF NOT EXISTS song_fts_ai AFTER INSERT ON song BEGIN "
+"INSERT INTO song_fts(rowid,title,title2,artist,artist2,genre,version) "
+"VALUES(new.rowid,new.title,new.title2,new.artist,new.artist2,new.genre,new.version); "
+"END;",
+"CREATE TRIGGER IF NOT EXISTS song_fts_ad AFTER DELETE ON song BEGIN "
+"INSERT INTO song_fts(song_fts,rowid,title,title2,artist,artist2,genre,version) "
+"VALUES('delete',old.rowid,old.title,old.title2,old.artist,old.artist2,old.genre,old.version); "
+"END;",
+"CREATE TRIGGER IF NOT EXISTS song_fts_au AFTER UPDATE OF title,title2,artist,artist2,genre,version ON song BEGIN "
+"INSERT INTO song_fts(song_fts,rowid,title,title2,artist,artist2,genre,version) "
+"VALUES('delete',old.rowid,old.title,old.title2,old.artist,old.artist2,old.genre,old.version); "
+"INSERT INTO song_fts(rowid,title,title2,artist,artist2,genre,version) "
+"VALUES(new.rowid,new.title,new.title2,new.artist,new.artist2,new.genre,new.version); "
+"END;",
+};
+// Library id and revision identify the DB state for catalog snapshots. The revision is bumped by triggers on
+// every change to song or folder, so no write path can forget it.
+const char* CREATE_LIBRARY_INFO_TABLE_STR =
+"CREATE TABLE IF NOT EXISTS library_info("
+"id INTEGER PRIMARY KEY CHECK (id = 0), "
+"library_id INTEGER NOT NULL, "
+"revision INTEGER NOT NULL"
+");";
+const char* CREATE_LIBRARY_REVISION_TRIGGERS_STR[] =
+{
+"CREATE TRIGGER IF NOT EXISTS library_rev_song_ai AFTER INSERT ON song BEGIN UPDATE library_info SET revision=revision+1; END;",
+"CREATE TRIGGER IF NOT EXISTS library_rev_song_ad AFTER DELETE ON song BEGIN UPDATE library_info SET revision=revision+1; END;",
+"CREATE TRIGGER IF NOT EXISTS library_rev_song_au AFTER UPDATE ON song BEGIN UPDATE library_info SET revision=revision+1; END;",
+"CREATE TRIGGER IF NOT EXISTS library_rev_folder_ai AFTER INSERT ON folder BEGIN UPDATE library_info SET revision=revision+1; END;",
+"CREATE TRIGGER IF NOT EXISTS library_rev_folder_ad AFTER DELETE ON folder BEGIN UPDATE library_info SET revision=revision+1; END;",
+"CREATE TRIGGER IF NOT EXISTS library_rev_folder_au AFTER UPDATE ON folder BEGIN UPDATE library_info SET revision=revision+1; END;",
+};
+
+// Read-only connections for searches from the select scene.
+static constexpr size_t READ_CONNECTION_COUNT = 2;
+
+// Trigram queries need at least this many characters; shorter keys fall back to LIKE.
+static constexpr size_t SONG_FTS_MIN_QUERY_CHARS = 3;
 struct song_all_params
 {
     std::string md5;
@@ -176,16 +225,64 @@ bool convert_bms(const std::shared_ptr<ChartFormatBMSMeta>& chart, const std::ve
 
     return true;
 }
+bool convert_bms(const std::shared_ptr<ChartFormatBMSMeta>& chart, const SongCatalog& catalog, SongCatalog::Row row)
+{
+    const auto& c = catalog.songs();
+    if (row >= catalog.songCount()) return false;
+
+    const uint8_t flags = c.flags[row];
+    chart->fileHash       = c.md5[row];
+    chart->folderHash     = c.parent[row];
+    chart->fileName       = PathFromUTF8(catalog.str(c.file[row]));
+    chart->title          = catalog.str(c.title[row]);
+    chart->title2         = catalog.str(c.title2[row]);
+    chart->artist         = catalog.str(c.artist[row]);
+    chart->artist2        = catalog.str(c.artist2[row]);
+    chart->genre          = catalog.str(c.genre[row]);
+    chart->version        = catalog.str(c.version[row]);
+    chart->levelEstimated = c.level[row];
+    chart->startBPM       = c.bpm[row];
+    chart->minBPM         = c.minbpm[row];
+    chart->maxBPM         = c.maxbpm[row];
+    chart->totalLength    = c.length[row];
+    chart->totalNotes     = c.totalnotes[row];
+    chart->stagefile      = catalog.str(c.stagefile[row]);
+    chart->banner         = catalog.str(c.bannerfile[row]);
+    chart->gamemode       = c.gamemode[row];
+    chart->rank           = c.judgerank[row];
+    chart->total          = c.total[row];
+    chart->playLevel      = c.playlevel[row];
+    chart->difficulty     = c.difficulty[row];
+    chart->haveLN         = flags & SongCatalog::SONG_LN;
+    chart->haveMine       = flags & SongCatalog::SONG_MINE;
+    chart->haveMetricMod  = flags & SongCatalog::SONG_METRIC_MOD;
+    chart->haveStop       = flags & SongCatalog::SONG_STOP;
+    chart->haveBPMChange  = c.maxbpm[row] != c.minbpm[row];
+    chart->haveBGA        = flags & SongCatalog::SONG_BGA;
+    chart->haveRandom     = flags & SongCatalog::SONG_RANDOM;
+    chart->addTime        = c.addtime[row];
+
+    if (chart->totalNotes > 0)
+    {
+        chart->haveNote = true;
+        chart->notes_total = chart->totalNotes;
+    }
+
+    return true;
+}
 
 
 SongDB::SongDB(const char* path) : SQLite(path, "SONG")
 {
+    // select scene reads must not queue behind a background scan
+    enableReadPool(READ_CONNECTION_COUNT);
+
     if (exec("PRAGMA cache_size = -512000") != SQLITE_OK)
     {
         LOG_WARNING << "[SongDB] Set cache_size ERROR! " << errmsg();
     }
 
-    poolThreadCount = std::thread::hardware_concurrency() - 1;
+    parseThreadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
 
     if (exec(CREATE_FOLDER_TABLE_STR) != SQLITE_OK)
     {
@@ -209,6 +306,19 @@ SongDB::SongDB(const char* path) : SQLite(path, "SONG")
         abort();
     }
 
+    // file signature columns were added later
+    if (auto q = query("SELECT COUNT(*) FROM pragma_table_info('song') WHERE name='filesize'"); !q.empty() && ANY_INT(q[0][0]) == 0)
+    {
+        LOG_INFO << "[SongDB] Adding file signature columns to table song";
+        if (exec("ALTER TABLE song ADD COLUMN filesize INTEGER NOT NULL DEFAULT 0") != SQLITE_OK ||
+            exec("ALTER TABLE song ADD COLUMN filemtime INTEGER NOT NULL DEFAULT 0") != SQLITE_OK ||
+            exec("ALTER TABLE song ADD COLUMN fileino INTEGER NOT NULL DEFAULT 0") != SQLITE_OK)
+        {
+            LOG_ERROR << "[SongDB] Add file signature columns ERROR! " << errmsg();
+            abort();
+        }
+    }
+
     if (exec("CREATE INDEX IF NOT EXISTS index_parent ON folder(parent)") != SQLITE_OK)
     {
         LOG_ERROR << "[SongDB] Create parent index for folder ERROR! " << errmsg();
@@ -227,135 +337,268 @@ SongDB::SongDB(const char* path) : SQLite(path, "SONG")
         LOG_ERROR << "[SongDB] Create gamemode index for song ERROR! " << errmsg();
     }
 
-}
-
-SongDB::~SongDB()
-{
-    if (threadPool)
+    // random library id, so a snapshot of a deleted and recreated DB is never taken for current
+    if (exec(CREATE_LIBRARY_INFO_TABLE_STR) != SQLITE_OK ||
+        exec("INSERT OR IGNORE INTO library_info(id,library_id,revision) VALUES(0,random(),0)") != SQLITE_OK)
     {
-        delete (boost::asio::thread_pool*)threadPool;
-        threadPool = nullptr;
+        LOG_ERROR << "[SongDB] Create table library_info ERROR! " << errmsg();
+        abort();
     }
-}
-
-bool SongDB::addChart(const HashMD5& folder, const Path& path)
-{
-    auto closure = [&]() -> bool
+    for (const char* sql : CREATE_LIBRARY_REVISION_TRIGGERS_STR)
     {
-        decltype(path.filename().u8string()) filename;
-        try
+        if (exec(sql) != SQLITE_OK)
         {
-            filename = path.filename().u8string();
+            LOG_ERROR << "[SongDB] Create library revision trigger ERROR! " << errmsg();
+            abort();
         }
-        catch (const std::exception& e)
+    }
+    if (std::string_view(path) != ":memory:" && *path != '\0')
+    {
+        snapshotPath = PathFromUTF8(path);
+        snapshotPath += ".catalog";
+    }
+
+    // search index, optional: sqlite may be built without FTS5 or with a version lacking the trigram tokenizer
+    const bool ftsExists = !queryAs<long long>("SELECT 1 FROM sqlite_master WHERE type='table' AND name='song_fts'").empty();
+    if (exec(CREATE_SONG_FTS_TABLE_STR) != SQLITE_OK)
+    {
+        LOG_WARNING << "[SongDB] Create search index ERROR, searching without index. " << errmsg();
+    }
+    else
+    {
+        ftsAvailable = true;
+        for (const char* sql : CREATE_SONG_FTS_TRIGGERS_STR)
         {
-            LOG_WARNING << "[SongDB] " << e.what() << ": " << path.filename();
-            return false;
+            if (exec(sql) != SQLITE_OK)
+            {
+                LOG_ERROR << "[SongDB] Create search index trigger ERROR! " << errmsg();
+                ftsAvailable = false;
+            }
         }
-
-        if (auto result = query("SELECT md5 FROM song WHERE parent=? AND file=?",
-            { folder.hexdigest(), filename }); !result.empty() && !result[0].empty())
+        if (ftsAvailable && !ftsExists)
         {
-            // check if file exists in db
-            HashMD5 dbmd5 = ANY_STR(result[0][0]);
-            HashMD5 filemd5 = md5file(path);
-            if (dbmd5 == filemd5)
+            LOG_INFO << "[SongDB] Building search index";
+            if (exec("INSERT INTO song_fts(song_fts) VALUES('rebuild')") != SQLITE_OK)
             {
-                return false;
+                LOG_ERROR << "[SongDB] Build search index ERROR! " << errmsg();
+                ftsAvailable = false;
             }
-            // remove existing entry
-            removeChart(path, folder);
         }
+    }
+}
+
+struct SongDB::ScanPipeline
+{
+    struct Task
+    {
+        HashMD5 folder;
+        Path path;
+    };
+
+    // Queue depths bound memory use of a scan; parsed charts are much larger than paths.
+    static constexpr size_t PARSE_QUEUE_DEPTH = 1024;
+    static constexpr size_t WRITE_QUEUE_DEPTH = 256;
+    // Writer commits every N rows or every T, whichever comes first.
+    static constexpr size_t WRITE_BATCH_ROWS = 2000;
+    static constexpr auto WRITE_BATCH_INTERVAL = std::chrono::seconds(2);
+
+    lunaticvibes::BoundedQueue<Task> parseQueue{ PARSE_QUEUE_DEPTH };
+    lunaticvibes::BoundedQueue<ParsedChart> writeQueue{ WRITE_QUEUE_DEPTH };
+    std::vector<std::thread> parseWorkers;
+    std::thread writer;
+};
+
+SongDB::~SongDB()
+{
+    stopLoading();
+    stopWatching();
+    if (backgroundScan.valid())
+        backgroundScan.wait();
+    if (cacheBuild.valid())
+        cacheBuild.wait();
+    if (folderRefresh.valid())
+        folderRefresh.wait();
+    waitLoadingFinish();
+}
+
+bool SongDB::parseChart(const HashMD5& folder, const Path& path, ParsedChart& out) const
+{
+    decltype(path.filename().u8string()) filename;
+    try
+    {
+        filename = path.filename().u8string();
+    }
+    catch (const std::exception& e)
+    {
+        LOG_WARNING << "[SongDB] " << e.what() << ": " << path.filename();
+        return false;
+    }
+
+    out.folder = folder;
+    out.path = path;
+    if (!getFileSignature(path, out.signature))
+    {
+        LOG_WARNING << "[SongDB] File stat error: " << path;
+        return false;
+    }
 
-        std::shared_ptr<ChartFormatBase> c = ChartFormatBase::createFromFile(path, 2356);
-        if (c == nullptr)
+    lunaticvibes::MappedFile file;
+    if (auto result = queryAs<std::string, long long, long long, long long>(
+        "SELECT md5,filesize,filemtime,fileino FROM song WHERE parent=? AND file=?", folder.hexdigest(), filename);
+        !result.empty())
+    {
+        // check if file exists in db
+        FileSignature dbSignature;
+        dbSignature.size = std::get<1>(result[0]);
+        dbSignature.mtime = std::get<2>(result[0]);
+        dbSignature.inode = std::get<3>(result[0]);
+        if (!scanAlwaysHash && dbSignature == out.signature)
         {
-            LOG_WARNING << "[SongDB] File error: " << path;
             return false;
         }
 
-        auto s = ChartObjectBase::createFromChartFormat(0, c);
-        if (s == nullptr)
+        if (!file.open(path))
         {
-            LOG_WARNING << "[SongDB] File parsing error: " << path;
+            LOG_WARNING << "[SongDB] File error: " << path;
             return false;
         }
+        addChartHashed++;
+        HashMD5 dbmd5 = std::get<0>(result[0]);
+        HashMD5 filemd5 = md5(std::string_view(file.data(), file.size()));
+        if (dbmd5 == filemd5)
+        {
+            // touched but not modified; remember the new signature so the next scan skips hashing
+            out.refreshSignature = dbSignature != out.signature;
+            return out.refreshSignature;
+        }
+        // existing entry is removed by the writer
+        out.replace = true;
+    }
 
+    // the same buffer is used for hashing and parsing, so the file is read only once
+    if (!file.isOpen() && !file.open(path))
+    {
+        LOG_WARNING << "[SongDB] File error: " << path;
+        return out.replace;
+    }
+
+    // length and note count are calculated by the parser, no need to build the note lists
+    std::shared_ptr<ChartFormatBase> c = ChartFormatBase::createMetadataFromBuffer(path, std::string_view(file.data(), file.size()), 2356);
+    if (c == nullptr)
+    {
+        LOG_WARNING << "[SongDB] File error: " << path;
+        return out.replace;
+    }
+
+    out.chart = c;
+    out.length = c->totalLength;
+    out.totalNotes = c->totalNotes;
+    return true;
+}
+
+bool SongDB::insertChart(const ParsedChart& parsed)
+{
+    const auto& c = parsed.chart;
+    const auto& path = parsed.path;
+    const auto& folder = parsed.folder;
+
+    if (parsed.refreshSignature)
+    {
+        if (SQLITE_OK != execAs("UPDATE song SET filesize=?,filemtime=?,fileino=? WHERE parent=? AND file=?",
+            parsed.signature.size, parsed.signature.mtime, parsed.signature.inode, folder.hexdigest(), path.filename().u8string()))
         {
-            std::unique_lock l(addCurrentPathMutex, std::try_to_lock);
-            if (l.owns_lock())
-            {
-                addCurrentPath = path.u8string();
-            }
+            LOG_WARNING << "[SongDB] Update chart file signature error: " << path << ": " << errmsg();
         }
+        return false;
+    }
+    if (parsed.replace)
+    {
+        removeChart(path, folder);
+    }
+    if (c == nullptr)
+    {
+        return false;
+    }
 
-        switch (c->type())
+    {
+        std::unique_lock l(addCurrentPathMutex, std::try_to_lock);
+        if (l.owns_lock())
         {
-        case eChartFormat::UNKNOWN:
-            LOG_ERROR << "eChartFormat::UNKNOWN";
-            break;
-        case eChartFormat::BMS:
+            addCurrentPath = path.u8string();
+        }
+    }
+
+    switch (c->type())
+    {
+    case eChartFormat::UNKNOWN:
+        LOG_ERROR << "eChartFormat::UNKNOWN";
+        break;
+    case eChartFormat::BMS:
+    case eChartFormat::BMSON:
+    {
+        auto bmsc = std::dynamic_pointer_cast<ChartFormatBMS>(c);
+        assert(bmsc != nullptr);
+        if (SQLITE_OK == execAs("INSERT INTO song("
+            "md5,parent,type,file,title,title2,artist,artist2,genre,version,"
+            "level,bpm,minbpm,maxbpm,length,totalnotes,stagefile,bannerfile,gamemode,judgerank,"
+            "total,playlevel,difficulty,longnote,landmine,metricmod,stop,bga,random,addtime,"
+            "filesize,filemtime,fileino) "
+            "VALUES(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?);",
+                c->fileHash.hexdigest(),
+                folder.hexdigest(),
+                int(c->type()),
+                c->fileName.filename().u8string(),
+                c->title,
+                c->title2,
+                c->artist,
+                c->artist2,
+                c->genre,
+                c->version,
+
+                c->levelEstimated,
+                c->startBPM,
+                c->minBPM,
+                c->maxBPM,
+                parsed.length,
+                parsed.totalNotes,
+                c->stagefile,
+                c->banner,
+                bmsc->gamemode,
+                bmsc->rank,
+
+                bmsc->total,
+                bmsc->playLevel,
+                bmsc->difficulty,
+                bmsc->haveLN,
+                bmsc->haveMine,
+                bmsc->haveMetricMod,
+                bmsc->haveStop,
+                bmsc->haveBGA,
+                bmsc->haveRandom,
+                getFileTimeNow(),
+
+                parsed.signature.size,
+                parsed.signature.mtime,
+                parsed.signature.inode))
         {
-            auto bmsc = std::dynamic_pointer_cast<ChartFormatBMS>(c);
-            assert(bmsc != nullptr);
-            if (SQLITE_OK == exec("INSERT INTO song("
-                "md5,parent,type,file,title,title2,artist,artist2,genre,version,"
-                "level,bpm,minbpm,maxbpm,length,totalnotes,stagefile,bannerfile,gamemode,judgerank,"
-                "total,playlevel,difficulty,longnote,landmine,metricmod,stop,bga,random,addtime) "
-                "VALUES(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?);",
-                {
-                    c->fileHash.hexdigest(),
-                    folder.hexdigest(),
-                    int(c->type()),
-                    c->fileName.filename().u8string(),
-                    c->title,
-                    c->title2,
-                    c->artist,
-                    c->artist2,
-                    c->genre,
-                    c->version,
-
-                    c->levelEstimated,
-                    c->startBPM,
-                    c->minBPM,
-                    c->maxBPM,
-                    s->getTotalLength().norm() / 1000,
-                    static_cast<int>(s->getNoteTotalCount()),
-                    c->stagefile,
-                    c->banner,
-                    bmsc->gamemode,
-                    bmsc->rank,
-
-                    bmsc->total,
-                    bmsc->playLevel,
-                    bmsc->difficulty,
-                    bmsc->haveLN,
-                    bmsc->haveMine,
-                    bmsc->haveMetricMod,
-                    bmsc->haveStop,
-                    bmsc->haveBGA,
-                    bmsc->haveRandom,
-                    getFileTimeNow()
-                }))
-            {
-                return true;
-            }
-            else
-            {
-                LOG_WARNING << "[SongDB] Insert chart into db error: " << path << ": " << errmsg();
-                return false;
-            }
-            break;
+            return true;
         }
-        case eChartFormat::BMSON:
-            LOG_ERROR << "eChartFormat::BMSON";
-            break;
+        else
+        {
+            LOG_WARNING << "[SongDB] Insert chart into db error: " << path << ": " << errmsg();
+            return false;
         }
+        break;
+    }
+    }
 
-        return false;
-    };
+    return false;
+}
 
-    bool ret = closure();
+bool SongDB::addChart(const HashMD5& folder, const Path& path)
+{
+    ParsedChart parsed;
+    bool ret = parseChart(folder, path, parsed) && insertChart(parsed);
     if (ret) addChartSuccess++;
 
     addChartTaskFinishCount++;
@@ -364,7 +607,7 @@ bool SongDB::addChart(const HashMD5& folder, const Path& path)
 
 bool SongDB::removeChart(const Path& path, const HashMD5& parent)
 {
-    if (SQLITE_OK != exec("DELETE FROM song WHERE file=? AND parent=?", { path.filename().u8string(), parent.hexdigest()}))
+    if (SQLITE_OK != execAs("DELETE FROM song WHERE file=? AND parent=?", path.filename().u8string(), parent.hexdigest()))
     {
         LOG_WARNING << "[SongDB] Delete chart from db error: " << path << ": " << errmsg();
         return false;
@@ -374,7 +617,7 @@ bool SongDB::removeChart(const Path& path, const HashMD5& parent)
 
 bool SongDB::removeChart(const HashMD5& md5, const HashMD5& parent)
 {
-    if (SQLITE_OK != exec("DELETE FROM song WHERE md5=? AND parent=?", { md5.hexdigest(), parent.hexdigest()}))
+    if (SQLITE_OK != execAs("DELETE FROM song WHERE md5=? AND parent=?", md5.hexdigest(), parent.hexdigest()))
     {
         LOG_WARNING << "[SongDB] Delete chart from db error: " << md5.hexdigest() << ": " << errmsg();
         return false;
@@ -387,41 +630,70 @@ std::vector<std::shared_ptr<ChartFormatBase>> SongDB::findChartByName(const Hash
 {
     LOG_INFO << "[SongDB] Search for songs matching: " << tagRaw;
 
-    std::string tag = tagRaw;
-    static const std::pair<RE2, re2::StringPiece> search_replace_pattern[]
-    {
-        {"%", "\\\\%"},
-        {"_", "\\\\_"},
-    };
-    for (const auto& [in, out] : search_replace_pattern)
+    // empty matches everything
+    const std::string parentFilter = folder != ROOT_FOLDER_HASH ? folder.hexdigest() : "";
+
+    size_t tagChars = 0;
+    for (char c : tagRaw)
+        if ((static_cast<unsigned char>(c) & 0xC0) != 0x80)
+            ++tagChars;
+
+    std::vector<std::vector<std::any>> result;
+    if (ftsAvailable && tagChars >= SONG_FTS_MIN_QUERY_CHARS)
     {
-        RE2::GlobalReplace(&tag, in, out);
+        // search the whole key as one phrase, quotes are doubled inside
+        std::string phrase = "\"";
+        for (char c : tagRaw)
+        {
+            if (c == '"') phrase += '"';
+            phrase += c;
+        }
+        phrase += '"';
+
+        // title hits rank above artist hits, which rank above genre/version hits
+        std::stringstream ss;
+        ss << "SELECT song.* FROM song_fts JOIN song ON song.rowid=song_fts.rowid "
+           << "WHERE song_fts MATCH ? AND (?='' OR song.parent=?) "
+           << "ORDER BY bm25(song_fts, 10.0, 5.0, 4.0, 2.0, 1.0, 1.0)";
+        if (limit > 0)
+            ss << " LIMIT " << limit;
+        result = queryRead(ss.str(), { phrase, parentFilter, parentFilter });
     }
+    else
+    {
+        std::string tag = tagRaw;
+        static const std::pair<RE2, re2::StringPiece> search_replace_pattern[]
+        {
+            {"%", "\\\\%"},
+            {"_", "\\\\_"},
+        };
+        for (const auto& [in, out] : search_replace_pattern)
+        {
+            RE2::GlobalReplace(&tag, in, out);
+        }
 
-    std::stringstream ss;
-    ss << "SELECT * FROM song WHERE ";
-    if (folder != ROOT_FOLDER_HASH) 
-        ss << "parent=" << folder.hexdigest() << " AND ";
-    ss << "(title   LIKE '%' || ? || '%' ESCAPE '\\' OR "
-        << "title2  LIKE '%' || ? || '%' ESCAPE '\\' OR "
-        << "artist  LIKE '%' || ? || '%' ESCAPE '\\' OR "
-        << "artist2 LIKE '%' || ? || '%' ESCAPE '\\' OR "
-        << "genre   LIKE '%' || ? || '%' ESCAPE '\\' OR "
-        << "version LIKE '%' || ? || '%' ESCAPE '\\' )";
-    if (limit > 0) 
-        ss << " LIMIT " << limit;
-
-    std::string strSql = ss.str();
-    auto result = query(strSql.c_str(), {tag, tag, tag, tag, tag, tag});
+        std::stringstream ss;
+        ss << "SELECT * FROM song WHERE (?='' OR parent=?) AND ";
+        ss << "(title   LIKE '%' || ? || '%' ESCAPE '\\' OR "
+            << "title2  LIKE '%' || ? || '%' ESCAPE '\\' OR "
+            << "artist  LIKE '%' || ? || '%' ESCAPE '\\' OR "
+            << "artist2 LIKE '%' || ? || '%' ESCAPE '\\' OR "
+            << "genre   LIKE '%' || ? || '%' ESCAPE '\\' OR "
+            << "version LIKE '%' || ? || '%' ESCAPE '\\' )";
+        if (limit > 0)
+            ss << " LIMIT " << limit;
+        result = queryRead(ss.str(), { parentFilter, parentFilter, tag, tag, tag, tag, tag, tag });
+    }
 
     std::vector<std::shared_ptr<ChartFormatBase>> ret;
     for (const auto& r : result)
     {
-        switch (eChartFormat(ANY_INT(r[3])))
+        switch (const auto type = eChartFormat(ANY_INT(r[3])))
         {
         case eChartFormat::BMS:
+        case eChartFormat::BMSON:
         {
-            auto p = std::make_shared<ChartFormatBMSMeta>();
+            auto p = std::make_shared<ChartFormatBMSMeta>(type);
             if (convert_bms(p, r))
             {
                 if (p->fileName.is_absolute())
@@ -457,19 +729,20 @@ std::vector<std::shared_ptr<ChartFormatBase>> SongDB::findChartByHash(const Hash
 
     std::vector<std::shared_ptr<ChartFormatBase>> ret;
 
-    if (songQueryHashMap.find(target) == songQueryHashMap.end())
+    auto catalog = getCatalog();
+    if (!catalog)
     {
         return ret;
     }
-    for (const auto& index : songQueryHashMap.at(target))
+    for (SongCatalog::Row row : catalog->findSongsByHash(target))
     {
-        const auto& r = songQueryPool[index];
-        switch (eChartFormat(ANY_INT(r[3])))
+        switch (const auto type = eChartFormat(catalog->songs().type[row]))
         {
         case eChartFormat::BMS:
+        case eChartFormat::BMSON:
         {
-            auto p = std::make_shared<ChartFormatBMSMeta>();
-            if (convert_bms(p, r))
+            auto p = std::make_shared<ChartFormatBMSMeta>(type);
+            if (convert_bms(p, *catalog, row))
             {
                 if (p->fileName.is_absolute())
                 {
@@ -521,23 +794,20 @@ std::vector<std::shared_ptr<ChartFormatBase>> SongDB::findChartFromTime(const Ha
 {
     LOG_INFO << "[SongDB] Search from epoch time " << addTime;
 
-    std::stringstream ss;
-    ss << "SELECT * FROM song WHERE ";
-    if (folder != ROOT_FOLDER_HASH)
-        ss << "parent=" << folder.hexdigest() << " AND ";
-    ss << "addtime>=?";
-
-    std::string strSql = ss.str();
-    auto result = query(strSql.c_str(), { (long long)addTime });
+    // empty matches everything
+    const std::string parentFilter = folder != ROOT_FOLDER_HASH ? folder.hexdigest() : "";
+    auto result = queryRead("SELECT * FROM song WHERE (?='' OR parent=?) AND addtime>=?",
+                            { parentFilter, parentFilter, (long long)addTime });
 
     std::vector<std::shared_ptr<ChartFormatBase>> ret;
     for (const auto& r : result)
     {
-        switch (eChartFormat(ANY_INT(r[3])))
+        switch (const auto type = eChartFormat(ANY_INT(r[3])))
         {
         case eChartFormat::BMS:
+        case eChartFormat::BMSON:
         {
-            auto p = std::make_shared<ChartFormatBMSMeta>();
+            auto p = std::make_shared<ChartFormatBMSMeta>(type);
             if (convert_bms(p, r))
             {
                 if (p->fileName.is_absolute())
@@ -572,63 +842,171 @@ void SongDB::prepareCache()
 {
     LOG_DEBUG << "[SongDB] prepareCache ";
 
-    // compress db i/o
-    freeCache();
+    std::unique_lock l(scanMutex);
+
+    // the current catalog stays readable while the next one is built
+    const unsigned generation = libraryGeneration;
+
+    auto next = std::make_unique<SongCatalog>();
+    {
+        size_t songCount = 0, folderCount = 0;
+        if (auto q = queryAs<long long, long long>("SELECT (SELECT COUNT(*) FROM song), (SELECT COUNT(*) FROM folder)"); !q.empty())
+        {
+            songCount = static_cast<size_t>(std::get<0>(q[0]));
+            folderCount = static_cast<size_t>(std::get<1>(q[0]));
+        }
+        next->reserve(songCount, folderCount);
+    }
+
+    // read text in place and intern it, so no per-row strings are allocated
+    auto readStr = [&](sqlite3_stmt* stmt, int i)
+    {
+        std::string_view v;
+        sql_column(stmt, i, v);
+        return next->intern(v);
+    };
+    auto readHash = [&](sqlite3_stmt* stmt, int i)
+    {
+        std::string_view v;
+        sql_column(stmt, i, v);
+        return v.empty() ? HashMD5() : HashMD5(std::string(v));
+    };
+    auto readInt = [&](sqlite3_stmt* stmt, int i)
+    {
+        long long v;
+        sql_column(stmt, i, v);
+        return v;
+    };
+    auto readReal = [&](sqlite3_stmt* stmt, int i)
+    {
+        double v;
+        sql_column(stmt, i, v);
+        return v;
+    };
 
-    size_t count = 0;
-    for (auto& row : query("SELECT * FROM song"))
+    if (CachedStatement stmt(*this, "SELECT md5,parent,file,type,title,title2,artist,artist2,genre,version,"
+                                    "level,bpm,minbpm,maxbpm,length,totalnotes,stagefile,bannerfile,gamemode,judgerank,"
+                                    "total,playlevel,difficulty,longnote,landmine,metricmod,stop,bga,random,addtime FROM song");
+        stmt)
     {
-        songQueryHashMap[HashMD5(ANY_STR(row[0]))].push_back(count);
-        songQueryParentMap[HashMD5(ANY_STR(row[1]))].push_back(count);
-        songQueryPool.push_back(std::move(row));
-        count++;
+        auto& c = next->songColumns();
+        while (stmt.step())
+        {
+            sqlite3_stmt* r = stmt.get();
+            c.md5.push_back(readHash(r, 0));
+            c.parent.push_back(readHash(r, 1));
+            c.file.push_back(readStr(r, 2));
+            c.type.push_back(static_cast<int32_t>(readInt(r, 3)));
+            c.title.push_back(readStr(r, 4));
+            c.title2.push_back(readStr(r, 5));
+            c.artist.push_back(readStr(r, 6));
+            c.artist2.push_back(readStr(r, 7));
+            c.genre.push_back(readStr(r, 8));
+            c.version.push_back(readStr(r, 9));
+            c.level.push_back(readReal(r, 10));
+            c.bpm.push_back(readReal(r, 11));
+            c.minbpm.push_back(readReal(r, 12));
+            c.maxbpm.push_back(readReal(r, 13));
+            c.length.push_back(static_cast<int32_t>(readInt(r, 14)));
+            c.totalnotes.push_back(static_cast<int32_t>(readInt(r, 15)));
+            c.stagefile.push_back(readStr(r, 16));
+            c.bannerfile.push_back(readStr(r, 17));
+            c.gamemode.push_back(static_cast<int32_t>(readInt(r, 18)));
+            c.judgerank.push_back(static_cast<int32_t>(readInt(r, 19)));
+            c.total.push_back(static_cast<int32_t>(readInt(r, 20)));
+            c.playlevel.push_back(static_cast<int32_t>(readInt(r, 21)));
+            c.difficulty.push_back(static_cast<int32_t>(readInt(r, 22)));
+            uint8_t flags = 0;
+            if (readInt(r, 23)) flags |= SongCatalog::SONG_LN;
+            if (readInt(r, 24)) flags |= SongCatalog::SONG_MINE;
+            if (readInt(r, 25)) flags |= SongCatalog::SONG_METRIC_MOD;
+            if (readInt(r, 26)) flags |= SongCatalog::SONG_STOP;
+            if (readInt(r, 27)) flags |= SongCatalog::SONG_BGA;
+            if (readInt(r, 28)) flags |= SongCatalog::SONG_RANDOM;
+            c.flags.push_back(flags);
+            c.addtime.push_back(readInt(r, 29));
+        }
     }
 
-    count = 0;
-    for (auto& row : query("SELECT * FROM folder"))
+    if (CachedStatement stmt(*this, "SELECT pathmd5,parent,name,type,path,modtime FROM folder"); stmt)
     {
-        folderQueryHashMap[HashMD5(ANY_STR(row[0]))].push_back(count);
-        if (row[1].has_value()) 
-            folderQueryParentMap[HashMD5(ANY_STR(row[1]))].push_back(count);
-        folderQueryPool.push_back(std::move(row));
-        count++;
+        auto& c = next->folderColumns();
+        while (stmt.step())
+        {
+            sqlite3_stmt* r = stmt.get();
+            c.pathmd5.push_back(readHash(r, 0));
+            c.parent.push_back(readHash(r, 1));
+            c.name.push_back(readStr(r, 2));
+            c.type.push_back(static_cast<int32_t>(readInt(r, 3)));
+            c.path.push_back(readStr(r, 4));
+            c.modtime.push_back(readInt(r, 5));
+        }
     }
+
+    next->finalize();
+    LOG_DEBUG << "[SongDB] Cached " << next->songCount() << " charts, " << next->folderCount() << " folders, "
+              << next->memoryUsage() / 1024 << " KiB";
+
+    std::shared_ptr<const SongCatalog> built = std::move(next);
+    setCatalog(built);
+    cacheGeneration = generation;
+
+    if (!snapshotPath.empty())
+        built->saveSnapshot(snapshotPath, getSnapshotKey());
+}
+
+void SongDB::prepareCacheAsync()
+{
+    if (cacheBuild.valid() && cacheBuild.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+
+    cacheBuild = std::async(std::launch::async, [this]
+    {
+        SetThreadName("SongDB cache");
+        prepareCache();
+    });
 }
 
 void SongDB::freeCache()
 {
-    songQueryPool.clear();
-    songQueryPool.shrink_to_fit();
-    songQueryHashMap.clear();
-    songQueryParentMap.clear();
-    folderQueryPool.clear();
-    folderQueryPool.shrink_to_fit();
-    folderQueryHashMap.clear();
-    folderQueryParentMap.clear();
+    setCatalog(nullptr);
 }
 
-int SongDB::initializeFolders(const std::vector<Path>& paths)
+bool SongDB::loadCacheSnapshot()
 {
-    resetAddSummary();
+    if (snapshotPath.empty())
+        return false;
 
-    std::future<void> sessionFuture;
-    std::chrono::system_clock::time_point sessionTimestamp = std::chrono::system_clock::now();
+    std::unique_lock l(scanMutex);
+    auto loaded = SongCatalog::loadSnapshot(snapshotPath, getSnapshotKey());
+    if (!loaded)
+        return false;
 
-    bool inAddFolderSession = true;
-    transactionStart();
-    sessionFuture = std::async(std::launch::async, [&]()
-        {
-            while (inAddFolderSession)
-            {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                if (inAddFolderSession && std::chrono::system_clock::now() - sessionTimestamp >= std::chrono::seconds(10))
-                {
-                    sessionTimestamp = std::chrono::system_clock::now();
-                    transactionStop();
-                    transactionStart();
-                }
-            }
-        });
+    LOG_INFO << "[SongDB] Loaded catalog snapshot: " << loaded->songCount() << " charts, " << loaded->folderCount() << " folders";
+    setCatalog(std::move(loaded));
+    cacheGeneration = libraryGeneration.load();
+    return true;
+}
+
+SongCatalog::SnapshotKey SongDB::getSnapshotKey() const
+{
+    SongCatalog::SnapshotKey key;
+    if (auto q = queryAs<long long, long long>("SELECT library_id,revision FROM library_info WHERE id=0"); !q.empty())
+    {
+        key.libraryId = std::get<0>(q[0]);
+        key.revision = std::get<1>(q[0]);
+    }
+    return key;
+}
+
+int SongDB::initializeFolders(const std::vector<Path>& paths, unsigned stopToken)
+{
+    std::unique_lock l(scanMutex);
+    resetAddSummary();
+    scanStopToken = stopToken;
+
+    // start the writer early so folder updates from the walk also go into its batched transactions
+    startScanPipeline();
 
     int count = 0;
     for (const auto& p : paths)
@@ -638,27 +1016,57 @@ int SongDB::initializeFolders(const std::vector<Path>& paths)
         LOG_INFO << "[SongDB] " << p << ": added " << subCount << " entries";
     }
 
-    inAddFolderSession = false;
-    transactionStop();
-    sessionFuture.wait_for(std::chrono::seconds(10));
-
     waitLoadingFinish();
 
     return count;
 }
 
-int SongDB::addSubFolder(Path path, const HashMD5& parentHash)
+void SongDB::initializeFoldersAsync(const std::vector<Path>& paths)
 {
-    LOG_VERBOSE << "[SongDB] Add folder: " << path;
+    if (backgroundScan.valid())
+        backgroundScan.wait();
 
-    path = (path / ".").lexically_normal();
+    backgroundScan = std::async(std::launch::async, [this, paths, stopToken = stopGeneration.load()]
+    {
+        SetThreadName("SongDB scan");
+        const auto before = getSnapshotKey();
+        initializeFolders(paths, stopToken);
+        if (getSnapshotKey() != before)
+        {
+            LOG_INFO << "[SongDB] Library changed during background scan";
+            libraryGeneration++;
+        }
+    });
+}
 
-    if (!fs::is_directory(path))
+bool SongDB::refreshSubFolderAsync(const Path& path, const HashMD5& parent, std::function<void()> onFinished)
+{
+    if (folderRefresh.valid() && folderRefresh.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return false;
+
+    folderRefresh = std::async(std::launch::async, [this, path, parent, onFinished = std::move(onFinished), stopToken = stopGeneration.load()]
     {
-        LOG_WARNING << "[SongDB] Add folder fail: path is not folder (" << path << ")";
-        return -1;
-    }
+        SetThreadName("SongDB refresh");
+        std::unique_lock l(scanMutex);
+        resetAddSummary();
+        scanStopToken = stopToken;
+        addSubFolder(path, parent);
+        waitLoadingFinish();
+
+        LOG_INFO << "[SongDB] Building chart hash cache...";
+        prepareCache();
+        LOG_INFO << "[SongDB] Building chart hash cache finished.";
+
+        if (onFinished)
+            onFinished();
+    });
+    return true;
+}
 
+// Folder paths are stored normalized, absolute unless they are sub folders inside the executable folder.
+static Path normalizeFolderPath(Path path, const HashMD5& parentHash)
+{
+    path = (path / ".").lexically_normal();
     if (isParentPath(executablePath, path))
     {
         if (parentHash.empty())
@@ -675,20 +1083,34 @@ int SongDB::addSubFolder(Path path, const HashMD5& parentHash)
     {
         path = fs::absolute(path);
     }
+    return path;
+}
+
+int SongDB::addSubFolder(Path path, const HashMD5& parentHash)
+{
+    LOG_VERBOSE << "[SongDB] Add folder: " << path;
+
+    if (!fs::is_directory(path))
+    {
+        LOG_WARNING << "[SongDB] Add folder fail: path is not folder (" << path << ")";
+        return -1;
+    }
+
+    path = normalizeFolderPath(path, parentHash);
 
     // check if the folder is already added
     int count = 0;
     HashMD5 folderHash = md5(path.u8string());
     long long folderModifyTime = getFileLastWriteTime(path);
 
-    if (auto q = query("SELECT pathmd5,path,type,modtime FROM folder WHERE path=?", { path.u8string() }); !q.empty())
+    if (auto q = queryAs<std::string, std::string, long long, long long>(
+            "SELECT pathmd5,path,type,modtime FROM folder WHERE path=?", path.u8string());
+        !q.empty())
     {
         LOG_VERBOSE << "[SongDB] Sub folder already exists (" << path << ")";
 
-        std::string folderMD5 = ANY_STR(q[0][0]);
-        std::string folderPath = ANY_STR(q[0][1]);
-        FolderType folderType = (FolderType)ANY_INT(q[0][2]);
-        long long folderModifyTimeDB = ANY_INT(q[0][3]);
+        const auto& [folderMD5, folderPath, folderTypeRaw, folderModifyTimeDB] = q[0];
+        FolderType folderType = (FolderType)folderTypeRaw;
 
         if (folderType == FolderType::SONG_BMS)
         {
@@ -729,24 +1151,204 @@ int SongDB::removeFolder(const HashMD5& hash, bool removeSong)
     return exec("DELETE FROM folder WHERE pathmd5=?", { hash.hexdigest() });
 }
 
-void SongDB::waitLoadingFinish()
+SongDB::ScanPipeline* SongDB::startScanPipeline()
 {
-    if (threadPool)
+    std::unique_lock l(scanPipelineMutex);
+    if (scanPipeline || stopRequested())
+        return scanPipeline.get();
+
+    LOG_DEBUG << "[SongDB] Starting scan pipeline with " << parseThreadCount << " parse threads";
+
+    scanPipeline = std::make_unique<ScanPipeline>();
+    for (int i = 0; i < parseThreadCount; ++i)
     {
-        LOG_DEBUG << "[SongDB] Waiting for all loading threads...";
+        scanPipeline->parseWorkers.emplace_back(&SongDB::parseWorkerLoop, this, scanPipeline.get());
+    }
+    scanPipeline->writer = std::thread(&SongDB::writerLoop, this, scanPipeline.get());
+    return scanPipeline.get();
+}
+
+void SongDB::postChart(const HashMD5& folder, const Path& path)
+{
+    ScanPipeline* pipeline = startScanPipeline();
+    if (!pipeline)
+        return;
+
+    addChartTaskCount++;
 
-        // wait for all tasks
-        boost::asio::thread_pool& pool = *(boost::asio::thread_pool*)threadPool;
-        pool.join();
+    // blocks while the parse stage is saturated
+    if (!pipeline->parseQueue.push({ folder, path }))
+    {
+        addChartTaskFinishCount++;
+    }
+}
 
-        LOG_DEBUG << "[SongDB] All loading threads finished, continue";
+void SongDB::parseWorkerLoop(ScanPipeline* pipeline)
+{
+    SetThreadName("SongDB parse");
 
-        // The old pool is not valid anymore, removing
-        delete (boost::asio::thread_pool*)threadPool;
-        threadPool = nullptr;
+    ScanPipeline::Task task;
+    while (!stopRequested() && pipeline->parseQueue.pop(task))
+    {
+        ParsedChart parsed;
+        if (parseChart(task.folder, task.path, parsed))
+        {
+            if (pipeline->writeQueue.push(std::move(parsed)))
+                continue;
+        }
+        addChartTaskFinishCount++;
     }
 }
 
+void SongDB::writerLoop(ScanPipeline* pipeline)
+{
+    SetThreadName("SongDB writer");
+
+    auto batchStart = std::chrono::steady_clock::now();
+    size_t batchRows = 0;
+
+    transactionStart();
+
+    ParsedChart parsed;
+    while (pipeline->writeQueue.pop(parsed))
+    {
+        if (!stopRequested())
+        {
+            if (insertChart(parsed))
+                addChartSuccess++;
+        }
+        addChartTaskFinishCount++;
+        parsed = {};
+
+        if (++batchRows >= ScanPipeline::WRITE_BATCH_ROWS ||
+            std::chrono::steady_clock::now() - batchStart >= ScanPipeline::WRITE_BATCH_INTERVAL)
+        {
+            transactionStop();
+            transactionStart();
+            batchRows = 0;
+            batchStart = std::chrono::steady_clock::now();
+        }
+    }
+
+    transactionStop();
+}
+
+void SongDB::refreshFolders(const std::vector<Path>& folders, unsigned stopToken)
+{
+    std::unique_lock l(scanMutex);
+    resetAddSummary();
+    scanStopToken = stopToken;
+    startScanPipeline();
+
+    // parents first, so new sub folders find their parent row
+    std::vector<Path> sorted = folders;
+    std::sort(sorted.begin(), sorted.end(), [](const Path& a, const Path& b) { return a.native().length() < b.native().length(); });
+
+    for (const auto& folder : sorted)
+    {
+        if (stopRequested()) break;
+
+        const Path path = normalizeFolderPath(folder, ROOT_FOLDER_HASH);
+        auto q = query("SELECT pathmd5,type FROM folder WHERE path=?", { path.u8string() });
+
+        if (!fs::is_directory(folder))
+        {
+            if (!q.empty())
+            {
+                LOG_DEBUG << "[SongDB] Folder removed: " << path;
+                removeFolderTree(HashMD5(ANY_STR(q[0][0])));
+            }
+            continue;
+        }
+
+        if (q.empty())
+        {
+            const Path parentPath = normalizeFolderPath(path.parent_path().parent_path(), ROOT_FOLDER_HASH);
+            auto parent = query("SELECT pathmd5 FROM folder WHERE path=?", { parentPath.u8string() });
+            if (!parent.empty())
+            {
+                LOG_DEBUG << "[SongDB] Folder added: " << path;
+                addSubFolder(folder, HashMD5(ANY_STR(parent[0][0])));
+            }
+            continue;
+        }
+
+        const HashMD5 hash(ANY_STR(q[0][0]));
+        const FolderType type = (FolderType)ANY_INT(q[0][1]);
+        bool hasCharts = false;
+        for (const auto& f : fs::directory_iterator(folder))
+        {
+            if (analyzeChartType(f) != eChartFormat::UNKNOWN)
+            {
+                hasCharts = true;
+                break;
+            }
+        }
+        if (type == FolderType::FOLDER && hasCharts)
+        {
+            // plain folder became a song folder, analyze again
+            auto parent = query("SELECT parent FROM folder WHERE pathmd5=?", { hash.hexdigest() });
+            removeFolder(hash, true);
+            addSubFolder(folder, (parent.empty() || parent[0].empty()) ? ROOT_FOLDER_HASH : HashMD5(ANY_STR(parent[0][0])));
+        }
+        else
+        {
+            refreshExistingFolder(hash, path, type);
+        }
+    }
+
+    waitLoadingFinish();
+    libraryGeneration++;
+
+    LOG_INFO << "[SongDB] Refreshed " << folders.size() << " folders: " << addChartSuccess - addChartModified << " added, "
+             << addChartModified << " modified, " << addChartDeleted << " deleted";
+}
+
+void SongDB::removeFolderTree(const HashMD5& hash)
+{
+    for (const auto& sub : query("SELECT pathmd5 FROM folder WHERE parent=?", { hash.hexdigest() }))
+    {
+        removeFolderTree(HashMD5(ANY_STR(sub[0])));
+    }
+    removeFolder(hash, true);
+}
+
+bool SongDB::startWatching(const std::vector<Path>& roots)
+{
+    if (!watcher)
+        watcher = std::make_unique<SongDBWatcher>(*this);
+    return watcher->start(roots);
+}
+
+void SongDB::stopWatching()
+{
+    if (watcher)
+        watcher->stop();
+}
+
+void SongDB::waitLoadingFinish()
+{
+    std::unique_lock sl(scanMutex);
+    std::unique_ptr<ScanPipeline> pipeline;
+    {
+        std::unique_lock l(scanPipelineMutex);
+        pipeline = std::move(scanPipeline);
+    }
+    if (!pipeline)
+        return;
+
+    LOG_DEBUG << "[SongDB] Waiting for all loading threads...";
+
+    // drain stage by stage: walk is done, so parse workers exit once their queue is empty, then the writer
+    pipeline->parseQueue.close();
+    for (auto& t : pipeline->parseWorkers)
+        t.join();
+    pipeline->writeQueue.close();
+    pipeline->writer.join();
+
+    LOG_DEBUG << "[SongDB] All loading threads finished, continue";
+}
+
 int SongDB::addNewFolder(const HashMD5& hash, const Path& path, const HashMD5& parentHash)
 {
     LOG_DEBUG << "[SongDB] Add new folder " << path;
@@ -754,7 +1356,7 @@ int SongDB::addNewFolder(const HashMD5& hash, const Path& path, const HashMD5& p
     FolderType type = FolderType::FOLDER;
     for (auto& f : std::filesystem::directory_iterator(path))
     {
-        if (analyzeChartType(f) == eChartFormat::BMS)
+        if (const auto chartType = analyzeChartType(f); chartType == eChartFormat::BMS || chartType == eChartFormat::BMSON)
         {
             type = FolderType::SONG_BMS;
             break;  // break for
@@ -796,7 +1398,7 @@ int SongDB::addNewFolder(const HashMD5& hash, const Path& path, const HashMD5& p
     bool isSongFolder = false;
     for (const auto& f : fs::directory_iterator(path))
     {
-        if (stopRequested) break;
+        if (stopRequested()) break;
 
         if (analyzeChartType(f) != eChartFormat::UNKNOWN)
         {
@@ -808,7 +1410,7 @@ int SongDB::addNewFolder(const HashMD5& hash, const Path& path, const HashMD5& p
     std::vector<Path> subFolderList;
     for (const auto& f : fs::directory_iterator(path))
     {
-        if (stopRequested) break;
+        if (stopRequested()) break;
 
         if (!isSongFolder && fs::is_directory(f))
         {
@@ -816,21 +1418,14 @@ int SongDB::addNewFolder(const HashMD5& hash, const Path& path, const HashMD5& p
         }
         else if (isSongFolder && analyzeChartType(f) != eChartFormat::UNKNOWN)
         {
-            addChartTaskCount++;
-
-            if (!threadPool)
-            {
-                threadPool = (void*)new boost::asio::thread_pool(poolThreadCount);
-            }
-            boost::asio::thread_pool& pool = *(boost::asio::thread_pool*)threadPool;
-            boost::asio::post(pool, std::bind(&SongDB::addChart, this, hash, f));
+            postChart(hash, f);
             ++count;
         }
     }
 
     for (const auto& sub : subFolderList)
     {
-        if (stopRequested) break;
+        if (stopRequested()) break;
 
         int addedCount = addSubFolder(sub, hash);
         if (addedCount > 0)
@@ -894,6 +1489,7 @@ int SongDB::refreshExistingFolder(const HashMD5& hash, const Path& path, FolderT
             {
                 std::vector<HashMD5> deletedFiles;
                 std::vector<Path> modifiedFiles;
+                std::vector<std::pair<HashMD5, FileSignature>> touchedFiles;
 
                 for (size_t i = 0; i < existedList->getContentsCount(); ++i)
                 {
@@ -904,16 +1500,24 @@ int SongDB::refreshExistingFolder(const HashMD5& hash, const Path& path, FolderT
                     }
                     else
                     {
-                        long long fstime = getFileLastWriteTime(path);
-                        if (auto q = query("SELECT addtime FROM song WHERE md5=? AND parent=?",
-                                           {chart->fileHash.hexdigest(), hash.hexdigest()});
+                        FileSignature fsSignature;
+                        if (!getFileSignature(chart->absolutePath, fsSignature))
+                            continue;
+                        if (auto q = queryAs<long long, long long, long long>(
+                                "SELECT filesize,filemtime,fileino FROM song WHERE md5=? AND parent=?",
+                                chart->fileHash.hexdigest(), hash.hexdigest());
                             !q.empty())
                         {
-                            long long dbTime = ANY_INT(q[0][0]);
+                            FileSignature dbSignature;
+                            std::tie(dbSignature.size, dbSignature.mtime, dbSignature.inode) = q[0];
 
-                            if (fstime > dbTime && md5file(chart->absolutePath) != chart->fileHash)
+                            if (scanAlwaysHash || fsSignature != dbSignature)
                             {
-                                modifiedFiles.push_back(chart->absolutePath);
+                                addChartHashed++;
+                                if (md5file(chart->absolutePath) != chart->fileHash)
+                                    modifiedFiles.push_back(chart->absolutePath);
+                                else if (fsSignature != dbSignature)
+                                    touchedFiles.emplace_back(chart->fileHash, fsSignature);
                             }
                         }
                     }
@@ -928,6 +1532,16 @@ int SongDB::refreshExistingFolder(const HashMD5& hash, const Path& path, FolderT
                     }
                 }
 
+                // touched but not modified; store the new signature so the next scan skips hashing
+                for (auto& [chartMD5, signature] : touchedFiles)
+                {
+                    if (SQLITE_OK != execAs("UPDATE song SET filesize=?,filemtime=?,fileino=? WHERE md5=? AND parent=?",
+                        signature.size, signature.mtime, signature.inode, chartMD5.hexdigest(), hash.hexdigest()))
+                    {
+                        LOG_WARNING << "[SongDB] Update chart file signature error: " << errmsg() << " (" << path << ")";
+                    }
+                }
+
                 hasModifiedEntry = !modifiedFiles.empty();
                 for (auto& chartPath : modifiedFiles)
                 {
@@ -949,18 +1563,11 @@ int SongDB::refreshExistingFolder(const HashMD5& hash, const Path& path, FolderT
         std::set_difference(bmsFiles.begin(), bmsFiles.end(), existedFiles.begin(), existedFiles.end(), std::back_inserter(newFiles));
         for (auto& p : newFiles)
         {
-            if (stopRequested)
+            if (stopRequested())
             {
                 break;
             }
-            addChartTaskCount++;
-
-            if (!threadPool)
-            {
-                threadPool = (void*)new boost::asio::thread_pool(poolThreadCount);
-            }
-            boost::asio::thread_pool& pool = *(boost::asio::thread_pool*)threadPool;
-            boost::asio::post(pool, std::bind(&SongDB::addChart, this, hash, p));
+            postChart(hash, p);
             count++;
         }
 
@@ -1021,7 +1628,7 @@ int SongDB::refreshExistingFolder(const HashMD5& hash, const Path& path, FolderT
         std::vector<Path> subFolders;
         for (auto& f : fs::directory_iterator(path))
         {
-            if (stopRequested)
+            if (stopRequested())
             {
                 break;
             }
@@ -1085,27 +1692,27 @@ HashMD5 SongDB::getFolderParent(const HashMD5& folder) const
 
 std::pair<bool, Path> SongDB::getFolderPath(const HashMD5& folder) const
 {
-    if (!folderQueryHashMap.empty())
+    auto catalog = getCatalog();
+    if (catalog && catalog->folderCount() > 0)
     {
-        if (folderQueryHashMap.find(folder) != folderQueryHashMap.end())
+        if (auto rows = catalog->findFoldersByHash(folder); !rows.empty())
         {
-            auto cols = folderQueryPool[folderQueryHashMap.at(folder)[0]];
-            return { true, PathFromUTF8(ANY_STR(cols[4])) };
+            return { true, PathFromUTF8(catalog->str(catalog->folders().path[*rows.begin()])) };
         }
     }
     else
     {
-        auto result = query("SELECT type,path FROM folder WHERE pathmd5=?", { folder.hexdigest() });
+        auto result = queryAs<long long, std::string>("SELECT type,path FROM folder WHERE pathmd5=?", folder.hexdigest());
         if (!result.empty())
         {
-            auto leaf = result[0];
-            //if (ANY_INT(leaf[0]) != FOLDER)
+            const auto& [type, path] = result[0];
+            //if (type != FOLDER)
             //{
-            //    LOG_WARNING << "[SongDB] Get folder path type error: excepted " << FOLDER << ", get " << ANY_INT(leaf[0]) <<
+            //    LOG_WARNING << "[SongDB] Get folder path type error: excepted " << FOLDER << ", get " << type <<
             //        " (" << folder << ")";
             //    return Path();
             //}
-            return { true, PathFromUTF8(ANY_STR(leaf[1])) };
+            return { true, PathFromUTF8(path) };
         }
     }
     LOG_INFO << "[SongDB] Get folder path fail: target " << folder.hexdigest() << " not found";
@@ -1149,17 +1756,17 @@ std::shared_ptr<EntryFolderRegular> SongDB::browse(const HashMD5& root, bool rec
 
     std::shared_ptr<EntryFolderRegular> list = std::make_shared<EntryFolderRegular>(root, path);
 
-    if (folderQueryParentMap.find(root) != folderQueryParentMap.end())
+    auto catalog = getCatalog();
+    if (catalog)
     {
-        for (const auto& index : folderQueryParentMap.at(root))
+        const auto& c = catalog->folders();
+        for (SongCatalog::Row row : catalog->findFoldersByParent(root))
         {
-            const auto& c = folderQueryPool[index];
-            auto md5 = ANY_STR(c[0]);
-            auto parent = ANY_STR(c[1]);
-            auto name = ANY_STR(c[2]);
-            auto type = (FolderType)ANY_INT(c[3]);
-            auto path = ANY_STR(c[4]);
-            auto modtime = ANY_INT(c[5]);
+            const HashMD5& md5 = c.pathmd5[row];
+            auto name = std::string(catalog->str(c.name[row]));
+            auto type = (FolderType)c.type[row];
+            auto path = catalog->str(c.path[row]);
+            auto modtime = c.modtime[row];
 
             switch (type)
             {
@@ -1218,18 +1825,19 @@ std::shared_ptr<EntryFolderSong> SongDB::browseSong(const HashMD5& root)
     std::shared_ptr<EntryFolderSong> list = std::make_shared<EntryFolderSong>(root, path);
     bool isNameSet = false;
 
-    if (songQueryParentMap.find(root) != songQueryParentMap.end())
+    auto catalog = getCatalog();
+    if (catalog)
     {
-        for (const auto& index : songQueryParentMap.at(root))
+        for (SongCatalog::Row row : catalog->findSongsByParent(root))
         {
-            const auto& c = songQueryPool[index];
-            auto type = (eChartFormat)ANY_INT(c[3]);
+            auto type = (eChartFormat)catalog->songs().type[row];
             switch (type)
             {
             case eChartFormat::BMS:
+            case eChartFormat::BMSON:
             {
-                auto p = std::make_shared<ChartFormatBMSMeta>();
-                if (convert_bms(p, c))
+                auto p = std::make_shared<ChartFormatBMSMeta>(type);
+                if (convert_bms(p, *catalog, row))
                 {
                     if (p->fileName.is_absolute())
                         p->absolutePath = p->fileName;
@@ -1286,20 +1894,21 @@ void SongDB::resetAddSummary()
     addChartSuccess = 0;
     addChartModified = 0;
     addChartDeleted = 0;
+    addChartHashed = 0;
     addCurrentPath.clear();
 }
 
 void SongDB::stopLoading()
 {
-    if (threadPool)
-    {
-        // stop all tasks
-        boost::asio::thread_pool& pool = *(boost::asio::thread_pool*)threadPool;
-        pool.stop();
+    stopGeneration++;
 
-        // The old pool is not valid anymore, removing
-        delete (boost::asio::thread_pool*)threadPool;
-        threadPool = nullptr;
+    // wake up every stage; threads are joined in waitLoadingFinish
+    std::unique_lock l(scanPipelineMutex);
+    if (scanPipeline)
+    {
+        scanPipeline->parseQueue.clear();
+        scanPipeline->parseQueue.close();
+        scanPipeline->writeQueue.clear();
+        scanPipeline->writeQueue.close();
     }
-    stopRequested = true;
 }
\ No newline at end of file
@@ -1,14 +1,22 @@
 #pragma once
+#include <atomic>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <string>
 #include <vector>
 
 #include "common/entry/entry_folder.h"
 #include "common/entry/entry_song.h"
+#include "common/sysutil.h"
 #include "common/types.h"
 #include "common/utils.h"
 #include "db_conn.h"
+#include "db_song_catalog.h"
+
+class SongDBWatcher;
 
 // FIXME: use "__root_folder" or something, currently something somewhere assumes empty string here.
 inline const HashMD5 ROOT_FOLDER_HASH = md5({});
@@ -51,35 +59,89 @@ public:
     SongDB& operator= (SongDB&) = delete;
 
 protected:
+    // Output of the hash+parse stage, consumed by the DB writer stage.
+    // chart == nullptr with replace == true only removes the stale entry.
+    struct ParsedChart
+    {
+        HashMD5 folder;
+        Path path;
+        std::shared_ptr<ChartFormatBase> chart;
+        long long length = 0;
+        int totalNotes = 0;
+        FileSignature signature;
+        bool replace = false;
+        bool refreshSignature = false; // content unchanged, only update the stored signature
+    };
+    bool parseChart(const HashMD5& folder, const Path& path, ParsedChart& out) const;
+    bool insertChart(const ParsedChart& parsed);
     bool addChart(const HashMD5& folder, const Path& path);
     bool removeChart(const Path& path, const HashMD5& parent);
     bool removeChart(const HashMD5& md5, const HashMD5& parent);
     
 public:
-    std::vector<std::shared_ptr<ChartFormatBase>> findChartByName(const HashMD5& folder, const std::string&, unsigned limit = 1000) const;  // search from genre, version, artist, artist2, title, title2
+    std::vector<std::shared_ptr<ChartFormatBase>> findChartByName(const HashMD5& folder, const std::string&, unsigned limit = 1000) const;  // search from genre, version, artist, artist2, title, title2, best match first
     std::vector<std::shared_ptr<ChartFormatBase>> findChartByHash(const HashMD5&, bool checksum = true) const;  // chart may duplicate, return a list
     std::vector<std::shared_ptr<ChartFormatBase>> findChartFromTime(const HashMD5& folder, unsigned long long addTime) const;
 
 protected:
-    std::vector<std::vector<std::any>> songQueryPool;
-    std::unordered_map<HashMD5, std::vector<size_t>> songQueryHashMap;
-    std::unordered_map<HashMD5, std::vector<size_t>> songQueryParentMap;
-    std::vector<std::vector<std::any>> folderQueryPool;
-    std::unordered_map<HashMD5, std::vector<size_t>> folderQueryHashMap;
-    std::unordered_map<HashMD5, std::vector<size_t>> folderQueryParentMap;
+    // song_fts search index is usable
+    bool ftsAvailable = false;
+
+protected:
+    // Snapshot of tables song and folder for browsing, rebuilt by prepareCache(). Null when not prepared.
+    // Replaced as a whole while other threads browse; readers hold the one from getCatalog() for the whole call.
+    std::shared_ptr<const SongCatalog> catalog;
+    std::shared_ptr<const SongCatalog> getCatalog() const { return std::atomic_load(&catalog); }
+    void setCatalog(std::shared_ptr<const SongCatalog> c) { std::atomic_store(&catalog, std::move(c)); }
+    // Catalog snapshot saved by prepareCache(), next to the DB file. Empty for in-memory DBs.
+    Path snapshotPath;
+    SongCatalog::SnapshotKey getSnapshotKey() const;
 public:
+    // Builds the next catalog while the current one stays in use, then publishes it and bumps cacheGeneration.
     void prepareCache();
+    // Runs prepareCache() on a background thread; does nothing while a build is running. Call from one thread only.
+    void prepareCacheAsync();
     void freeCache();
+    // Map the catalog snapshot instead of rebuilding the cache. Fails if the DB changed since it was saved.
+    bool loadCacheSnapshot();
 
 public:
-    int initializeFolders(const std::vector<Path>& paths);
+    int initializeFolders(const std::vector<Path>& paths) { return initializeFolders(paths, stopGeneration); }
+    // Runs initializeFolders() on a background thread. libraryGeneration is bumped if the library changed.
+    void initializeFoldersAsync(const std::vector<Path>& paths);
     int addSubFolder(Path path, const HashMD5& parent = ROOT_FOLDER_HASH);
+    // Runs addSubFolder() and prepareCache() on a background thread, then calls onFinished while still holding
+    // scanMutex so the add summary belongs to this refresh. Returns false if a refresh is still running.
+    bool refreshSubFolderAsync(const Path& path, const HashMD5& parent, std::function<void()> onFinished);
+    // Joins the scan pipeline. Takes scanMutex, so it never runs while a scan is posting charts.
     void waitLoadingFinish();
     int removeFolder(const HashMD5& hash, bool removeSong = false);
 
+    // Re-check the given folders against the filesystem: add new folders and charts, drop deleted ones,
+    // re-add modified charts. Used by the watcher.
+    void refreshFolders(const std::vector<Path>& folders) { refreshFolders(folders, stopGeneration); }
+
+    // Serializes scans, incremental refreshes and cache rebuilds.
+    std::recursive_mutex scanMutex;
+    // Bumped after every incremental refresh that may have changed the library; compare to know when to prepareCache().
+    std::atomic<unsigned> libraryGeneration = 0;
+    // libraryGeneration the cache was built at.
+    std::atomic<unsigned> cacheGeneration = 0;
+
+    bool startWatching(const std::vector<Path>& roots);
+    void stopWatching();
+
 protected:
+    // stopToken: stopGeneration at the time the scan was requested
+    int initializeFolders(const std::vector<Path>& paths, unsigned stopToken);
+    void refreshFolders(const std::vector<Path>& folders, unsigned stopToken);
     int addNewFolder(const HashMD5& hash, const Path& path, const HashMD5& parent);
     int refreshExistingFolder(const HashMD5& hash, const Path& path, FolderType type);
+    void removeFolderTree(const HashMD5& hash);
+    std::unique_ptr<SongDBWatcher> watcher;
+    std::future<void> backgroundScan;
+    std::future<void> cacheBuild;
+    std::future<void> folderRefresh;
 
 public:
     HashMD5 getFolderParent(const HashMD5& folder) const;
@@ -92,20 +154,38 @@ public:
     std::shared_ptr<EntryFolderRegular> search(const HashMD5& root, const std::string& key);
 
 private:
-    void* threadPool = nullptr;
-    int poolThreadCount = 4;
+    // Library scan pipeline: directory walk (caller thread) -> hash+parse (worker threads) -> DB writer (one thread).
+    // Stages are connected by bounded queues, so the walk stalls instead of queueing the whole library in memory.
+    struct ScanPipeline;
+    std::unique_ptr<ScanPipeline> scanPipeline;
+    std::mutex scanPipelineMutex;
+    int parseThreadCount = 4;
+    // Returns the running pipeline, or nullptr once stopped. Valid until waitLoadingFinish().
+    ScanPipeline* startScanPipeline();
+    void postChart(const HashMD5& folder, const Path& path);
+    void parseWorkerLoop(ScanPipeline* pipeline);
+    void writerLoop(ScanPipeline* pipeline);
 
 public:
-    int addChartTaskCount = 0;
-    int addChartTaskFinishCount = 0;
-    int addChartSuccess = 0;
-    int addChartModified = 0;
-    int addChartDeleted = 0;
+    std::atomic<int> addChartTaskCount = 0;
+    std::atomic<int> addChartTaskFinishCount = 0;
+    std::atomic<int> addChartSuccess = 0;
+    std::atomic<int> addChartModified = 0;
+    std::atomic<int> addChartDeleted = 0;
+    // known charts hashed again because their file signature changed
+    mutable std::atomic<int> addChartHashed = 0;
 
     std::shared_mutex addCurrentPathMutex;
     std::string addCurrentPath;
     void resetAddSummary();
 
-    bool stopRequested = false;
+    // stopLoading() bumps stopGeneration. A scan keeps the generation it was requested at, taken before it waits for
+    // scanMutex, and stops once the two differ; so a stop issued while a scan is queued still cancels it.
+    std::atomic<unsigned> stopGeneration = 0;
+    std::atomic<unsigned> scanStopToken = 0;
+    bool stopRequested() const { return stopGeneration != scanStopToken; }
     void stopLoading();
+
+    // Hash every known chart during scans, even if its size/mtime/inode signature is unchanged.
+    bool scanAlwaysHash = false;
 };
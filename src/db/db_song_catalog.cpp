@@ -0,0 +1,315 @@
+#include "db_song_catalog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include "common/log.h"
+
+namespace {
+
+enum ColumnRows
+{
+    SONG_ROWS,
+    FOLDER_ROWS,
+};
+
+constexpr char SNAPSHOT_MAGIC[8] = { 'L', 'V', 'C', 'A', 'T', 'L', 'O', 'G' };
+// Bump whenever the column list or any column type changes.
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+constexpr uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+constexpr size_t SNAPSHOT_MAX_SECTIONS = 48;
+constexpr size_t SNAPSHOT_ALIGN = 8;
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t hashSize;
+    uint32_t sectionCount;
+    int64_t libraryId;
+    int64_t revision;
+    uint64_t songCount;
+    uint64_t folderCount;
+    uint64_t stringOffset;
+    uint64_t stringBytes;
+    uint64_t sectionOffset[SNAPSHOT_MAX_SECTIONS];
+};
+
+static_assert(std::is_trivially_copyable_v<HashMD5>, "HashMD5 is stored in snapshots as raw bytes");
+
+} // namespace
+
+SongCatalog::SongCatalog() : _internTable(0, PoolHash{ &_strings }, PoolEqual{ &_strings })
+{
+    // StrId 0 is the empty string
+    _strings.push_back('\0');
+    _strData = _strings.data();
+    _strSize = _strings.size();
+    _internTable.insert(0);
+}
+
+// Visits every column in snapshot order. Do not reorder without bumping SNAPSHOT_VERSION.
+template <typename Self, typename F>
+void SongCatalog::forEachColumn(Self& self, F&& f)
+{
+    auto song = [&](auto&... columns) { (f(columns, SONG_ROWS), ...); };
+    auto folder = [&](auto&... columns) { (f(columns, FOLDER_ROWS), ...); };
+    auto& sc = self._song;
+    auto& fc = self._folder;
+    song(sc.md5, sc.parent, sc.file, sc.type, sc.title, sc.title2, sc.artist, sc.artist2, sc.genre, sc.version,
+        sc.level, sc.bpm, sc.minbpm, sc.maxbpm, sc.length, sc.totalnotes, sc.stagefile, sc.bannerfile, sc.gamemode,
+        sc.judgerank, sc.total, sc.playlevel, sc.difficulty, sc.flags, sc.addtime);
+    folder(fc.pathmd5, fc.parent, fc.name, fc.type, fc.path, fc.modtime);
+    song(self._songByHash, self._songByParent);
+    folder(self._folderByHash, self._folderByParent);
+}
+
+void SongCatalog::reserve(size_t songCount, size_t folderCount)
+{
+    forEachColumn(*this, [&](auto& column, ColumnRows rows) { column.reserve(rows == SONG_ROWS ? songCount : folderCount); });
+}
+
+SongCatalog::StrId SongCatalog::intern(std::string_view s)
+{
+    if (s.empty())
+        return 0;
+
+    // append tentatively, roll back if the string is already pooled
+    const auto id = static_cast<StrId>(_strings.size());
+    _strings.insert(_strings.end(), s.begin(), s.end());
+    _strings.push_back('\0');
+    auto [it, inserted] = _internTable.insert(id);
+    if (!inserted)
+        _strings.resize(id);
+    _strData = _strings.data();
+    _strSize = _strings.size();
+    return *it;
+}
+
+void SongCatalog::finalize()
+{
+    _internTable.clear();
+    _internTable.rehash(0);
+    _strings.shrink_to_fit();
+    _strData = _strings.data();
+    _strSize = _strings.size();
+
+    auto buildIndex = [](Column<Row>& index, const Column<HashMD5>& key)
+    {
+        std::vector<Row> rows(key.size());
+        for (size_t i = 0; i < rows.size(); ++i)
+            rows[i] = static_cast<Row>(i);
+        // stable, so rows with the same key keep table order
+        std::stable_sort(rows.begin(), rows.end(), [&](Row a, Row b) { return key[a] < key[b]; });
+        index.assign(std::move(rows));
+    };
+    buildIndex(_songByHash, _song.md5);
+    buildIndex(_songByParent, _song.parent);
+    buildIndex(_folderByHash, _folder.pathmd5);
+    buildIndex(_folderByParent, _folder.parent);
+}
+
+static SongCatalog::RowRange equalRange(const SongCatalog::Column<SongCatalog::Row>& index,
+                                        const SongCatalog::Column<HashMD5>& key, const HashMD5& value)
+{
+    struct Compare
+    {
+        const SongCatalog::Column<HashMD5>& key;
+        bool operator()(SongCatalog::Row lhs, const HashMD5& rhs) const { return key[lhs] < rhs; }
+        bool operator()(const HashMD5& lhs, SongCatalog::Row rhs) const { return lhs < key[rhs]; }
+    };
+    auto [first, last] = std::equal_range(index.begin(), index.end(), value, Compare{ key });
+    return { first, last };
+}
+
+SongCatalog::RowRange SongCatalog::findSongsByHash(const HashMD5& md5) const
+{
+    return equalRange(_songByHash, _song.md5, md5);
+}
+
+SongCatalog::RowRange SongCatalog::findSongsByParent(const HashMD5& parent) const
+{
+    return equalRange(_songByParent, _song.parent, parent);
+}
+
+SongCatalog::RowRange SongCatalog::findFoldersByHash(const HashMD5& hash) const
+{
+    return equalRange(_folderByHash, _folder.pathmd5, hash);
+}
+
+SongCatalog::RowRange SongCatalog::findFoldersByParent(const HashMD5& parent) const
+{
+    return equalRange(_folderByParent, _folder.parent, parent);
+}
+
+size_t SongCatalog::memoryUsage() const
+{
+    size_t bytes = _strings.capacity();
+    forEachColumn(*this, [&](const auto& column, ColumnRows) { bytes += column.memoryUsage(); });
+    return bytes;
+}
+
+bool SongCatalog::saveSnapshot(const Path& path, const SnapshotKey& key) const
+{
+    SnapshotHeader header{};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.hashSize = sizeof(HashMD5);
+    header.libraryId = key.libraryId;
+    header.revision = key.revision;
+    header.songCount = songCount();
+    header.folderCount = folderCount();
+    header.stringBytes = _strSize;
+
+    bool complete = true;
+    forEachColumn(*this, [&](const auto& column, ColumnRows rows) {
+        if (column.size() != (rows == SONG_ROWS ? header.songCount : header.folderCount))
+            complete = false;
+        header.sectionCount++;
+    });
+    if (!complete || header.sectionCount > SNAPSHOT_MAX_SECTIONS)
+    {
+        LOG_WARNING << "[SongDB] Catalog is incomplete, not saving snapshot";
+        return false;
+    }
+
+    Path tmpPath = path;
+    tmpPath += ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        LOG_WARNING << "[SongDB] Cannot write catalog snapshot " << tmpPath;
+        return false;
+    }
+
+    // header is rewritten at the end once offsets are known
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t pos = sizeof(header);
+    auto writeSection = [&](const void* data, size_t bytes) {
+        static constexpr char zeros[SNAPSHOT_ALIGN] = {};
+        const size_t padding = (SNAPSHOT_ALIGN - pos % SNAPSHOT_ALIGN) % SNAPSHOT_ALIGN;
+        out.write(zeros, padding);
+        pos += padding;
+        const uint64_t offset = pos;
+        out.write(static_cast<const char*>(data), bytes);
+        pos += bytes;
+        return offset;
+    };
+
+    header.stringOffset = writeSection(_strData, _strSize);
+    size_t section = 0;
+    forEachColumn(*this, [&](const auto& column, ColumnRows) {
+        using T = std::decay_t<decltype(column[0])>;
+        header.sectionOffset[section++] = writeSection(column.data(), column.size() * sizeof(T));
+    });
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if (!out)
+    {
+        LOG_WARNING << "[SongDB] Write catalog snapshot " << tmpPath << " failed";
+        std::error_code ec;
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+    if (ec)
+    {
+        LOG_WARNING << "[SongDB] Replace catalog snapshot " << path << " failed: " << ec.message();
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<SongCatalog> SongCatalog::loadSnapshot(const Path& path, const SnapshotKey& key)
+{
+    auto c = std::make_unique<SongCatalog>();
+    if (!c->_mapping.open(path))
+        return nullptr;
+
+    const char* base = c->_mapping.data();
+    const size_t size = c->_mapping.size();
+
+    SnapshotHeader header;
+    if (size < sizeof(header))
+        return nullptr;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_VERSION ||
+        header.byteOrder != SNAPSHOT_BYTE_ORDER || header.hashSize != sizeof(HashMD5))
+    {
+        LOG_INFO << "[SongDB] Catalog snapshot format mismatch, ignoring";
+        return nullptr;
+    }
+    if (header.libraryId != key.libraryId)
+    {
+        LOG_INFO << "[SongDB] Catalog snapshot belongs to another database, ignoring";
+        return nullptr;
+    }
+    if (header.revision != key.revision)
+    {
+        LOG_INFO << "[SongDB] Catalog snapshot is stale (revision " << header.revision << ", database " << key.revision << ")";
+        return nullptr;
+    }
+    if (header.songCount > UINT32_MAX || header.folderCount > UINT32_MAX ||
+        header.stringBytes == 0 || header.stringOffset > size || header.stringBytes > size - header.stringOffset ||
+        base[header.stringOffset + header.stringBytes - 1] != '\0')
+    {
+        LOG_WARNING << "[SongDB] Catalog snapshot is corrupted";
+        return nullptr;
+    }
+
+    bool valid = true;
+    size_t section = 0;
+    forEachColumn(*c, [&](auto& column, ColumnRows rows) {
+        using T = std::decay_t<decltype(column[0])>;
+        const size_t count = rows == SONG_ROWS ? header.songCount : header.folderCount;
+        const uint64_t offset = section < SNAPSHOT_MAX_SECTIONS ? header.sectionOffset[section] : size;
+        section++;
+        if (!valid || offset % alignof(T) != 0 || offset > size || count * sizeof(T) > size - offset)
+        {
+            valid = false;
+            return;
+        }
+        column.attach(reinterpret_cast<const T*>(base + offset), count);
+    });
+    if (!valid || section != header.sectionCount)
+    {
+        LOG_WARNING << "[SongDB] Catalog snapshot is corrupted";
+        return nullptr;
+    }
+
+    // ids are used unchecked once loaded
+    auto strIdsValid = [&](std::initializer_list<const Column<StrId>*> columns) {
+        return std::all_of(columns.begin(), columns.end(), [&](const Column<StrId>* col) {
+            return std::all_of(col->begin(), col->end(), [&](StrId id) { return id < header.stringBytes; });
+        });
+    };
+    auto rowsValid = [](std::initializer_list<const Column<Row>*> indexes, uint64_t count) {
+        return std::all_of(indexes.begin(), indexes.end(), [&](const Column<Row>* index) {
+            return std::all_of(index->begin(), index->end(), [&](Row row) { return row < count; });
+        });
+    };
+    const auto& sc = c->_song;
+    const auto& fc = c->_folder;
+    if (!strIdsValid({ &sc.file, &sc.title, &sc.title2, &sc.artist, &sc.artist2, &sc.genre, &sc.version,
+                       &sc.stagefile, &sc.bannerfile, &fc.name, &fc.path }) ||
+        !rowsValid({ &c->_songByHash, &c->_songByParent }, header.songCount) ||
+        !rowsValid({ &c->_folderByHash, &c->_folderByParent }, header.folderCount))
+    {
+        LOG_WARNING << "[SongDB] Catalog snapshot is corrupted";
+        return nullptr;
+    }
+
+    c->_internTable.clear();
+    c->_strings = {};
+    c->_strData = base + header.stringOffset;
+    c->_strSize = header.stringBytes;
+    return c;
+}
@@ -0,0 +1,188 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "common/hash.h"
+#include "common/sysutil.h"
+
+// Column storage of SongCatalog: owned while building, or a view into a mapped snapshot.
+template <typename T>
+class SongCatalogColumn
+{
+public:
+    SongCatalogColumn() = default;
+    SongCatalogColumn(const SongCatalogColumn&) = delete;
+    SongCatalogColumn& operator=(const SongCatalogColumn&) = delete;
+
+    void reserve(size_t n) { _owned.reserve(n); sync(); }
+    void push_back(const T& v) { _owned.push_back(v); sync(); }
+    void assign(std::vector<T>&& v) { _owned = std::move(v); sync(); }
+    void attach(const T* data, size_t size) { _owned = {}; _data = data; _size = size; }
+
+    const T& operator[](size_t i) const { return _data[i]; }
+    const T* data() const { return _data; }
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    const T* begin() const { return _data; }
+    const T* end() const { return _data + _size; }
+    size_t memoryUsage() const { return _owned.capacity() * sizeof(T); }
+
+private:
+    void sync() { _data = _owned.data(); _size = _owned.size(); }
+    std::vector<T> _owned;
+    const T* _data = nullptr;
+    size_t _size = 0;
+};
+
+// In-memory copy of tables song and folder, used by SongDB for browsing and hash lookups.
+// Columns are stored separately with fixed width; text is interned into one pool and referenced by offset.
+// Lookups by hash or parent go through row indexes sorted by that key.
+// The finished catalog can be saved as a snapshot file and mapped back at startup without decoding anything.
+class SongCatalog
+{
+public:
+    typedef uint32_t Row;
+    typedef uint32_t StrId;
+    template <typename T>
+    using Column = SongCatalogColumn<T>;
+
+    // Identifies the DB state a snapshot was taken from.
+    struct SnapshotKey
+    {
+        int64_t libraryId = 0;
+        int64_t revision = 0;
+        bool operator==(const SnapshotKey& rhs) const { return libraryId == rhs.libraryId && revision == rhs.revision; }
+        bool operator!=(const SnapshotKey& rhs) const { return !(*this == rhs); }
+    };
+
+    // Contiguous range of rows from an index.
+    struct RowRange
+    {
+        const Row* first = nullptr;
+        const Row* last = nullptr;
+        const Row* begin() const { return first; }
+        const Row* end() const { return last; }
+        bool empty() const { return first == last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+    };
+
+    enum SongFlags : uint8_t
+    {
+        SONG_LN = 1 << 0,
+        SONG_MINE = 1 << 1,
+        SONG_METRIC_MOD = 1 << 2,
+        SONG_STOP = 1 << 3,
+        SONG_BGA = 1 << 4,
+        SONG_RANDOM = 1 << 5,
+    };
+
+    struct SongColumns
+    {
+        Column<HashMD5> md5;
+        Column<HashMD5> parent;
+        Column<StrId> file;
+        Column<int32_t> type;
+        Column<StrId> title;
+        Column<StrId> title2;
+        Column<StrId> artist;
+        Column<StrId> artist2;
+        Column<StrId> genre;
+        Column<StrId> version;
+        Column<double> level;
+        Column<double> bpm;
+        Column<double> minbpm;
+        Column<double> maxbpm;
+        Column<int32_t> length;
+        Column<int32_t> totalnotes;
+        Column<StrId> stagefile;
+        Column<StrId> bannerfile;
+        Column<int32_t> gamemode;
+        Column<int32_t> judgerank;
+        Column<int32_t> total;
+        Column<int32_t> playlevel;
+        Column<int32_t> difficulty;
+        Column<uint8_t> flags;
+        Column<int64_t> addtime;
+    };
+
+    struct FolderColumns
+    {
+        Column<HashMD5> pathmd5;
+        Column<HashMD5> parent; // empty for root
+        Column<StrId> name;
+        Column<int32_t> type;
+        Column<StrId> path;
+        Column<int64_t> modtime;
+    };
+
+public:
+    SongCatalog();
+    // the interning table refers to the pool by address
+    SongCatalog(const SongCatalog&) = delete;
+    SongCatalog& operator=(const SongCatalog&) = delete;
+
+    // Builder interface. Call finalize() after adding every row.
+    void reserve(size_t songCount, size_t folderCount);
+    StrId intern(std::string_view s);
+    SongColumns& songColumns() { return _song; }
+    FolderColumns& folderColumns() { return _folder; }
+    void finalize();
+
+    [[nodiscard]] const SongColumns& songs() const { return _song; }
+    [[nodiscard]] const FolderColumns& folders() const { return _folder; }
+    [[nodiscard]] size_t songCount() const { return _song.md5.size(); }
+    [[nodiscard]] size_t folderCount() const { return _folder.pathmd5.size(); }
+    [[nodiscard]] bool empty() const { return songCount() == 0 && folderCount() == 0; }
+
+    [[nodiscard]] std::string_view str(StrId id) const { return std::string_view(_strData + id); }
+
+    [[nodiscard]] RowRange findSongsByHash(const HashMD5& md5) const;
+    [[nodiscard]] RowRange findSongsByParent(const HashMD5& parent) const;
+    [[nodiscard]] RowRange findFoldersByHash(const HashMD5& hash) const;
+    [[nodiscard]] RowRange findFoldersByParent(const HashMD5& parent) const;
+
+    [[nodiscard]] size_t memoryUsage() const;
+
+    // Written to a temporary file first and then renamed over the target.
+    bool saveSnapshot(const Path& path, const SnapshotKey& key) const;
+    // Returns nullptr if the file is missing, malformed, or was saved with a different key.
+    static std::unique_ptr<SongCatalog> loadSnapshot(const Path& path, const SnapshotKey& key);
+
+private:
+    SongColumns _song;
+    FolderColumns _folder;
+
+    Column<Row> _songByHash;
+    Column<Row> _songByParent;
+    Column<Row> _folderByHash;
+    Column<Row> _folderByParent;
+
+    // NUL-terminated strings, StrId is the offset of the first character
+    std::vector<char> _strings;
+    const char* _strData = nullptr;
+    size_t _strSize = 0;
+
+    // keeps a loaded snapshot mapped
+    lunaticvibes::MappedFile _mapping;
+
+    // Self is SongCatalog or const SongCatalog
+    template <typename Self, typename F>
+    static void forEachColumn(Self& self, F&& f);
+
+    // Interning table used while building. Keys are offsets into _strings.
+    struct PoolHash
+    {
+        const std::vector<char>* pool;
+        size_t operator()(StrId id) const { return std::hash<std::string_view>()(std::string_view(pool->data() + id)); }
+    };
+    struct PoolEqual
+    {
+        const std::vector<char>* pool;
+        bool operator()(StrId a, StrId b) const { return std::string_view(pool->data() + a) == std::string_view(pool->data() + b); }
+    };
+    std::unordered_set<StrId, PoolHash, PoolEqual> _internTable;
+};
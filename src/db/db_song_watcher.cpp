@@ -0,0 +1,259 @@
+#include "db_song_watcher.h"
+
+#include <chrono>
+#include <system_error>
+
+#include "common/log.h"
+#include "common/sysutil.h"
+#include "common/utils.h"
+#include "db_song.h"
+
+#ifdef __linux__
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+// Wait this long without new events before applying changes...
+static constexpr auto COALESCE_QUIET = std::chrono::milliseconds(500);
+// ...but never hold back changes longer than this.
+static constexpr auto COALESCE_MAX = std::chrono::seconds(3);
+
+static constexpr uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO |
+                                       IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+// analyzeChartType() requires the file to exist, which deleted files don't.
+static bool isChartFileName(const Path& p)
+{
+    const auto ext = p.extension().u8string();
+    return lunaticvibes::iequals(ext, ".bms") || lunaticvibes::iequals(ext, ".bme") ||
+           lunaticvibes::iequals(ext, ".bml") || lunaticvibes::iequals(ext, ".pms") ||
+           lunaticvibes::iequals(ext, ".bmson");
+}
+
+SongDBWatcher::~SongDBWatcher()
+{
+    stop();
+}
+
+bool SongDBWatcher::start(const std::vector<Path>& roots)
+{
+    if (_running)
+        return true;
+
+    _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_fd < 0)
+    {
+        LOG_ERROR << "[SongDB] inotify_init1 failed: " << safe_strerror(errno);
+        return false;
+    }
+    _stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_stopFd < 0)
+    {
+        LOG_ERROR << "[SongDB] eventfd failed: " << safe_strerror(errno);
+        close(_fd);
+        _fd = -1;
+        return false;
+    }
+
+    _roots = roots;
+    for (const auto& root : _roots)
+    {
+        if (fs::is_directory(root))
+            addWatchRecursive(root);
+    }
+    LOG_INFO << "[SongDB] Watching " << _watches.size() << " folders for changes";
+
+    _running = true;
+    _thread = std::thread(&SongDBWatcher::loop, this);
+    return true;
+}
+
+void SongDBWatcher::stop()
+{
+    if (!_running)
+        return;
+
+    _running = false;
+    uint64_t one = 1;
+    [[maybe_unused]] auto ret = write(_stopFd, &one, sizeof(one));
+    if (_thread.joinable())
+        _thread.join();
+
+    close(_fd);
+    close(_stopFd);
+    _fd = -1;
+    _stopFd = -1;
+    _watches.clear();
+}
+
+void SongDBWatcher::addWatchRecursive(const Path& dir)
+{
+    int wd = inotify_add_watch(_fd, dir.c_str(), WATCH_MASK);
+    if (wd < 0)
+    {
+        // ENOSPC: fs.inotify.max_user_watches exhausted
+        LOG_WARNING << "[SongDB] inotify_add_watch failed for " << dir << ": " << safe_strerror(errno);
+        return;
+    }
+    _watches[wd] = dir;
+
+    std::error_code ec;
+    for (const auto& f : fs::directory_iterator(dir, ec))
+    {
+        if (f.is_directory(ec))
+            addWatchRecursive(f.path());
+    }
+}
+
+void SongDBWatcher::removeWatchRecursive(const Path& dir)
+{
+    for (auto it = _watches.begin(); it != _watches.end();)
+    {
+        if (isParentPath(dir, it->second))
+        {
+            inotify_rm_watch(_fd, it->first);
+            it = _watches.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void SongDBWatcher::readEvents(std::set<Path>& dirtyFolders, bool& overflow)
+{
+    alignas(inotify_event) char buf[16 * 1024];
+    while (true)
+    {
+        ssize_t len = read(_fd, buf, sizeof(buf));
+        if (len <= 0)
+            break;
+
+        for (char* p = buf; p < buf + len;)
+        {
+            const auto* ev = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW)
+            {
+                overflow = true;
+                continue;
+            }
+
+            auto it = _watches.find(ev->wd);
+            if (it == _watches.end())
+                continue;
+            const Path dir = it->second;
+
+            if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+            {
+                dirtyFolders.insert(dir);
+                continue;
+            }
+            if (ev->mask & IN_IGNORED || ev->len == 0)
+                continue;
+
+            const Path target = dir / ev->name;
+            if (ev->mask & IN_ISDIR)
+            {
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+                {
+                    addWatchRecursive(target);
+                }
+                else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+                {
+                    removeWatchRecursive(target);
+                }
+                dirtyFolders.insert(target);
+            }
+            else if (!(ev->mask & IN_CREATE) && isChartFileName(target))
+            {
+                // file creation is followed by IN_CLOSE_WRITE
+                dirtyFolders.insert(dir);
+            }
+        }
+    }
+}
+
+void SongDBWatcher::loop()
+{
+    SetThreadName("SongDB watcher");
+
+    using clock = std::chrono::steady_clock;
+    std::set<Path> dirtyFolders;
+    bool overflow = false;
+    clock::time_point firstEvent, lastEvent;
+
+    while (_running)
+    {
+        int timeoutMs = -1;
+        if (!dirtyFolders.empty() || overflow)
+        {
+            auto now = clock::now();
+            auto due = std::min(lastEvent + COALESCE_QUIET, firstEvent + COALESCE_MAX);
+            timeoutMs = static_cast<int>(std::max<long long>(0,
+                std::chrono::duration_cast<std::chrono::milliseconds>(due - now).count()));
+        }
+
+        pollfd fds[2] = { { _fd, POLLIN, 0 }, { _stopFd, POLLIN, 0 } };
+        int ret = poll(fds, 2, timeoutMs);
+        if (ret < 0 && errno != EINTR)
+        {
+            LOG_ERROR << "[SongDB] watcher poll failed: " << safe_strerror(errno);
+            break;
+        }
+        if (!_running || (fds[1].revents & POLLIN))
+            break;
+
+        if (ret > 0 && (fds[0].revents & POLLIN))
+        {
+            bool hadChanges = !dirtyFolders.empty() || overflow;
+            readEvents(dirtyFolders, overflow);
+            if (!dirtyFolders.empty() || overflow)
+            {
+                lastEvent = clock::now();
+                if (!hadChanges)
+                    firstEvent = lastEvent;
+            }
+            continue;
+        }
+
+        if (overflow)
+        {
+            // lost events, fall back to refreshing everything
+            LOG_WARNING << "[SongDB] inotify queue overflow, refreshing all folders";
+            dirtyFolders.clear();
+            dirtyFolders.insert(_roots.begin(), _roots.end());
+            overflow = false;
+        }
+        if (!dirtyFolders.empty())
+        {
+            std::vector<Path> folders(dirtyFolders.begin(), dirtyFolders.end());
+            dirtyFolders.clear();
+            LOG_INFO << "[SongDB] Detected changes in " << folders.size() << " folders";
+            _db.refreshFolders(folders);
+        }
+    }
+}
+
+#else
+
+SongDBWatcher::~SongDBWatcher()
+{
+    stop();
+}
+
+bool SongDBWatcher::start(const std::vector<Path>& roots)
+{
+    LOG_INFO << "[SongDB] Watching song folders is not supported on this platform";
+    return false;
+}
+
+void SongDBWatcher::stop()
+{
+}
+
+#endif // __linux__
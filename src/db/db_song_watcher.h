@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "common/types.h"
+
+class SongDB;
+
+// Watches registered song folders and feeds changes into SongDB, so new, removed or modified charts
+// are picked up without a rescan.
+// Bursts of events (e.g. unpacking an archive) are coalesced into one refresh per touched folder.
+// Only implemented with inotify on Linux; start() fails elsewhere.
+class SongDBWatcher
+{
+public:
+    explicit SongDBWatcher(SongDB& db) : _db(db) {}
+    ~SongDBWatcher();
+    SongDBWatcher(const SongDBWatcher&) = delete;
+    SongDBWatcher& operator=(const SongDBWatcher&) = delete;
+
+    bool start(const std::vector<Path>& roots);
+    void stop();
+    bool isRunning() const { return _running; }
+
+private:
+    SongDB& _db;
+    std::vector<Path> _roots;
+    std::thread _thread;
+    std::atomic<bool> _running = false;
+
+#ifdef __linux__
+    int _fd = -1;
+    int _stopFd = -1;
+    std::map<int, Path> _watches;
+
+    void addWatchRecursive(const Path& dir);
+    void removeWatchRecursive(const Path& dir);
+    void readEvents(std::set<Path>& dirtyFolders, bool& overflow);
+    void loop();
+#endif
+};
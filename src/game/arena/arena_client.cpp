@@ -669,7 +669,7 @@ void ArenaClient::handleHostFinishedResult(const std::shared_ptr<ArenaMessage>&
 
 void ArenaClient::update()
 {
-	lunaticvibes::Time now;
+	auto now = lunaticvibes::Time::frame();
 
 	bool alive = true;
 
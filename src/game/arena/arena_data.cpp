@@ -138,7 +138,10 @@ void ArenaData::updateTexts()
 
 void ArenaData::updateGlobals()
 {
-	lunaticvibes::Time t;
+	// rulesets of all players and the ranking are published together
+	State::Batch batch;
+
+	auto t = lunaticvibes::Time::frame();
 	std::vector<std::pair<unsigned, IndexOption>> ranking;
 	for (size_t i = 0; i < getPlayerCount(); ++i)
 	{
@@ -172,6 +175,6 @@ void ArenaData::updateGlobals()
 			exscorePrev = exscore;
 			step = 1;
 		}
-		State::set(op, rank);
+		batch.set(op, rank);
 	}
 }
\ No newline at end of file
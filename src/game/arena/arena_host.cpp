@@ -812,7 +812,7 @@ void ArenaHost::handleFinishedResult(const std::string& clientKey, const std::sh
 
 void ArenaHost::update()
 {
-	lunaticvibes::Time now;
+	auto now = lunaticvibes::Time::frame();
 
 	// wait response timeout
 	{
@@ -164,6 +164,7 @@ std::shared_ptr<ChartObjectBase> ChartObjectBase::createFromChartFormat(int slot
     switch (p->type())
     {
     case eChartFormat::BMS:
+    case eChartFormat::BMSON:
         try
         {
             return std::static_pointer_cast<ChartObjectBase>(std::make_shared<ChartObjectBMS>(slot, std::reinterpret_pointer_cast<ChartFormatBMS>(p)));
@@ -190,11 +191,7 @@ void ChartObjectBase::reset()
 
     // reset notes
     for (auto& ch : _noteLists)
-        for (auto& n : ch)
-        {
-            n.hit = false;
-            n.expired = false;
-        }
+        ch.resetHitState();
 
     // reset iterators
     resetNoteListsIterators();
@@ -324,7 +321,7 @@ Metre ChartObjectBase::getBarMetrePosition(size_t bar)
 {
     if (bar >= _barMetrePos.size())
     {
-		return Metre(LLONG_MAX, 1);
+		return Metre::infinite();
     }
 
 	return _barMetrePos[bar];
@@ -358,7 +355,7 @@ void ChartObjectBase::update(const lunaticvibes::Time& rt)
         _currentBPM = BPM(b->fvalue);
         _currentBeatLength = lunaticvibes::Time::singleBeatLengthFromBPM(_currentBPM);
         _lastChangedBPMTime = b->time - _barTimestamp[_currentBarTemp];
-        _lastChangedBPMMetre = b->pos - _barMetrePos[_currentBarTemp];
+        _lastChangedBPMMetre = (b->pos - _barMetrePos[_currentBarTemp]).toDouble();
         b = nextNoteBpm();
     }
 
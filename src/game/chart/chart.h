@@ -10,12 +10,7 @@
 #include "common/chartformat/chartformat.h"
 #include "game/runtime/state.h"
 #include "game/input/input_mgr.h"
-
-struct HitableNote: Note
-{
-    bool expired = false;
-    bool hit = false;
-};
+#include "note_array.h"
 
 namespace chart
 {
@@ -140,10 +135,10 @@ public:
 
 protected:
      // full list of corresponding channel through all measures; only this list is handled by input looper
-    std::array<std::list<HitableNote>, chart::LANE_COUNT> _noteLists;
-    std::vector<std::list<Note>> _bgmNoteLists;      // BGM notes; handled with timer
-    std::vector<std::list<Note>> _specialNoteLists;     // Special definitions for each format. e.g. BGA, Stop
-    std::list<Note>              _bpmNoteList;          // BPM change is so common that they are not special
+    std::array<chart::NoteArray, chart::LANE_COUNT> _noteLists;
+    std::vector<chart::NoteArray> _bgmNoteLists;        // BGM notes; handled with timer
+    std::vector<chart::NoteArray> _specialNoteLists;    // Special definitions for each format. e.g. BGA, Stop
+    chart::NoteArray              _bpmNoteList;         // BPM change is so common that they are not special
 
 protected:
     std::vector<Metre>   barMetreLength;
@@ -228,9 +223,9 @@ public:
     constexpr auto getCurrentBPM() -> decltype(_currentBPM) { return _currentBPM; }
 
 public:
-    std::list<HitableNote>  noteExpired;
-    std::list<Note>   noteBgmExpired;
-    std::list<Note>   noteSpecialExpired;
+    std::vector<HitableNote> noteExpired;
+    std::vector<Note>        noteBgmExpired;
+    std::vector<Note>        noteSpecialExpired;
 
 public:
     virtual chart::NoteLaneIndex getLaneFromKey(chart::NoteLaneCategory cat, Input::Pad input) = 0;
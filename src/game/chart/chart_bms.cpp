@@ -64,7 +64,7 @@ void ChartObjectBMS::loadBMS(const ChartFormatBMS& objBms)
     }
 
 	lunaticvibes::Time basetime{ 0 };
-	Metre basemetre{ 0, 1 };
+	Metre basemetre;
 
     BPM bpm = objBms.startBPM * gSelectContext.pitchSpeed;
     _currentBPM = bpm;
@@ -225,45 +225,47 @@ void ChartObjectBMS::loadBMS(const ChartFormatBMS& objBms)
 
     size_t lastBarIdx = objBms.lastBarIdx;
 
+    // In case the channels from the file are shuffled, store the data into buffer and sort it out first
+    // The following patterns must be arranged to keep process order by [Notes > BPM > Stop]
+    enum class eLanePriority: unsigned
+    {
+        // Notes
+        NOTE,
+        LNHEAD,
+        LNTAIL,
+        INV,
+        MINE,
+
+        BGM,
+        BGABASE,
+        BGALAYER,
+        BGAPOOR,
+
+        // BPM
+        BPM,
+        EXBPM,
+
+        // Stop
+        STOP,
+    };
+
+    struct Lane
+    {
+        eLanePriority type;
+        unsigned index;
+        bool operator< (const Lane& rhs) const { return std::make_pair(type, index) < std::make_pair(rhs.type, rhs.index); }
+    };
+
+    // notes [] {metre, {lane, sample/val}}, the buffer is reused for each bar
+    std::vector<std::pair<Segment, std::pair<Lane, unsigned>>> notes;
+
     for (unsigned m = 0; m <= objBms.lastBarIdx; m++)
     {
 		barMetreLength.push_back(objBms.metres[m]);
 		_barMetrePos.push_back(basemetre);
         _barTimestamp.push_back(basetime);
 
-        // In case the channels from the file are shuffled, store the data into buffer and sort it out first
-        // The following patterns must be arranged to keep process order by [Notes > BPM > Stop]
-        enum class eLanePriority: unsigned
-        {
-            // Notes
-            NOTE,
-            LNHEAD,
-            LNTAIL,
-            INV,
-            MINE,
-
-            BGM,
-            BGABASE,
-            BGALAYER,
-            BGAPOOR,
-
-            // BPM
-            BPM,
-            EXBPM,
-
-            // Stop
-            STOP,
-        };
-
-        struct Lane
-        {
-            eLanePriority type;
-            unsigned index;
-            bool operator< (const Lane& rhs) const { return std::make_pair(type, index) < std::make_pair(rhs.type, rhs.index); }
-        };
-
-        // notes [] {metre, {lane, sample/val}}
-        std::vector<std::pair<Segment, std::pair<Lane, unsigned>>> notes;
+        notes.clear();
 
         // add notes
         {
@@ -445,8 +447,8 @@ void ChartObjectBMS::loadBMS(const ChartFormatBMS& objBms)
         {
             const auto& [noteSegment, noteinfo] = note;
             const auto& [lane, val] = noteinfo;
-            double metreFromBPMChange = (noteSegment - lastBPMChangedSegment) * barMetre;
-            auto notemetre = static_cast<Metre>(basemetre + noteSegment * barMetre);
+            double metreFromBPMChange = ((noteSegment - lastBPMChangedSegment) * barMetre).toDouble();
+            Metre notemetre = basemetre + noteSegment * barMetre;
 			lunaticvibes::Time notetime = bpmfucked ? LLONG_MAX : basetime + beatLength * (metreFromBPMChange * 4);
 
             if (!leadInTimeSet && (lane.type == eLanePriority::NOTE || lane.type == eLanePriority::LNHEAD || lane.type == eLanePriority::BGM))
@@ -950,7 +952,7 @@ void ChartObjectBMS::postUpdate(const lunaticvibes::Time& vt)
 {
     if (_inStopNote)
     {
-        _currentMetreTemp = _currentStopNote->pos - _barMetrePos[_currentStopNote->measure];
+        _currentMetreTemp = (_currentStopNote->pos - _barMetrePos[_currentStopNote->measure]).toDouble();
     }
     else if (_stopBar == _currentBarTemp)
     {
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include "common/beat.h"
+
+struct HitableNote: Note
+{
+    bool expired = false;
+    bool hit = false;
+};
+
+namespace chart
+{
+
+// Notes of one lane in play order, stored as one array per field. Scanning the lane for times or positions only
+// touches that field, which keeps note scroll, judging and expiry checks cache friendly on long charts.
+// Notes are visited through iterators holding an index; they stay valid while the lane is not modified.
+class NoteArray
+{
+public:
+    struct HitState
+    {
+        bool expired = false;
+        bool hit = false;
+    };
+
+    // Fields of one note, by reference
+    struct Ref
+    {
+        Bar& measure;
+        Metre& pos;
+        lunaticvibes::Time& time;
+        size_t& flags;
+        long long& dvalue;
+        double& fvalue;
+        bool& expired;
+        bool& hit;
+
+        operator HitableNote() const
+        {
+            HitableNote n;
+            n.measure = measure;
+            n.pos = pos;
+            n.time = time;
+            n.flags = flags;
+            n.dvalue = dvalue;
+            n.fvalue = fvalue;
+            n.expired = expired;
+            n.hit = hit;
+            return n;
+        }
+    };
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = HitableNote;
+        using difference_type = std::ptrdiff_t;
+        using reference = Ref;
+        struct pointer
+        {
+            Ref ref;
+            const Ref* operator->() const { return &ref; }
+        };
+
+    private:
+        NoteArray* _notes = nullptr;
+        size_t _idx = 0;
+
+    public:
+        iterator() = default;
+        iterator(NoteArray* notes, size_t idx) : _notes(notes), _idx(idx) {}
+
+        size_t index() const { return _idx; }
+
+        Ref operator*() const { return (*_notes)[_idx]; }
+        pointer operator->() const { return { (*_notes)[_idx] }; }
+
+        iterator& operator++() { ++_idx; return *this; }
+        iterator operator++(int) { iterator tmp = *this; ++_idx; return tmp; }
+        iterator& operator--() { --_idx; return *this; }
+        iterator operator--(int) { iterator tmp = *this; --_idx; return tmp; }
+
+        bool operator==(const iterator& rhs) const { return _idx == rhs._idx && _notes == rhs._notes; }
+        bool operator!=(const iterator& rhs) const { return !(*this == rhs); }
+    };
+
+public:
+    std::vector<Bar> measure;
+    std::vector<Metre> pos;
+    std::vector<lunaticvibes::Time> time;
+    std::vector<size_t> flags;
+    std::vector<long long> dvalue;
+    std::vector<double> fvalue;
+    std::vector<HitState> state;
+
+public:
+    size_t size() const { return time.size(); }
+    bool empty() const { return time.empty(); }
+
+    void push_back(const HitableNote& n)
+    {
+        measure.push_back(n.measure);
+        pos.push_back(n.pos);
+        time.push_back(n.time);
+        flags.push_back(n.flags);
+        dvalue.push_back(n.dvalue);
+        fvalue.push_back(n.fvalue);
+        state.push_back({ n.expired, n.hit });
+    }
+
+    void clear()
+    {
+        measure.clear();
+        pos.clear();
+        time.clear();
+        flags.clear();
+        dvalue.clear();
+        fvalue.clear();
+        state.clear();
+    }
+
+    void resetHitState()
+    {
+        for (auto& s : state)
+            s = {};
+    }
+
+    Ref operator[](size_t i)
+    {
+        return { measure[i], pos[i], time[i], flags[i], dvalue[i], fvalue[i], state[i].expired, state[i].hit };
+    }
+    Ref front() { return (*this)[0]; }
+    Ref back() { return (*this)[size() - 1]; }
+
+    iterator begin() { return { this, 0 }; }
+    iterator end() { return { this, size() }; }
+};
+
+}
@@ -10,6 +10,7 @@
 #include "common/sysutil.h"
 #include "game/scene/scene_context.h"
 #include "game/runtime/generic_info.h"
+#include "game/runtime/input_latency.h"
 
 #include "common/chartformat/chartformat_bms.h"
 
@@ -333,6 +334,8 @@ void mainLoop()
     pScene scene = nullptr;
     while (currentScene != SceneType::EXIT && gNextScene != SceneType::EXIT)
     {
+        lunaticvibes::Time::beginFrame();
+
         // Evenet handling
         event_handle();
         if (gEventQuit)
@@ -398,6 +401,7 @@ void mainLoop()
                 sceneCustomize->draw();
             }
             graphics_flush();
+            InputLatency::framePresented();
         }
         ++gFrameCount[0];
     }
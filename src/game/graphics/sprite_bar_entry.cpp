@@ -300,6 +300,7 @@ bool SpriteBarEntry::update(const lunaticvibes::Time& time)
                 switch (pf->type())
                 {
                 case eChartFormat::BMS:
+                case eChartFormat::BMSON:
                 {
                     const auto bms = std::reinterpret_pointer_cast<const ChartFormatBMSMeta>(pf);
 
@@ -123,7 +123,7 @@ void SpriteLaneVertical::updateNoteRect(const lunaticvibes::Time& t)
 	{
 		// fetch note size, c.y + c.h = judge line pos (top-left corner), -c.h = height start drawing
 		auto c = _current.rect;
-		auto currTotalMetre = pChart->getBarMetrePosition(bar).toDouble() + metre;
+		auto currTotalMetre = pChart->getBarMetrePosition(bar) + Metre(metre);
 
 		// generate note rects and store to buffer
 		// 120BPM with 1.0x HS is 2000ms (500ms/beat, green number 1200)
@@ -132,11 +132,11 @@ void SpriteLaneVertical::updateNoteRect(const lunaticvibes::Time& t)
 		auto it = pChart->incomingNote(_category, _index);
 		while (!pChart->isLastNote(_category, _index, it) && y >= 0)
 		{
-			auto noteMetreOffset = currTotalMetre - it->pos.toDouble();
-			if (noteMetreOffset >= 0)
+			auto noteMetreOffset = currTotalMetre - it->pos;
+			if (noteMetreOffset >= Metre())
 				y = (c.y + c.h); // expired notes stay on judge line, LR2 / pre RA behavior
 			else
-				y = (c.y + c.h) - static_cast<int>(std::floor(-noteMetreOffset * _noteAreaHeight * _basespd * _hispeed));
+				y = (c.y + c.h) - static_cast<int>(std::floor(-noteMetreOffset.toDouble() * _noteAreaHeight * _basespd * _hispeed));
 			it++;
 			_outRect.emplace_front(c.x, (float)y, c.w, -c.h);
 		}
@@ -335,7 +335,7 @@ void SpriteLaneVerticalLN::updateNoteRect(const lunaticvibes::Time& t)
 	{
 		// fetch note size, c.y + c.h = judge line pos (top-left corner), -c.h = height start drawing
 		auto c = _current.rect;
-		auto currTotalMetre = pChart->getBarMetrePosition(bar).toDouble() + metre;
+		auto currTotalMetre = pChart->getBarMetrePosition(bar) + Metre(metre);
 
 		// generate note rects and store to buffer
 		// 120BPM with 1.0x HS is 2000ms (500ms/beat, green number 1200)
@@ -382,11 +382,11 @@ void SpriteLaneVerticalLN::updateNoteRect(const lunaticvibes::Time& t)
 				head_y_actual = c.y + c.h;
 
 				const auto& tail = *it;
-				auto tailMetreOffset = currTotalMetre - tail.pos.toDouble();
-				if (tailMetreOffset >= 0)
+				auto tailMetreOffset = currTotalMetre - tail.pos;
+				if (tailMetreOffset >= Metre())
 					tail_y = (c.y + c.h); // expired notes stay on judge line, LR2 / pre RA behavior
 				else
-					tail_y = (c.y + c.h) - static_cast<int>(std::floor(-tailMetreOffset * _noteAreaHeight * _basespd * _hispeed));
+					tail_y = (c.y + c.h) - static_cast<int>(std::floor(-tailMetreOffset.toDouble() * _noteAreaHeight * _basespd * _hispeed));
 
 				++it;
 			}
@@ -398,15 +398,15 @@ void SpriteLaneVerticalLN::updateNoteRect(const lunaticvibes::Time& t)
 
 				const auto& tail = *it;
 
-				auto headMetreOffset = currTotalMetre - head.pos.toDouble();
-				head_y_actual = (c.y + c.h) - static_cast<int>(std::floor(-headMetreOffset * _noteAreaHeight * _basespd * _hispeed));
+				auto headMetreOffset = currTotalMetre - head.pos;
+				head_y_actual = (c.y + c.h) - static_cast<int>(std::floor(-headMetreOffset.toDouble() * _noteAreaHeight * _basespd * _hispeed));
 				if (head_y_actual < head_y) head_y = head_y_actual;
 
-				auto tailMetreOffset = currTotalMetre - tail.pos.toDouble();
-				if (tailMetreOffset >= 0)
+				auto tailMetreOffset = currTotalMetre - tail.pos;
+				if (tailMetreOffset >= Metre())
 					tail_y = (c.y + c.h); // expired notes stay on judge line, LR2 / pre RA behavior
 				else
-					tail_y = (c.y + c.h) - static_cast<int>(std::floor(-tailMetreOffset * _noteAreaHeight * _basespd * _hispeed));
+					tail_y = (c.y + c.h) - static_cast<int>(std::floor(-tailMetreOffset.toDouble() * _noteAreaHeight * _basespd * _hispeed));
 
 				++it;
 			}
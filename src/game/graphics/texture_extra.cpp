@@ -232,9 +232,9 @@ bool TextureBmsBga::setSlotFromBMS(ChartObjectBMS& bms)
 	baseSlot.clear();
 	layerSlot.clear();
 	poorSlot.clear();
-	const auto lBase = bms.getBgaBase();
-	const auto lLayer = bms.getBgaLayer();
-	const auto lPoor = bms.getBgaPoor();
+	auto& lBase = bms.getBgaBase();
+	auto& lLayer = bms.getBgaLayer();
+	auto& lPoor = bms.getBgaPoor();
 	for (const auto& l : lBase) setSlot(l.dvalue, l.time, true, false, false);
 	for (const auto& l : lLayer) setSlot(l.dvalue, l.time, false, true, false);
 	for (const auto& l : lPoor) setSlot(l.dvalue, l.time, false, false, true);
@@ -0,0 +1,259 @@
+#ifdef __linux__
+
+#include "input_evdev.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <filesystem>
+#include <string>
+
+#include "common/log.h"
+#include "common/sysutil.h"
+#include "input_mgr.h"
+
+// after the game headers: linux/input.h defines KEY_* macros which clash with enumerators like SkinType::KEY_CONFIG
+#include <fcntl.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+static int evdevCodeFromKeyboard(Input::Keyboard k)
+{
+    using namespace Input;
+
+    // Keyboard follows the PC scancode set 1 order, as do the first evdev key codes
+    if (k == Keyboard::K_PRTSC) return KEY_SYSRQ;
+    if (k >= Keyboard::K_ESC && k <= Keyboard::K_NUM_DOT) return (int)k;
+
+    switch (k)
+    {
+    case Keyboard::K_SYSRQ: return KEY_SYSRQ;
+    case Keyboard::K_F11: return KEY_F11;
+    case Keyboard::K_F12: return KEY_F12;
+    case Keyboard::K_F13: return KEY_F13;
+    case Keyboard::K_F14: return KEY_F14;
+    case Keyboard::K_F15: return KEY_F15;
+    case Keyboard::K_PAUSE: return KEY_PAUSE;
+    case Keyboard::K_INS: return KEY_INSERT;
+    case Keyboard::K_DEL: return KEY_DELETE;
+    case Keyboard::K_HOME: return KEY_HOME;
+    case Keyboard::K_END: return KEY_END;
+    case Keyboard::K_PGUP: return KEY_PAGEUP;
+    case Keyboard::K_PGDN: return KEY_PAGEDOWN;
+    case Keyboard::K_RALT: return KEY_RIGHTALT;
+    case Keyboard::K_RCTRL: return KEY_RIGHTCTRL;
+    case Keyboard::K_LEFT: return KEY_LEFT;
+    case Keyboard::K_UP: return KEY_UP;
+    case Keyboard::K_RIGHT: return KEY_RIGHT;
+    case Keyboard::K_DOWN: return KEY_DOWN;
+    case Keyboard::K_JP_YEN: return KEY_YEN;
+    case Keyboard::K_JP_NOCONVERT: return KEY_MUHENKAN;
+    case Keyboard::K_JP_CONVERT: return KEY_HENKAN;
+    case Keyboard::K_JP_KANA: return KEY_KATAKANAHIRAGANA;
+    case Keyboard::K_NUM_SLASH: return KEY_KPSLASH;
+    case Keyboard::K_NUM_STAR: return KEY_KPASTERISK;
+    case Keyboard::K_NUM_ENTER: return KEY_KPENTER;
+    default: return -1;
+    }
+}
+
+static bool testBit(const std::vector<unsigned long>& bits, unsigned bit)
+{
+    constexpr unsigned BITS = sizeof(unsigned long) * CHAR_BIT;
+    return (bits[bit / BITS] >> (bit % BITS)) & 1;
+}
+
+InputEvdev::~InputEvdev()
+{
+    stop();
+}
+
+bool InputEvdev::start(Callback cb)
+{
+    if (isRunning()) return true;
+
+    openDevices();
+    if (_devices.empty())
+    {
+        LOG_WARNING << "[Input] evdev: No readable device in /dev/input";
+        return false;
+    }
+
+    _wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (_wakeFd < 0)
+    {
+        LOG_ERROR << "[Input] evdev: eventfd failed: " << safe_strerror(errno);
+        closeDevices();
+        return false;
+    }
+
+    _callback = std::move(cb);
+    _thread = std::thread(&InputEvdev::run, this);
+    return true;
+}
+
+void InputEvdev::stop()
+{
+    if (!isRunning()) return;
+
+    uint64_t one = 1;
+    [[maybe_unused]] auto ret = write(_wakeFd, &one, sizeof(one));
+    _thread.join();
+
+    close(_wakeFd);
+    _wakeFd = -1;
+    closeDevices();
+}
+
+void InputEvdev::openDevices()
+{
+    // event0, event1, ..., event10: keep the kernel order so joystick indices are stable
+    std::vector<std::pair<int, std::string>> paths;
+    std::error_code ec;
+    for (auto& entry : std::filesystem::directory_iterator("/dev/input", ec))
+    {
+        auto name = entry.path().filename().string();
+        if (name.rfind("event", 0) == 0)
+            paths.emplace_back(std::atoi(name.c_str() + 5), entry.path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    constexpr unsigned BITS = sizeof(unsigned long) * CHAR_BIT;
+    size_t joystickCount = 0;
+    for (auto& [n, path] : paths)
+    {
+        int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) continue;
+
+        std::vector<unsigned long> keys((KEY_CNT + BITS - 1) / BITS);
+        if (ioctl(fd, EVIOCGBIT(EV_KEY, keys.size() * sizeof(unsigned long)), keys.data()) < 0)
+        {
+            close(fd);
+            continue;
+        }
+
+        Device d;
+        d.fd = fd;
+        if (testBit(keys, BTN_JOYSTICK) || testBit(keys, BTN_GAMEPAD) || testBit(keys, BTN_TRIGGER_HAPPY))
+        {
+            if (joystickCount >= InputMgr::MAX_JOYSTICK_COUNT)
+            {
+                close(fd);
+                continue;
+            }
+            d.type = KeyMap::DeviceType::JOYSTICK;
+            d.index = joystickCount++;
+            d.buttons.assign(KEY_CNT, -1);
+            int button = 0;
+            for (unsigned code = BTN_MISC; code < KEY_CNT && button < (int)InputMgr::MAX_JOYSTICK_BUTTON_COUNT; ++code)
+            {
+                if (testBit(keys, code))
+                    d.buttons[code] = button++;
+            }
+        }
+        else if (testBit(keys, KEY_A) && testBit(keys, KEY_SPACE))
+        {
+            d.type = KeyMap::DeviceType::KEYBOARD;
+        }
+        else
+        {
+            close(fd);
+            continue;
+        }
+
+        // timestamps on the clock of lunaticvibes::Time instead of wall time
+        int clock = CLOCK_MONOTONIC;
+        if (ioctl(fd, EVIOCSCLOCKID, &clock) < 0)
+        {
+            LOG_WARNING << "[Input] evdev: " << path << ": Cannot use monotonic timestamps, skipped";
+            close(fd);
+            continue;
+        }
+
+        char name[256] = "";
+        ioctl(fd, EVIOCGNAME(sizeof(name)), name);
+        LOG_INFO << "[Input] evdev: " << path << " (" << name << ") as "
+            << (d.type == KeyMap::DeviceType::JOYSTICK ? "joystick " + std::to_string(d.index) : "keyboard");
+        if (d.type == KeyMap::DeviceType::KEYBOARD)
+            _hasKeyboard = true;
+        _devices.push_back(std::move(d));
+    }
+    _joystickCount = joystickCount;
+}
+
+void InputEvdev::closeDevices()
+{
+    for (auto& d : _devices)
+        close(d.fd);
+    _devices.clear();
+    _hasKeyboard = false;
+    _joystickCount = 0;
+}
+
+void InputEvdev::run()
+{
+    SetThreadName("Input evdev");
+
+    // keyboard: evdev key code -> Input::Keyboard
+    std::vector<int> keyboardKeys(KEY_CNT, -1);
+    for (unsigned k = 1; k < Input::keyboardKeyCount; ++k)
+    {
+        int code = evdevCodeFromKeyboard(Input::Keyboard(k));
+        if (code >= 0 && keyboardKeys[code] < 0)
+            keyboardKeys[code] = (int)k;
+    }
+
+    std::vector<pollfd> fds;
+    fds.push_back({ _wakeFd, POLLIN, 0 });
+    for (auto& d : _devices)
+        fds.push_back({ d.fd, POLLIN, 0 });
+
+    input_event events[64];
+    while (true)
+    {
+        if (poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno == EINTR) continue;
+            LOG_ERROR << "[Input] evdev: poll failed: " << safe_strerror(errno);
+            break;
+        }
+        if (fds[0].revents & POLLIN)
+            break;
+
+        for (size_t i = 1; i < fds.size(); ++i)
+        {
+            if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL))
+            {
+                // unplugged; keep the others running
+                LOG_WARNING << "[Input] evdev: Device lost";
+                fds[i].fd = -1;
+                continue;
+            }
+            if (!(fds[i].revents & POLLIN)) continue;
+
+            const Device& d = _devices[i - 1];
+            ssize_t bytes;
+            while ((bytes = read(d.fd, events, sizeof(events))) > 0)
+            {
+                for (size_t e = 0; e < bytes / sizeof(input_event); ++e)
+                {
+                    const input_event& ev = events[e];
+                    // value 2 is autorepeat
+                    if (ev.type != EV_KEY || ev.value == 2 || ev.code >= KEY_CNT) continue;
+
+                    int index = d.type == KeyMap::DeviceType::KEYBOARD ? keyboardKeys[ev.code] : d.buttons[ev.code];
+                    if (index < 0) continue;
+
+                    long long ns = (long long)ev.input_event_sec * 1'000'000'000 + (long long)ev.input_event_usec * 1000;
+                    _callback({ d.type, d.index, (size_t)index, ev.value != 0, lunaticvibes::Time(ns, true) });
+                }
+            }
+        }
+    }
+}
+
+#endif // __linux__
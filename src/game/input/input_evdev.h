@@ -0,0 +1,62 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "common/beat.h"
+#include "common/keymap.h"
+
+// Event driven input from /dev/input/event*. A thread blocks on the devices and reports every key and button
+// transition with the timestamp the kernel gave the event, on CLOCK_MONOTONIC like lunaticvibes::Time.
+// Keyboards are merged into one. Joysticks are numbered in device order, their buttons in key code order.
+// Axes are not read. Opening the devices usually needs the user to be in the "input" group.
+class InputEvdev
+{
+public:
+    struct Event
+    {
+        KeyMap::DeviceType type;    // KEYBOARD or JOYSTICK
+        size_t device;              // joystick index
+        size_t index;               // Input::Keyboard, or joystick button index
+        bool pressed;
+        lunaticvibes::Time time;
+    };
+    using Callback = std::function<void(const Event&)>;
+
+    InputEvdev() = default;
+    ~InputEvdev();
+    InputEvdev(const InputEvdev&) = delete;
+    InputEvdev& operator=(const InputEvdev&) = delete;
+
+    // Returns false if no device could be opened.
+    bool start(Callback cb);
+    void stop();
+    bool isRunning() const { return _thread.joinable(); }
+    // Devices opened by start(). Joysticks are numbered 0 to joystickCount() - 1.
+    bool hasKeyboard() const { return _hasKeyboard; }
+    size_t joystickCount() const { return _joystickCount; }
+
+private:
+    struct Device
+    {
+        int fd = -1;
+        KeyMap::DeviceType type = KeyMap::DeviceType::UNDEF;
+        size_t index = 0;
+        std::vector<int> buttons;   // key code -> button index, -1 for none
+    };
+    std::vector<Device> _devices;
+    bool _hasKeyboard = false;
+    size_t _joystickCount = 0;
+    int _wakeFd = -1;
+    std::thread _thread;
+    Callback _callback;
+
+    void openDevices();
+    void closeDevices();
+    void run();
+};
+
+#endif // __linux__
@@ -98,6 +98,11 @@ double InputMgr::getDeadzone(Input::Pad k)
     return _inst.padDeadzones[k];
 }
 
+KeyMap InputMgr::getBinding(Input::Pad k)
+{
+    return k >= S1L && k < ESC ? _inst.padBindings[k] : KeyMap();
+}
+
 
 #ifdef RENDER_SDL2
 #include "SDL_mouse.h"
@@ -111,7 +116,7 @@ std::bitset<KEY_COUNT> InputMgr::_detect()
     scratch1 = 0.0;
     scratch2 = 0.0;
 
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
 
     // game input
     for (int k = S1L; k < LANE_COUNT; k++)
@@ -238,4 +243,9 @@ bool InputMgr::getScratchPos(double& x, double& y)
 void InputMgr::setDebounceTime(int ms)
 {
     _inst.debounceTime = ms;
+}
+
+int InputMgr::getDebounceTime()
+{
+    return _inst.debounceTime;
 }
\ No newline at end of file
@@ -43,6 +43,7 @@ public:
     static void updateBindings(GameModeKeys keys, Input::Pad K);
     static void updateDeadzones(GameModeKeys keys);
     static double getDeadzone(Input::Pad k);
+    static KeyMap getBinding(Input::Pad k);
 
     std::bitset<Input::KEY_COUNT> _detect();
     static std::bitset<Input::KEY_COUNT> detect();
@@ -50,6 +51,7 @@ public:
     static bool getScratchPos(double& s1, double& s2);
 
     static void setDebounceTime(int ms);
+    static int getDebounceTime();
 
 };
 
@@ -3,22 +3,32 @@
 #include <cassert>
 #include <mutex>
 #include <utility>
+#include <vector>
 
 #include "common/log.h"
 #include "common/sysutil.h"
 #include "common/utils.h"
+#include "config/config_mgr.h"
 #include "game/runtime/generic_info.h"
+#include "game/runtime/input_latency.h"
 #include "game/runtime/state.h"
 
 InputWrapper::InputWrapper(unsigned rate, bool background) : 
     AsyncLooper("Input loop", std::bind(&InputWrapper::_loop, this), rate),
     _background(background)
 {
+    setThreadPolicy(AsyncLooper::ThreadPolicy::parse(
+        ConfigMgr::get('E', cfg::E_THREAD_INPUT_CPUS, ""),
+        ConfigMgr::get('E', cfg::E_THREAD_INPUT_SCHED, cfg::E_THREAD_SCHED_NORMAL),
+        ConfigMgr::get('E', cfg::E_THREAD_INPUT_PRIORITY, 80)));
 }
 
 InputWrapper::~InputWrapper()
 {
     assert(!isRunning());
+#ifdef __linux__
+    _evdev.stop();
+#endif
     {
         std::unique_lock _lock(_inputMutex);
         _pCallbackMap.clear();
@@ -34,13 +44,125 @@ void InputWrapper::setRate(unsigned rate)
     AsyncLooper::setRate(rate);
 }
 
+void InputWrapper::loopStart()
+{
+#ifdef __linux__
+    if (ConfigMgr::get('P', cfg::P_INPUT_EVDEV, false) && !_evdev.isRunning())
+    {
+        if (!_evdev.start([this](const InputEvdev::Event& e) { _evdevEvent(e); }))
+            LOG_WARNING << "[Input] evdev is not available, using polled input";
+    }
+#endif
+    _prevPollNs = 0;
+    AsyncLooper::loopStart();
+}
+
+void InputWrapper::loopEnd()
+{
+    AsyncLooper::loopEnd();
+#ifdef __linux__
+    _evdev.stop();
+    std::unique_lock l(_evdevMutex);
+    _evdevLanes.fill({});
+#endif
+}
+
+#ifdef __linux__
+InputMask InputWrapper::_evdevOwnedLanes() const
+{
+    InputMask owned;
+    if (!_evdev.isRunning())
+        return owned;
+
+    for (Input::Pad i = Input::S1L; i < Input::LANE_COUNT; ++(int&)i)
+    {
+        // lanes bound to a device evdev did not open are still polled
+        auto k = InputMgr::getBinding(i);
+        if ((k.getType() == KeyMap::DeviceType::KEYBOARD && _evdev.hasKeyboard()) ||
+            (k.getType() == KeyMap::DeviceType::JOYSTICK && k.getJoystick().type == Input::Joystick::Type::BUTTON &&
+             k.getJoystick().device < _evdev.joystickCount()))
+        {
+            owned.set(mergeInput && i >= Input::S2L ? i - Input::S2L : i);
+        }
+    }
+    return owned;
+}
+
+void InputWrapper::_evdevEvent(const InputEvdev::Event& e)
+{
+    for (Input::Pad i = Input::S1L; i < Input::LANE_COUNT; ++(int&)i)
+    {
+        auto k = InputMgr::getBinding(i);
+        if (k.getType() != e.type)
+            continue;
+        if (e.type == KeyMap::DeviceType::KEYBOARD)
+        {
+            if (static_cast<size_t>(k.getKeyboard()) != e.index)
+                continue;
+        }
+        else
+        {
+            auto j = k.getJoystick();
+            if (j.type != Input::Joystick::Type::BUTTON || j.device != e.device || j.index != e.index)
+                continue;
+        }
+
+        size_t lane = mergeInput && i >= Input::S2L ? i - Input::S2L : i;
+        bool pressed = false;
+        {
+            std::unique_lock l(_evdevMutex);
+            auto& s = _evdevLanes[lane];
+            if (e.pressed)
+            {
+                s.down = true;
+                if (!s.held && (_background || IsWindowForeground()))
+                {
+                    s.held = true;
+                    s.pressTime = e.time;
+                    InputLatency::recordSince(InputLatency::Stage::INPUT, e.time);
+                    if (_queued)
+                    {
+                        InputMask p, live;
+                        p.set(lane);
+                        for (size_t i = 0; i < _evdevLanes.size(); ++i)
+                            live[i] = _evdevLanes[i].held;
+                        _pushEvent(_evdevEvents, { QueuedEvent::Type::PRESS, p, { 0., 0. }, e.time, lunaticvibes::Time() }, live);
+                    }
+                    else
+                    {
+                        pressed = true;
+                    }
+                }
+            }
+            else
+            {
+                s.down = false;
+                s.releaseTime = e.time;
+            }
+        }
+        if (pressed)
+        {
+            InputMask p;
+            p.set(lane);
+            std::unique_lock d(_dispatchMutex);
+            std::shared_lock l(_inputMutex);
+            for (auto& [cbname, callback] : _pCallbackMap)
+                callback(p, e.time);
+        }
+    }
+}
+#endif
+
 void InputWrapper::_loop()
 {
     gFrameCount[FRAMECOUNT_IDX_INPUT]++;
 
     _prev = _curr;
     _curr = InputMgr::detect();
-    lunaticvibes::Time now;
+    auto now = lunaticvibes::Time::frame();
+    if (_prevPollNs != 0)
+        InputLatency::record(InputLatency::Stage::POLL_INTERVAL, now.hres() - _prevPollNs);
+    _prevPollNs = now.hres();
 
     // detect key / button
     InputMask p{ 0 }, h{ 0 }, r{ 0 };
@@ -54,8 +176,15 @@ void InputWrapper::_loop()
         curr |= (curr >> Input::S2L) & INPUT_MASK_1P;
         curr &= ~INPUT_MASK_2P;
     }
+#ifdef __linux__
+    InputMask evdevLanes = _evdevOwnedLanes();
+#endif
     for (Input::Pad i = Input::S1L; i < Input::KEY_COUNT; ++(int&)i)
     {
+#ifdef __linux__
+        if (evdevLanes[i])
+            continue;
+#endif
         auto& [ms, stat] = _inputBuffer[i];
         if (curr[i] && !stat)
         {
@@ -83,6 +212,59 @@ void InputWrapper::_loop()
         }
     }
 
+#ifdef __linux__
+    // evdev lanes: presses are already sent, release with the kernel time once the delays have passed
+    InputMask evdevH;
+    std::vector<std::pair<size_t, lunaticvibes::Time>> evdevReleased;
+    if (evdevLanes.any())
+    {
+        bool focused = _background || IsWindowForeground();
+        long long debounceMs = InputMgr::getDebounceTime();
+        std::unique_lock l(_evdevMutex);
+        for (size_t i = Input::S1L; i < Input::LANE_COUNT; ++i)
+        {
+            auto& s = _evdevLanes[i];
+            if (!evdevLanes[i] || !s.held)
+                continue;
+            if (!focused)
+            {
+                s.held = false;
+                evdevReleased.emplace_back(i, now);
+            }
+            else if (!s.down && (now - s.releaseTime).norm() >= release_delay_ms && (now - s.pressTime).norm() >= debounceMs)
+            {
+                s.held = false;
+                evdevReleased.emplace_back(i, s.releaseTime);
+            }
+            else
+            {
+                evdevH.set(i);
+            }
+        }
+        if (_queued)
+        {
+            // queued under the lock so they stay behind the presses queued by the evdev thread. Releases keep
+            // the kernel time for the callbacks but are ordered at this tick, and go before the tick's hold.
+            InputMask live = evdevH;
+            for (auto& [lane, time] : evdevReleased)
+                live.set(lane);
+            for (auto& [lane, time] : evdevReleased)
+            {
+                InputMask m;
+                m.set(lane);
+                _pushEvent(_evdevEvents, { QueuedEvent::Type::RELEASE, m, { 0., 0. }, time, now }, live);
+            }
+            if (evdevH.any())
+                _pushEvent(_evdevEvents, { QueuedEvent::Type::HOLD, evdevH, { 0., 0. }, now, now }, live);
+            evdevReleased.clear();
+        }
+        else
+        {
+            h |= evdevH;
+        }
+    }
+#endif
+
     // detect absolute axis
     scratchAxisPrev[0] = scratchAxisCurr[0];
     scratchAxisPrev[1] = scratchAxisCurr[1];
@@ -226,7 +408,39 @@ void InputWrapper::_loop()
     }
 
     // regular callbacks
+    if (_queued)
+    {
+        const InputMask live = p | h | r;
+        if (p != 0)
+            _pushEvent(_pollEvents, { QueuedEvent::Type::PRESS, p, { 0., 0. }, now, now }, live);
+        if (h != 0)
+            _pushEvent(_pollEvents, { QueuedEvent::Type::HOLD, h, { 0., 0. }, now, now }, live);
+        if (r != 0)
+            _pushEvent(_pollEvents, { QueuedEvent::Type::RELEASE, r, { 0., 0. }, now, now }, live);
+        if (aDelta[0] != 0.0 || aDelta[1] != 0.0)
+        {
+            if (mergeInput)
+                _pushEvent(_pollEvents, { QueuedEvent::Type::AXIS, 0, { aDelta[0] + aDelta[1], 0.0 }, now, now }, live);
+            else
+                _pushEvent(_pollEvents, { QueuedEvent::Type::AXIS, 0, { aDelta[0], aDelta[1] }, now, now }, live);
+        }
+    }
+    else
     {
+#ifdef __linux__
+        std::unique_lock d(_dispatchMutex);
+        if (!evdevReleased.empty())
+        {
+            std::shared_lock l(_inputMutex);
+            for (auto& [lane, time] : evdevReleased)
+            {
+                InputMask m;
+                m.set(lane);
+                for (auto& [cbname, callback] : _rCallbackMap)
+                    callback(m, time);
+            }
+        }
+#endif
         std::shared_lock l(_inputMutex, std::defer_lock);
         if (l.try_lock())
         {
@@ -252,6 +466,115 @@ void InputWrapper::_loop()
     }
 }
 
+void InputWrapper::_pushEvent(EventQueue& q, QueuedEvent e, const InputMask& live)
+{
+    // a press from the evdev thread may be detected after the loop took its tick time
+    if (e.order < q.lastOrder)
+        e.order = q.lastOrder;
+    q.lastOrder = e.order;
+
+    if (q.lost)
+    {
+        if (InputMask stuck = q.sentHeld & ~live; stuck.any())
+        {
+            if (!q.ring.tryPush({ QueuedEvent::Type::RELEASE, stuck, { 0., 0. }, e.time, e.order }))
+            {
+                _droppedEvents.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            q.sentHeld &= ~stuck;
+        }
+        q.lost = false;
+    }
+
+    if (!q.ring.tryPush(e))
+    {
+        _droppedEvents.fetch_add(1, std::memory_order_relaxed);
+        q.lost = true;
+        return;
+    }
+    if (e.type == QueuedEvent::Type::PRESS)
+        q.sentHeld |= e.mask;
+    else if (e.type == QueuedEvent::Type::RELEASE)
+        q.sentHeld &= ~e.mask;
+}
+
+void InputWrapper::dispatchQueued()
+{
+    std::shared_lock l(_inputMutex);
+
+    auto dispatch = [this](const QueuedEvent& e)
+    {
+        InputMask m = e.mask;
+        switch (e.type)
+        {
+        case QueuedEvent::Type::PRESS:
+            for (auto& [cbname, callback] : _pCallbackMap)
+                callback(m, e.time);
+            break;
+        case QueuedEvent::Type::HOLD:
+            for (auto& [cbname, callback] : _hCallbackMap)
+                callback(m, e.time);
+            break;
+        case QueuedEvent::Type::RELEASE:
+            for (auto& [cbname, callback] : _rCallbackMap)
+                callback(m, e.time);
+            break;
+        case QueuedEvent::Type::AXIS:
+            for (auto& [cbname, callback] : _aCallbackMap)
+                callback(e.axis[0], e.axis[1], e.time);
+            break;
+        }
+    };
+
+    // merge the two rings by detection order. Within one tick holds go last, so the holds both loop passes push
+    // meet and go out as one mask.
+    auto before = [](const QueuedEvent& a, const QueuedEvent& b)
+    {
+        if (a.order != b.order)
+            return a.order < b.order;
+        return a.type != QueuedEvent::Type::HOLD || b.type == QueuedEvent::Type::HOLD;
+    };
+    QueuedEvent pollHead, evdevHead;
+    bool hasPoll = _pollEvents.ring.tryPop(pollHead);
+#ifdef __linux__
+    bool hasEvdev = _evdevEvents.ring.tryPop(evdevHead);
+#else
+    bool hasEvdev = false;
+#endif
+    auto next = [&](bool evdev)
+    {
+#ifdef __linux__
+        if (evdev)
+            hasEvdev = _evdevEvents.ring.tryPop(evdevHead);
+        else
+#endif
+            hasPoll = _pollEvents.ring.tryPop(pollHead);
+    };
+    while (hasPoll || hasEvdev)
+    {
+        const bool evdev = hasEvdev && (!hasPoll || before(evdevHead, pollHead));
+        QueuedEvent e = evdev ? evdevHead : pollHead;
+        next(evdev);
+
+        const bool hasOther = evdev ? hasPoll : hasEvdev;
+        const QueuedEvent& other = evdev ? pollHead : evdevHead;
+        if (e.type == QueuedEvent::Type::HOLD && hasOther && other.type == QueuedEvent::Type::HOLD && other.order == e.order)
+        {
+            e.mask |= other.mask;
+            next(!evdev);
+        }
+        dispatch(e);
+    }
+
+    unsigned dropped = _droppedEvents.load(std::memory_order_relaxed);
+    if (dropped != _droppedEventsReported)
+    {
+        LOG_WARNING << "[Input] Event queue full, " << dropped - _droppedEventsReported << " events dropped";
+        _droppedEventsReported = dropped;
+    }
+}
+
 double InputWrapper::getJoystickAxis(size_t device, Input::Joystick::Type type, size_t index)
 {
     return ::getJoystickAxis(device, type, index);
@@ -4,8 +4,10 @@
 #include <queue>
 #include <set>
 #include "input_mgr.h"
+#include "input_evdev.h"
 #include "common/asynclooper.h"
 #include "common/beat.h"
+#include "common/spsc_ring.h"
 
 typedef std::bitset<Input::Pad::KEY_COUNT> InputMask;
 typedef std::function<void(InputMask&, const lunaticvibes::Time&)> INPUTCALLBACK;
@@ -80,6 +82,8 @@ protected:
 
     bool mergeInput = false;
 
+    long long _prevPollNs = 0;
+
 public:
     InputWrapper(unsigned rate = 1000, bool background = false);
     ~InputWrapper() override;
@@ -87,9 +91,71 @@ public:
 public:
     void setRate(unsigned rate_per_sec);
 
+    // Also starts / stops the evdev reader on Linux when enabled in the profile
+    void loopStart();
+    void loopEnd();
+
 private:
     virtual void _loop();
 
+public:
+    // Queue pad and axis events instead of calling the p/h/r/a callbacks from the input thread. The owner calls
+    // dispatchQueued() from its own thread; events keep their timestamps and are dispatched in the order they
+    // were detected. Evdev releases are detected by the loop after release_delay_ms, so they are dispatched
+    // after events of earlier ticks even though their kernel timestamp may be older.
+    void setQueuedDispatch() { _queued = true; }
+    void dispatchQueued();
+
+protected:
+    struct QueuedEvent
+    {
+        enum class Type : uint8_t { PRESS, HOLD, RELEASE, AXIS } type = Type::PRESS;
+        InputMask mask;
+        double axis[2] = { 0., 0. };
+        lunaticvibes::Time time;    // passed to the callbacks
+        lunaticvibes::Time order;   // detection time, dispatch order across queues
+    };
+    static constexpr size_t QUEUED_EVENT_COUNT = 2048;
+    struct EventQueue
+    {
+        lunaticvibes::SpscRing<QueuedEvent, QUEUED_EVENT_COUNT> ring;
+        // producer side: lanes the consumer was told are pressed and not yet released, and whether an event
+        // was dropped since the last successful push
+        InputMask sentHeld;
+        bool lost = false;
+        // producer side: order of the last push; later pushes never go before it
+        lunaticvibes::Time lastOrder{ 0 };
+    };
+    bool _queued = false;
+    EventQueue _pollEvents;     // polled lanes and axes, pushed by the loop
+    std::atomic<unsigned> _droppedEvents{ 0 };
+    unsigned _droppedEventsReported = 0;
+
+    // live: lanes still held, or released by events pushed in the same tick. After a drop, lanes the consumer
+    // still believes held but that are not live are released first, so a dropped release cannot leave a key stuck.
+    void _pushEvent(EventQueue& q, QueuedEvent e, const InputMask& live);
+
+#ifdef __linux__
+protected:
+    // Lanes read from evdev. Presses are sent from the evdev thread as soon as they arrive with the kernel timestamp;
+    // holds and releases are sent from the loop so release_delay_ms and the debounce time still apply.
+    struct EvdevLane
+    {
+        bool down = false;      // physical state
+        bool held = false;      // state reported to callbacks
+        lunaticvibes::Time pressTime;
+        lunaticvibes::Time releaseTime;
+    };
+    InputEvdev _evdev;
+    std::mutex _evdevMutex;
+    std::array<EvdevLane, Input::LANE_COUNT> _evdevLanes{};
+    std::mutex _dispatchMutex;  // callbacks are not called from both threads at once
+    EventQueue _evdevEvents;    // evdev lanes, pushed under _evdevMutex by either thread
+
+    InputMask _evdevOwnedLanes() const;
+    void _evdevEvent(const InputEvdev::Event& e);
+#endif
+
 public:
     bool isPressed(Input::Pad k) 
     {
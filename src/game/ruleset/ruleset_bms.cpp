@@ -4,6 +4,7 @@
 
 #include "game/arena/arena_data.h"
 #include "game/chart/chart_bms.h"
+#include "game/runtime/input_latency.h"
 #include "game/runtime/state.h"
 #include "game/scene/scene_context.h"
 #include "game/sound/sound_mgr.h"
@@ -421,10 +422,10 @@ void RulesetBMS::initGaugeParams(PlayModifierGaugeType gauge)
         switch (_format->type())
         {
         case eChartFormat::BMS:
+        case eChartFormat::BMSON:
             _format->getExtendedProperty("TOTAL", (void*)&total);
             break;
 
-        case eChartFormat::BMSON:
         default:
             break;
         }
@@ -583,7 +584,7 @@ void RulesetBMS::initGaugeParams(PlayModifierGaugeType gauge)
     }
 }
 
-RulesetBMS::JudgeRes RulesetBMS::_judge(const Note& note, const lunaticvibes::Time& time)
+RulesetBMS::JudgeRes RulesetBMS::_judge(const NoteArray::Ref& note, const lunaticvibes::Time& time)
 {
     // spot judge area
     JudgeArea a = JudgeArea::NOTHING;
@@ -661,7 +662,7 @@ static const std::map<RulesetBMS::JudgeArea, ReplayChart::Commands::Type> judgeA
     }
 };
 
-void RulesetBMS::_judgePress(NoteLaneCategory cat, NoteLaneIndex idx, HitableNote& note, const JudgeRes& judge, const lunaticvibes::Time& t, int slot)
+void RulesetBMS::_judgePress(NoteLaneCategory cat, NoteLaneIndex idx, NoteArray::Ref note, const JudgeRes& judge, const lunaticvibes::Time& t, int slot)
 {
     if (cat == NoteLaneCategory::LN && 
         (note.flags & Note::LN_TAIL) &&
@@ -785,7 +786,7 @@ void RulesetBMS::_judgePress(NoteLaneCategory cat, NoteLaneIndex idx, HitableNot
         }
     }
 }
-void RulesetBMS::_judgeHold(NoteLaneCategory cat, NoteLaneIndex idx, HitableNote& note, const JudgeRes& judge, const lunaticvibes::Time& t, int slot)
+void RulesetBMS::_judgeHold(NoteLaneCategory cat, NoteLaneIndex idx, NoteArray::Ref note, const JudgeRes& judge, const lunaticvibes::Time& t, int slot)
 {
     switch (cat)
     {
@@ -877,7 +878,7 @@ void RulesetBMS::_judgeHold(NoteLaneCategory cat, NoteLaneIndex idx, HitableNote
         break;
     }
 }
-void RulesetBMS::_judgeRelease(NoteLaneCategory cat, NoteLaneIndex idx, HitableNote& note, const JudgeRes& judge, const lunaticvibes::Time& t, int slot)
+void RulesetBMS::_judgeRelease(NoteLaneCategory cat, NoteLaneIndex idx, NoteArray::Ref note, const JudgeRes& judge, const lunaticvibes::Time& t, int slot)
 {
     bool pushReplayCommand = false;
     switch (cat)
@@ -1116,36 +1117,36 @@ void RulesetBMS::updateJudge(const lunaticvibes::Time& t, const NoteLaneIndex ch
 void RulesetBMS::judgeNotePress(Input::Pad k, const lunaticvibes::Time& t, const lunaticvibes::Time& rt, int slot)
 {
     NoteLaneIndex idx1 = _chart->getLaneFromKey(NoteLaneCategory::Note, k);
-    HitableNote* pNote1 = nullptr;
+    ChartObjectBase::NoteIterator itNote1;
+    bool hasNote1 = false;
     if (idx1 != _ && !_chart->isLastNote(NoteLaneCategory::Note, idx1))
     {
-        auto itNote = _chart->incomingNote(NoteLaneCategory::Note, idx1);
-        while (!_chart->isLastNote(NoteLaneCategory::Note, idx1, itNote) && itNote->expired)
-            ++itNote;
-        if (!_chart->isLastNote(NoteLaneCategory::Note, idx1, itNote))
-            pNote1 = &*itNote;
+        itNote1 = _chart->incomingNote(NoteLaneCategory::Note, idx1);
+        while (!_chart->isLastNote(NoteLaneCategory::Note, idx1, itNote1) && itNote1->expired)
+            ++itNote1;
+        hasNote1 = !_chart->isLastNote(NoteLaneCategory::Note, idx1, itNote1);
     }
     NoteLaneIndex idx2 = _chart->getLaneFromKey(NoteLaneCategory::LN, k);
-    HitableNote* pNote2 = nullptr;
+    ChartObjectBase::NoteIterator itNote2;
+    bool hasNote2 = false;
     if (idx2 != _ && !_chart->isLastNote(NoteLaneCategory::LN, idx2))
     {
-        auto itNote = _chart->incomingNote(NoteLaneCategory::LN, idx2);
-        while (!_chart->isLastNote(NoteLaneCategory::LN, idx2, itNote) && itNote->expired)
-            ++itNote;
-        if (!_chart->isLastNote(NoteLaneCategory::LN, idx2, itNote))
-            pNote2 = &*itNote;
+        itNote2 = _chart->incomingNote(NoteLaneCategory::LN, idx2);
+        while (!_chart->isLastNote(NoteLaneCategory::LN, idx2, itNote2) && itNote2->expired)
+            ++itNote2;
+        hasNote2 = !_chart->isLastNote(NoteLaneCategory::LN, idx2, itNote2);
     }
 
     JudgeRes j;
-    if (pNote1 && (pNote2 == nullptr || pNote1->time < pNote2->time) && !pNote1->expired)
+    if (hasNote1 && (!hasNote2 || itNote1->time < itNote2->time) && !itNote1->expired)
     {
-        j = _judge(*pNote1, rt);
-        _judgePress(NoteLaneCategory::Note, idx1, *pNote1, j, t, slot);
+        j = _judge(*itNote1, rt);
+        _judgePress(NoteLaneCategory::Note, idx1, *itNote1, j, t, slot);
     }
-    else if (pNote2 && !pNote2->expired)
+    else if (hasNote2 && !itNote2->expired)
     {
-        j = _judge(*pNote2, rt);
-        _judgePress(NoteLaneCategory::LN, idx2, *pNote2, j, t, slot);
+        j = _judge(*itNote2, rt);
+        _judgePress(NoteLaneCategory::LN, idx2, *itNote2, j, t, slot);
     }
 
     // break-out BAD chain 
@@ -1162,7 +1163,7 @@ void RulesetBMS::judgeNoteHold(Input::Pad k, const lunaticvibes::Time& t, const
     idx = _chart->getLaneFromKey(NoteLaneCategory::Mine, k);
     if (idx != _ && !_chart->isLastNote(NoteLaneCategory::Mine, idx))
     {
-        auto& note = *_chart->incomingNote(NoteLaneCategory::Mine, idx);
+        auto note = *_chart->incomingNote(NoteLaneCategory::Mine, idx);
         auto j = _judge(note, rt);
         _judgeHold(NoteLaneCategory::Mine, idx, note, j, t, slot);
     }
@@ -1170,7 +1171,7 @@ void RulesetBMS::judgeNoteHold(Input::Pad k, const lunaticvibes::Time& t, const
     idx = _chart->getLaneFromKey(NoteLaneCategory::LN, k);
     if (idx != _ && !_chart->isLastNote(NoteLaneCategory::LN, idx))
     {
-        auto& note = *_chart->incomingNote(NoteLaneCategory::LN, idx);
+        auto note = *_chart->incomingNote(NoteLaneCategory::LN, idx);
         auto j = _judge(note, rt);
         _judgeHold(NoteLaneCategory::LN, idx, note, j, t, slot);
     }
@@ -1204,6 +1205,8 @@ void RulesetBMS::updatePress(InputMask& pg, const lunaticvibes::Time& t)
         for (size_t k = begin; k <= static_cast<size_t>(end); ++k)
         {
             if (!pg[k]) continue;
+            if (_recordLatency)
+                InputLatency::recordSince(InputLatency::Stage::JUDGE, t);
             judgeNotePress((Input::Pad)k, t, rt, slot);
         }
     };
@@ -1644,40 +1647,43 @@ void RulesetBMS::fail()
 
 void RulesetBMS::updateGlobals()
 {
+    // published as one batch, so score, combo and gauge are always seen together
+    State::Batch batch;
+
     if (_side == PlaySide::SINGLE || _side == PlaySide::DOUBLE || _side == PlaySide::BATTLE_1P || _side == PlaySide::AUTO || _side == PlaySide::AUTO_DOUBLE) // includes DP
     {
         if (!gArenaData.isOnline())
         {
-            State::set(IndexBargraph::PLAY_EXSCORE, _basic.total_acc / 100.0);
-            State::set(IndexBargraph::PLAY_EXSCORE_PREDICT, _basic.acc / 100.0);
+            batch.set(IndexBargraph::PLAY_EXSCORE, _basic.total_acc / 100.0);
+            batch.set(IndexBargraph::PLAY_EXSCORE_PREDICT, _basic.acc / 100.0);
         }
-        State::set(IndexBargraph::PLAY_EXSCORE_BACKUP, _basic.total_acc / 100.0);
-
-        State::set(IndexNumber::PLAY_1P_SCORE, int(std::round(moneyScore)));
-        State::set(IndexNumber::PLAY_1P_EXSCORE, exScore);
-        State::set(IndexNumber::PLAY_1P_NOWCOMBO, _basic.combo + _basic.comboDisplay);
-        State::set(IndexNumber::PLAY_1P_MAXCOMBO, _basic.maxComboDisplay);
-        State::set(IndexNumber::PLAY_1P_RATE, int(std::floor(_basic.acc)));
-        State::set(IndexNumber::PLAY_1P_RATEDECIMAL, int(std::floor((_basic.acc - int(_basic.acc)) * 100)));
-        State::set(IndexNumber::PLAY_1P_TOTALNOTES, getNoteCount());
-        State::set(IndexNumber::PLAY_1P_TOTAL_RATE, int(std::floor(_basic.total_acc)));
-        State::set(IndexNumber::PLAY_1P_TOTAL_RATE_DECIMAL2, int(std::floor((_basic.total_acc - int(_basic.total_acc)) * 100)));
-        State::set(IndexNumber::PLAY_1P_PERFECT, _basic.judge[JUDGE_PERFECT]);
-        State::set(IndexNumber::PLAY_1P_GREAT, _basic.judge[JUDGE_GREAT]);
-        State::set(IndexNumber::PLAY_1P_GOOD, _basic.judge[JUDGE_GOOD]);
-        State::set(IndexNumber::PLAY_1P_BAD, _basic.judge[JUDGE_BAD]);
-        State::set(IndexNumber::PLAY_1P_POOR, _basic.judge[JUDGE_POOR]);
-        State::set(IndexNumber::PLAY_1P_GROOVEGAUGE, int(_basic.health * 100));
-
-        State::set(IndexNumber::PLAY_1P_MISS, _basic.judge[JUDGE_MISS]);
-        State::set(IndexNumber::PLAY_1P_FAST_COUNT, _basic.judge[JUDGE_EARLY]);
-        State::set(IndexNumber::PLAY_1P_SLOW_COUNT, _basic.judge[JUDGE_LATE]);
-        State::set(IndexNumber::PLAY_1P_COMBOBREAK, _basic.judge[JUDGE_CB]);
-        State::set(IndexNumber::PLAY_1P_BPOOR, _basic.judge[JUDGE_KPOOR]);
-        State::set(IndexNumber::PLAY_1P_BP, _basic.judge[JUDGE_BP]);
-        State::set(IndexNumber::LR2IR_REPLACE_PLAY_1P_FAST_COUNT, _basic.judge[JUDGE_EARLY]);
-        State::set(IndexNumber::LR2IR_REPLACE_PLAY_1P_SLOW_COUNT, _basic.judge[JUDGE_LATE]);
-        State::set(IndexNumber::LR2IR_REPLACE_PLAY_1P_COMBOBREAK, _basic.judge[JUDGE_CB]);
+        batch.set(IndexBargraph::PLAY_EXSCORE_BACKUP, _basic.total_acc / 100.0);
+
+        batch.set(IndexNumber::PLAY_1P_SCORE, int(std::round(moneyScore)));
+        batch.set(IndexNumber::PLAY_1P_EXSCORE, exScore);
+        batch.set(IndexNumber::PLAY_1P_NOWCOMBO, _basic.combo + _basic.comboDisplay);
+        batch.set(IndexNumber::PLAY_1P_MAXCOMBO, _basic.maxComboDisplay);
+        batch.set(IndexNumber::PLAY_1P_RATE, int(std::floor(_basic.acc)));
+        batch.set(IndexNumber::PLAY_1P_RATEDECIMAL, int(std::floor((_basic.acc - int(_basic.acc)) * 100)));
+        batch.set(IndexNumber::PLAY_1P_TOTALNOTES, getNoteCount());
+        batch.set(IndexNumber::PLAY_1P_TOTAL_RATE, int(std::floor(_basic.total_acc)));
+        batch.set(IndexNumber::PLAY_1P_TOTAL_RATE_DECIMAL2, int(std::floor((_basic.total_acc - int(_basic.total_acc)) * 100)));
+        batch.set(IndexNumber::PLAY_1P_PERFECT, _basic.judge[JUDGE_PERFECT]);
+        batch.set(IndexNumber::PLAY_1P_GREAT, _basic.judge[JUDGE_GREAT]);
+        batch.set(IndexNumber::PLAY_1P_GOOD, _basic.judge[JUDGE_GOOD]);
+        batch.set(IndexNumber::PLAY_1P_BAD, _basic.judge[JUDGE_BAD]);
+        batch.set(IndexNumber::PLAY_1P_POOR, _basic.judge[JUDGE_POOR]);
+        batch.set(IndexNumber::PLAY_1P_GROOVEGAUGE, int(_basic.health * 100));
+
+        batch.set(IndexNumber::PLAY_1P_MISS, _basic.judge[JUDGE_MISS]);
+        batch.set(IndexNumber::PLAY_1P_FAST_COUNT, _basic.judge[JUDGE_EARLY]);
+        batch.set(IndexNumber::PLAY_1P_SLOW_COUNT, _basic.judge[JUDGE_LATE]);
+        batch.set(IndexNumber::PLAY_1P_COMBOBREAK, _basic.judge[JUDGE_CB]);
+        batch.set(IndexNumber::PLAY_1P_BPOOR, _basic.judge[JUDGE_KPOOR]);
+        batch.set(IndexNumber::PLAY_1P_BP, _basic.judge[JUDGE_BP]);
+        batch.set(IndexNumber::LR2IR_REPLACE_PLAY_1P_FAST_COUNT, _basic.judge[JUDGE_EARLY]);
+        batch.set(IndexNumber::LR2IR_REPLACE_PLAY_1P_SLOW_COUNT, _basic.judge[JUDGE_LATE]);
+        batch.set(IndexNumber::LR2IR_REPLACE_PLAY_1P_COMBOBREAK, _basic.judge[JUDGE_CB]);
 
         if (showJudge)
         {
@@ -1704,51 +1710,53 @@ void RulesetBMS::updateGlobals()
             };
 
             const int fs_of_player = get_fastslow(_lastNoteJudge[PLAYER_SLOT_PLAYER].area);
-            State::set(IndexNumber::LR2IR_REPLACE_PLAY_1P_FAST_SLOW, fs_of_player);
-            State::set(IndexOption::PLAY_LAST_JUDGE_FASTSLOW_1P, fs_of_player);
-            State::set(IndexNumber::LR2IR_REPLACE_PLAY_1P_JUDGE_TIME_ERROR_MS, _lastNoteJudge[PLAYER_SLOT_PLAYER].time.norm());
-            State::set(IndexNumber::PLAY_1P_JUDGE_TIME_ERROR_MS, _lastNoteJudge[PLAYER_SLOT_PLAYER].time.norm());
+            batch.set(IndexNumber::LR2IR_REPLACE_PLAY_1P_FAST_SLOW, fs_of_player);
+            batch.set(IndexOption::PLAY_LAST_JUDGE_FASTSLOW_1P, fs_of_player);
+            batch.set(IndexNumber::LR2IR_REPLACE_PLAY_1P_JUDGE_TIME_ERROR_MS, _lastNoteJudge[PLAYER_SLOT_PLAYER].time.norm());
+            batch.set(IndexNumber::PLAY_1P_JUDGE_TIME_ERROR_MS, _lastNoteJudge[PLAYER_SLOT_PLAYER].time.norm());
 
             if (_side == PlaySide::DOUBLE || _side == PlaySide::AUTO_DOUBLE)
             {
                 const int fs_of_target = get_fastslow(_lastNoteJudge[PLAYER_SLOT_TARGET].area);
-                State::set(IndexNumber::LR2IR_REPLACE_PLAY_2P_FAST_SLOW, fs_of_target);
-                State::set(IndexOption::PLAY_LAST_JUDGE_FASTSLOW_2P, fs_of_target);
-                State::set(IndexNumber::LR2IR_REPLACE_PLAY_2P_JUDGE_TIME_ERROR_MS, _lastNoteJudge[PLAYER_SLOT_TARGET].time.norm());
-                State::set(IndexNumber::PLAY_2P_JUDGE_TIME_ERROR_MS, _lastNoteJudge[PLAYER_SLOT_TARGET].time.norm());
+                batch.set(IndexNumber::LR2IR_REPLACE_PLAY_2P_FAST_SLOW, fs_of_target);
+                batch.set(IndexOption::PLAY_LAST_JUDGE_FASTSLOW_2P, fs_of_target);
+                batch.set(IndexNumber::LR2IR_REPLACE_PLAY_2P_JUDGE_TIME_ERROR_MS, _lastNoteJudge[PLAYER_SLOT_TARGET].time.norm());
+                batch.set(IndexNumber::PLAY_2P_JUDGE_TIME_ERROR_MS, _lastNoteJudge[PLAYER_SLOT_TARGET].time.norm());
             }
         }
 
-        State::set(IndexBargraph::RESULT_PG, (double)_basic.judge[JUDGE_PERFECT] / getNoteCount());
-        State::set(IndexBargraph::RESULT_GR, (double)_basic.judge[JUDGE_GREAT] / getNoteCount());
-        State::set(IndexBargraph::RESULT_GD, (double)_basic.judge[JUDGE_GOOD] / getNoteCount());
-        State::set(IndexBargraph::RESULT_BD, (double)_basic.judge[JUDGE_BAD] / getNoteCount());
-        State::set(IndexBargraph::RESULT_PR, (double)_basic.judge[JUDGE_POOR] / getNoteCount());
-        State::set(IndexBargraph::RESULT_MAXCOMBO, (double)_basic.maxCombo / getMaxCombo());
-        State::set(IndexBargraph::RESULT_SCORE, moneyScore / maxMoneyScore);
-        State::set(IndexBargraph::RESULT_EXSCORE, (double)exScore / getMaxScore());
-        State::set(IndexBargraph::PLAY_1P_FAST_COUNT, (double)_basic.judge[JUDGE_EARLY] / getNoteCount());
-        State::set(IndexBargraph::PLAY_1P_SLOW_COUNT, (double)_basic.judge[JUDGE_LATE] / getNoteCount());
-
-        State::set(IndexOption::PLAY_RANK_ESTIMATED_1P, Option::getRankType(_basic.acc));
-        State::set(IndexOption::PLAY_RANK_BORDER_1P, Option::getRankType(_basic.total_acc));
-        State::set(IndexOption::RESULT_RANK_1P, Option::getRankType(_basic.total_acc));
-        State::set(IndexOption::PLAY_HEALTH_1P, Option::getHealthType(_basic.health));
+        batch.set(IndexBargraph::RESULT_PG, (double)_basic.judge[JUDGE_PERFECT] / getNoteCount());
+        batch.set(IndexBargraph::RESULT_GR, (double)_basic.judge[JUDGE_GREAT] / getNoteCount());
+        batch.set(IndexBargraph::RESULT_GD, (double)_basic.judge[JUDGE_GOOD] / getNoteCount());
+        batch.set(IndexBargraph::RESULT_BD, (double)_basic.judge[JUDGE_BAD] / getNoteCount());
+        batch.set(IndexBargraph::RESULT_PR, (double)_basic.judge[JUDGE_POOR] / getNoteCount());
+        batch.set(IndexBargraph::RESULT_MAXCOMBO, (double)_basic.maxCombo / getMaxCombo());
+        batch.set(IndexBargraph::RESULT_SCORE, moneyScore / maxMoneyScore);
+        batch.set(IndexBargraph::RESULT_EXSCORE, (double)exScore / getMaxScore());
+        batch.set(IndexBargraph::PLAY_1P_FAST_COUNT, (double)_basic.judge[JUDGE_EARLY] / getNoteCount());
+        batch.set(IndexBargraph::PLAY_1P_SLOW_COUNT, (double)_basic.judge[JUDGE_LATE] / getNoteCount());
+
+        batch.set(IndexOption::PLAY_RANK_ESTIMATED_1P, Option::getRankType(_basic.acc));
+        batch.set(IndexOption::PLAY_RANK_BORDER_1P, Option::getRankType(_basic.total_acc));
+        batch.set(IndexOption::RESULT_RANK_1P, Option::getRankType(_basic.total_acc));
+        batch.set(IndexOption::PLAY_HEALTH_1P, Option::getHealthType(_basic.health));
 
         int maxScore = getMaxScore();
         //if      (dp.total_acc >= 94.44) State::set(IndexNumber::RESULT_NEXT_RANK_EX_DIFF, int(maxScore * 1.000 - dp.score2));    // MAX-
-        if      (_basic.total_acc >= 100.0 * 8.0 / 9) State::set(IndexNumber::PLAY_1P_NEXT_RANK_EX_DIFF,     exScore - maxScore);    // MAX-
-        else if (_basic.total_acc >= 100.0 * 7.0 / 9) State::set(IndexNumber::PLAY_1P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 8.0 / 9));    // AAA-
-        else if (_basic.total_acc >= 100.0 * 6.0 / 9) State::set(IndexNumber::PLAY_1P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 7.0 / 9));    // AA-
-        else if (_basic.total_acc >= 100.0 * 5.0 / 9) State::set(IndexNumber::PLAY_1P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 6.0 / 9));    // A-
-        else if (_basic.total_acc >= 100.0 * 4.0 / 9) State::set(IndexNumber::PLAY_1P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 5.0 / 9));    // B-
-        else if (_basic.total_acc >= 100.0 * 3.0 / 9) State::set(IndexNumber::PLAY_1P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 4.0 / 9));    // C-
-        else if (_basic.total_acc >= 100.0 * 2.0 / 9) State::set(IndexNumber::PLAY_1P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 3.0 / 9));    // D-
-        else                                          State::set(IndexNumber::PLAY_1P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 2.0 / 9));    // E-
-        State::set(IndexNumber::RESULT_NEXT_RANK_EX_DIFF, State::get(IndexNumber::PLAY_1P_NEXT_RANK_EX_DIFF));
-
-        State::set(IndexNumber::LR2IR_REPLACE_PLAY_RUNNING_NOTES, notesExpired);
-        State::set(IndexNumber::LR2IR_REPLACE_PLAY_REMAIN_NOTES, getNoteCount() - notesExpired);
+        int nextRankExDiff;
+        if      (_basic.total_acc >= 100.0 * 8.0 / 9) nextRankExDiff =     exScore - maxScore;    // MAX-
+        else if (_basic.total_acc >= 100.0 * 7.0 / 9) nextRankExDiff = int(exScore - maxScore * 8.0 / 9);    // AAA-
+        else if (_basic.total_acc >= 100.0 * 6.0 / 9) nextRankExDiff = int(exScore - maxScore * 7.0 / 9);    // AA-
+        else if (_basic.total_acc >= 100.0 * 5.0 / 9) nextRankExDiff = int(exScore - maxScore * 6.0 / 9);    // A-
+        else if (_basic.total_acc >= 100.0 * 4.0 / 9) nextRankExDiff = int(exScore - maxScore * 5.0 / 9);    // B-
+        else if (_basic.total_acc >= 100.0 * 3.0 / 9) nextRankExDiff = int(exScore - maxScore * 4.0 / 9);    // C-
+        else if (_basic.total_acc >= 100.0 * 2.0 / 9) nextRankExDiff = int(exScore - maxScore * 3.0 / 9);    // D-
+        else                                          nextRankExDiff = int(exScore - maxScore * 2.0 / 9);    // E-
+        batch.set(IndexNumber::PLAY_1P_NEXT_RANK_EX_DIFF, nextRankExDiff);
+        batch.set(IndexNumber::RESULT_NEXT_RANK_EX_DIFF, nextRankExDiff);
+
+        batch.set(IndexNumber::LR2IR_REPLACE_PLAY_RUNNING_NOTES, notesExpired);
+        batch.set(IndexNumber::LR2IR_REPLACE_PLAY_REMAIN_NOTES, getNoteCount() - notesExpired);
 
         Option::e_lamp_type lamp = Option::LAMP_NOPLAY;
         if (isNoScore() && _basic.judge[JUDGE_BP] == 0)
@@ -1786,45 +1794,45 @@ void RulesetBMS::updateGlobals()
         {
             lamp = Option::LAMP_FAILED;
         }
-        State::set(IndexOption::RESULT_CLEAR_TYPE_1P, std::min(lamp, saveLampMax));
+        batch.set(IndexOption::RESULT_CLEAR_TYPE_1P, std::min(lamp, saveLampMax));
     }
     else if (_side == PlaySide::BATTLE_2P || _side == PlaySide::AUTO_2P || _side == PlaySide::RIVAL) // excludes DP
     {
         if (!gArenaData.isOnline())
         {
-            State::set(IndexBargraph::PLAY_RIVAL_EXSCORE, _basic.total_acc / 100.0);
+            batch.set(IndexBargraph::PLAY_RIVAL_EXSCORE, _basic.total_acc / 100.0);
         }
-        State::set(IndexBargraph::PLAY_RIVAL_EXSCORE_BACKUP, _basic.total_acc / 100.0);
+        batch.set(IndexBargraph::PLAY_RIVAL_EXSCORE_BACKUP, _basic.total_acc / 100.0);
         
-        State::set(IndexNumber::PLAY_2P_SCORE, int(std::round(moneyScore)));
+        batch.set(IndexNumber::PLAY_2P_SCORE, int(std::round(moneyScore)));
         if (_side == PlaySide::RIVAL)
         {
             // target exscore is affected by target type. Handle in ScenePlay
         }
         else
         {
-            State::set(IndexNumber::PLAY_2P_EXSCORE, exScore);
+            batch.set(IndexNumber::PLAY_2P_EXSCORE, exScore);
         }
-        State::set(IndexNumber::PLAY_2P_NOWCOMBO, _basic.combo + _basic.comboDisplay);
-        State::set(IndexNumber::PLAY_2P_MAXCOMBO, _basic.maxComboDisplay);
-        State::set(IndexNumber::PLAY_2P_RATE, int(std::floor(_basic.acc)));
-        State::set(IndexNumber::PLAY_2P_RATEDECIMAL, int(std::floor((_basic.acc - int(_basic.acc)) * 100)));
-        State::set(IndexNumber::PLAY_2P_TOTALNOTES, getNoteCount());
-        State::set(IndexNumber::PLAY_2P_TOTAL_RATE, int(std::floor(_basic.total_acc)));
-        State::set(IndexNumber::PLAY_2P_TOTAL_RATE_DECIMAL2, int(std::floor((_basic.total_acc - int(_basic.total_acc)) * 100)));
-        State::set(IndexNumber::PLAY_2P_PERFECT, _basic.judge[JUDGE_PERFECT]);
-        State::set(IndexNumber::PLAY_2P_GREAT, _basic.judge[JUDGE_GREAT]);
-        State::set(IndexNumber::PLAY_2P_GOOD, _basic.judge[JUDGE_GOOD]);
-        State::set(IndexNumber::PLAY_2P_BAD, _basic.judge[JUDGE_BAD]);
-        State::set(IndexNumber::PLAY_2P_POOR, _basic.judge[JUDGE_POOR]);
-        State::set(IndexNumber::PLAY_2P_GROOVEGAUGE, int(_basic.health * 100));
-
-        State::set(IndexNumber::PLAY_2P_MISS, _basic.judge[JUDGE_MISS]);
-        State::set(IndexNumber::PLAY_2P_FAST_COUNT, _basic.judge[JUDGE_EARLY]);
-        State::set(IndexNumber::PLAY_2P_SLOW_COUNT, _basic.judge[JUDGE_LATE]);
-        State::set(IndexNumber::PLAY_2P_COMBOBREAK, _basic.judge[JUDGE_CB]);
-        State::set(IndexNumber::PLAY_2P_BPOOR, _basic.judge[JUDGE_KPOOR]);
-        State::set(IndexNumber::PLAY_2P_BP, _basic.judge[JUDGE_BP]);
+        batch.set(IndexNumber::PLAY_2P_NOWCOMBO, _basic.combo + _basic.comboDisplay);
+        batch.set(IndexNumber::PLAY_2P_MAXCOMBO, _basic.maxComboDisplay);
+        batch.set(IndexNumber::PLAY_2P_RATE, int(std::floor(_basic.acc)));
+        batch.set(IndexNumber::PLAY_2P_RATEDECIMAL, int(std::floor((_basic.acc - int(_basic.acc)) * 100)));
+        batch.set(IndexNumber::PLAY_2P_TOTALNOTES, getNoteCount());
+        batch.set(IndexNumber::PLAY_2P_TOTAL_RATE, int(std::floor(_basic.total_acc)));
+        batch.set(IndexNumber::PLAY_2P_TOTAL_RATE_DECIMAL2, int(std::floor((_basic.total_acc - int(_basic.total_acc)) * 100)));
+        batch.set(IndexNumber::PLAY_2P_PERFECT, _basic.judge[JUDGE_PERFECT]);
+        batch.set(IndexNumber::PLAY_2P_GREAT, _basic.judge[JUDGE_GREAT]);
+        batch.set(IndexNumber::PLAY_2P_GOOD, _basic.judge[JUDGE_GOOD]);
+        batch.set(IndexNumber::PLAY_2P_BAD, _basic.judge[JUDGE_BAD]);
+        batch.set(IndexNumber::PLAY_2P_POOR, _basic.judge[JUDGE_POOR]);
+        batch.set(IndexNumber::PLAY_2P_GROOVEGAUGE, int(_basic.health * 100));
+
+        batch.set(IndexNumber::PLAY_2P_MISS, _basic.judge[JUDGE_MISS]);
+        batch.set(IndexNumber::PLAY_2P_FAST_COUNT, _basic.judge[JUDGE_EARLY]);
+        batch.set(IndexNumber::PLAY_2P_SLOW_COUNT, _basic.judge[JUDGE_LATE]);
+        batch.set(IndexNumber::PLAY_2P_COMBOBREAK, _basic.judge[JUDGE_CB]);
+        batch.set(IndexNumber::PLAY_2P_BPOOR, _basic.judge[JUDGE_KPOOR]);
+        batch.set(IndexNumber::PLAY_2P_BP, _basic.judge[JUDGE_BP]);
 
         if (showJudge)
         {
@@ -1852,38 +1860,38 @@ void RulesetBMS::updateGlobals()
             case JudgeArea::MINE_KPOOR:
                 break;
             }
-            State::set(IndexNumber::LR2IR_REPLACE_PLAY_2P_FAST_SLOW, fastslow);
-            State::set(IndexOption::PLAY_LAST_JUDGE_FASTSLOW_2P, fastslow);
-            State::set(IndexNumber::LR2IR_REPLACE_PLAY_2P_JUDGE_TIME_ERROR_MS, _lastNoteJudge[PLAYER_SLOT_TARGET].time.norm());
-            State::set(IndexNumber::PLAY_2P_JUDGE_TIME_ERROR_MS, _lastNoteJudge[PLAYER_SLOT_TARGET].time.norm());
+            batch.set(IndexNumber::LR2IR_REPLACE_PLAY_2P_FAST_SLOW, fastslow);
+            batch.set(IndexOption::PLAY_LAST_JUDGE_FASTSLOW_2P, fastslow);
+            batch.set(IndexNumber::LR2IR_REPLACE_PLAY_2P_JUDGE_TIME_ERROR_MS, _lastNoteJudge[PLAYER_SLOT_TARGET].time.norm());
+            batch.set(IndexNumber::PLAY_2P_JUDGE_TIME_ERROR_MS, _lastNoteJudge[PLAYER_SLOT_TARGET].time.norm());
         }
 
-        State::set(IndexBargraph::RESULT_RIVAL_PG, (double)_basic.judge[JUDGE_PERFECT] / getNoteCount());
-        State::set(IndexBargraph::RESULT_RIVAL_GR, (double)_basic.judge[JUDGE_GREAT] / getNoteCount());
-        State::set(IndexBargraph::RESULT_RIVAL_GD, (double)_basic.judge[JUDGE_GOOD] / getNoteCount());
-        State::set(IndexBargraph::RESULT_RIVAL_BD, (double)_basic.judge[JUDGE_BAD] / getNoteCount());
-        State::set(IndexBargraph::RESULT_RIVAL_PR, (double)_basic.judge[JUDGE_POOR] / getNoteCount());
-        State::set(IndexBargraph::RESULT_RIVAL_MAXCOMBO, (double)_basic.maxCombo / getMaxCombo());
-        State::set(IndexBargraph::RESULT_RIVAL_SCORE, moneyScore / maxMoneyScore);
-        State::set(IndexBargraph::RESULT_RIVAL_EXSCORE, (double)exScore / getMaxScore());
-        State::set(IndexBargraph::PLAY_2P_FAST_COUNT, (double)_basic.judge[JUDGE_EARLY] / getNoteCount());
-        State::set(IndexBargraph::PLAY_2P_SLOW_COUNT, (double)_basic.judge[JUDGE_LATE] / getNoteCount());
-
-        State::set(IndexOption::PLAY_RANK_ESTIMATED_2P, Option::getRankType(_basic.acc));
-        State::set(IndexOption::PLAY_RANK_BORDER_2P, Option::getRankType(_basic.total_acc));
-        State::set(IndexOption::RESULT_RANK_2P, Option::getRankType(_basic.total_acc));
-        State::set(IndexOption::PLAY_HEALTH_2P, Option::getHealthType(_basic.health));
+        batch.set(IndexBargraph::RESULT_RIVAL_PG, (double)_basic.judge[JUDGE_PERFECT] / getNoteCount());
+        batch.set(IndexBargraph::RESULT_RIVAL_GR, (double)_basic.judge[JUDGE_GREAT] / getNoteCount());
+        batch.set(IndexBargraph::RESULT_RIVAL_GD, (double)_basic.judge[JUDGE_GOOD] / getNoteCount());
+        batch.set(IndexBargraph::RESULT_RIVAL_BD, (double)_basic.judge[JUDGE_BAD] / getNoteCount());
+        batch.set(IndexBargraph::RESULT_RIVAL_PR, (double)_basic.judge[JUDGE_POOR] / getNoteCount());
+        batch.set(IndexBargraph::RESULT_RIVAL_MAXCOMBO, (double)_basic.maxCombo / getMaxCombo());
+        batch.set(IndexBargraph::RESULT_RIVAL_SCORE, moneyScore / maxMoneyScore);
+        batch.set(IndexBargraph::RESULT_RIVAL_EXSCORE, (double)exScore / getMaxScore());
+        batch.set(IndexBargraph::PLAY_2P_FAST_COUNT, (double)_basic.judge[JUDGE_EARLY] / getNoteCount());
+        batch.set(IndexBargraph::PLAY_2P_SLOW_COUNT, (double)_basic.judge[JUDGE_LATE] / getNoteCount());
+
+        batch.set(IndexOption::PLAY_RANK_ESTIMATED_2P, Option::getRankType(_basic.acc));
+        batch.set(IndexOption::PLAY_RANK_BORDER_2P, Option::getRankType(_basic.total_acc));
+        batch.set(IndexOption::RESULT_RANK_2P, Option::getRankType(_basic.total_acc));
+        batch.set(IndexOption::PLAY_HEALTH_2P, Option::getHealthType(_basic.health));
 
         int maxScore = getMaxScore();
         //if      (dp.total_acc >= 94.44) State::set(IndexNumber::RESULT_NEXT_RANK_EX_DIFF, int(maxScore * 1.000 - dp.score2));    // MAX-
-        if      (_basic.total_acc >= 100.0 * 8.0 / 9) State::set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF,     exScore - maxScore);    // MAX-
-        else if (_basic.total_acc >= 100.0 * 7.0 / 9) State::set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 8.0 / 9));    // AAA-
-        else if (_basic.total_acc >= 100.0 * 6.0 / 9) State::set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 7.0 / 9));    // AA-
-        else if (_basic.total_acc >= 100.0 * 5.0 / 9) State::set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 6.0 / 9));    // A-
-        else if (_basic.total_acc >= 100.0 * 4.0 / 9) State::set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 5.0 / 9));    // B-
-        else if (_basic.total_acc >= 100.0 * 3.0 / 9) State::set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 4.0 / 9));    // C-
-        else if (_basic.total_acc >= 100.0 * 2.0 / 9) State::set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 3.0 / 9));    // D-
-        else                                          State::set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 2.0 / 9));    // E-
+        if      (_basic.total_acc >= 100.0 * 8.0 / 9) batch.set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF,     exScore - maxScore);    // MAX-
+        else if (_basic.total_acc >= 100.0 * 7.0 / 9) batch.set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 8.0 / 9));    // AAA-
+        else if (_basic.total_acc >= 100.0 * 6.0 / 9) batch.set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 7.0 / 9));    // AA-
+        else if (_basic.total_acc >= 100.0 * 5.0 / 9) batch.set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 6.0 / 9));    // A-
+        else if (_basic.total_acc >= 100.0 * 4.0 / 9) batch.set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 5.0 / 9));    // B-
+        else if (_basic.total_acc >= 100.0 * 3.0 / 9) batch.set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 4.0 / 9));    // C-
+        else if (_basic.total_acc >= 100.0 * 2.0 / 9) batch.set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 3.0 / 9));    // D-
+        else                                          batch.set(IndexNumber::PLAY_2P_NEXT_RANK_EX_DIFF, int(exScore - maxScore * 2.0 / 9));    // E-
 
         Option::e_lamp_type lamp = Option::LAMP_NOPLAY;
         if (isNoScore() && _basic.judge[JUDGE_BP] == 0)
@@ -1921,10 +1929,10 @@ void RulesetBMS::updateGlobals()
         {
             lamp = Option::LAMP_FAILED;
         }
-        State::set(IndexOption::RESULT_CLEAR_TYPE_2P, std::min(lamp, saveLampMax));
+        batch.set(IndexOption::RESULT_CLEAR_TYPE_2P, std::min(lamp, saveLampMax));
     }
     else if (_side == PlaySide::MYBEST && !gArenaData.isOnline())
     {
-        State::set(IndexBargraph::PLAY_MYBEST_NOW, _basic.total_acc / 100.0);
+        batch.set(IndexBargraph::PLAY_MYBEST_NOW, _basic.total_acc / 100.0);
     }
 }
\ No newline at end of file
@@ -175,6 +175,8 @@ protected:
 
     bool doJudge = true;
     bool _judgeScratch = true;
+    // presses come from the pads; replay and autoplay feed recorded or generated times, which are not latency
+    bool _recordLatency = true;
 
     bool showJudge = true;
     const NoteLaneTimerMap* _bombTimerMap = nullptr;
@@ -217,11 +219,11 @@ public:
     void initGaugeParams(PlayModifierGaugeType gauge);
 
 protected:
-    JudgeRes _judge(const Note& note, const lunaticvibes::Time& time);
+    JudgeRes _judge(const chart::NoteArray::Ref& note, const lunaticvibes::Time& time);
 private:
-    void _judgePress(chart::NoteLaneCategory cat, chart::NoteLaneIndex idx, HitableNote& note, const JudgeRes& judge, const lunaticvibes::Time& t, int slot);
-    void _judgeHold(chart::NoteLaneCategory cat, chart::NoteLaneIndex idx, HitableNote& note, const JudgeRes& judge, const lunaticvibes::Time& t, int slot);
-    void _judgeRelease(chart::NoteLaneCategory cat, chart::NoteLaneIndex idx, HitableNote& note, const JudgeRes& judge, const lunaticvibes::Time& t, int slot);
+    void _judgePress(chart::NoteLaneCategory cat, chart::NoteLaneIndex idx, chart::NoteArray::Ref note, const JudgeRes& judge, const lunaticvibes::Time& t, int slot);
+    void _judgeHold(chart::NoteLaneCategory cat, chart::NoteLaneIndex idx, chart::NoteArray::Ref note, const JudgeRes& judge, const lunaticvibes::Time& t, int slot);
+    void _judgeRelease(chart::NoteLaneCategory cat, chart::NoteLaneIndex idx, chart::NoteArray::Ref note, const JudgeRes& judge, const lunaticvibes::Time& t, int slot);
     void judgeNotePress(Input::Pad k, const lunaticvibes::Time& t, const lunaticvibes::Time& rt, int slot);
     void judgeNoteHold(Input::Pad k, const lunaticvibes::Time& t, const lunaticvibes::Time& rt, int slot);
     void judgeNoteRelease(Input::Pad k, const lunaticvibes::Time& t, const lunaticvibes::Time& rt, int slot);
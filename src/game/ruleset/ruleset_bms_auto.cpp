@@ -19,6 +19,7 @@ RulesetBMSAuto::RulesetBMSAuto(
 
     showJudge = (_side == PlaySide::AUTO || _side == PlaySide::AUTO_DOUBLE || _side == PlaySide::AUTO_2P);
 
+    _recordLatency = false;
     isPressingLN.fill(false);
 
     switch (side)
@@ -23,6 +23,7 @@ RulesetBMSReplay::RulesetBMSReplay(
     showJudge = (_side == PlaySide::AUTO || _side == PlaySide::AUTO_DOUBLE || _side == PlaySide::AUTO_2P);
 
     doJudge = false;
+    _recordLatency = false;
 
     if (gPlayContext.mode == SkinType::PLAY5 || gPlayContext.mode == SkinType::PLAY5_2)
     {
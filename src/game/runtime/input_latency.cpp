@@ -0,0 +1,127 @@
+#include "input_latency.h"
+
+#include <fstream>
+
+#include "common/log.h"
+
+std::array<InputLatency::Histogram, InputLatency::STAGE_COUNT> InputLatency::_histograms;
+std::atomic<long long> InputLatency::_pendingPressNs{ 0 };
+
+const char* InputLatency::stageName(Stage s)
+{
+    switch (s)
+    {
+    case Stage::POLL_INTERVAL: return "Poll interval";
+    case Stage::INPUT: return "Input";
+    case Stage::JUDGE: return "Judge";
+    case Stage::KEYSOUND: return "Keysound";
+    case Stage::PRESENT: return "Present";
+    default: return "";
+    }
+}
+
+void InputLatency::record(Stage s, long long ns)
+{
+    if (ns < 0) ns = 0;
+    auto& h = _histograms[static_cast<size_t>(s)];
+
+    size_t bucket = static_cast<size_t>(ns / BUCKET_NS);
+    if (bucket >= BUCKET_COUNT) bucket = BUCKET_COUNT - 1;
+    h.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    h.sumNs.fetch_add(ns, std::memory_order_relaxed);
+
+    long long max = h.maxNs.load(std::memory_order_relaxed);
+    while (ns > max && !h.maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed));
+}
+
+void InputLatency::recordSince(Stage s, const lunaticvibes::Time& pressTime)
+{
+    record(s, (lunaticvibes::Time() - pressTime).hres());
+}
+
+void InputLatency::pressHandled(const lunaticvibes::Time& pressTime)
+{
+    long long ns = pressTime.hres();
+    long long pending = _pendingPressNs.load(std::memory_order_relaxed);
+    while ((pending == 0 || ns < pending) && !_pendingPressNs.compare_exchange_weak(pending, ns, std::memory_order_relaxed));
+}
+
+void InputLatency::framePresented()
+{
+    long long pending = _pendingPressNs.exchange(0, std::memory_order_relaxed);
+    if (pending != 0)
+        recordSince(Stage::PRESENT, lunaticvibes::Time(pending, true));
+}
+
+InputLatency::Summary InputLatency::summary(Stage s)
+{
+    const auto& h = _histograms[static_cast<size_t>(s)];
+
+    // buckets are read one by one, so totals may be off by the presses recorded meanwhile
+    std::array<uint32_t, BUCKET_COUNT> buckets;
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        buckets[i] = h.buckets[i].load(std::memory_order_relaxed);
+        total += buckets[i];
+    }
+
+    Summary ret;
+    ret.count = h.count.load(std::memory_order_relaxed);
+    if (ret.count == 0 || total == 0)
+        return ret;
+    ret.avgNs = h.sumNs.load(std::memory_order_relaxed) / static_cast<long long>(ret.count);
+    ret.maxNs = h.maxNs.load(std::memory_order_relaxed);
+
+    uint64_t p50 = (total + 1) / 2;
+    uint64_t p99 = total - total / 100;
+    uint64_t acc = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        uint64_t prev = acc;
+        acc += buckets[i];
+        long long edge = (i + 1 == BUCKET_COUNT) ? ret.maxNs : static_cast<long long>(i + 1) * BUCKET_NS;
+        if (prev < p50 && acc >= p50) ret.p50Ns = edge;
+        if (prev < p99 && acc >= p99) ret.p99Ns = edge;
+    }
+    return ret;
+}
+
+void InputLatency::reset()
+{
+    for (auto& h : _histograms)
+    {
+        for (auto& b : h.buckets)
+            b.store(0, std::memory_order_relaxed);
+        h.count.store(0, std::memory_order_relaxed);
+        h.sumNs.store(0, std::memory_order_relaxed);
+        h.maxNs.store(0, std::memory_order_relaxed);
+    }
+    _pendingPressNs.store(0, std::memory_order_relaxed);
+}
+
+bool InputLatency::dumpCSV(const Path& path)
+{
+    std::ofstream ofs(path, std::ios::trunc);
+    if (!ofs)
+    {
+        LOG_WARNING << "[Latency] Cannot open " << path.u8string();
+        return false;
+    }
+
+    ofs << "stage,from_us,to_us,count\n";
+    for (size_t s = 0; s < STAGE_COUNT; ++s)
+    {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i)
+        {
+            uint32_t n = _histograms[s].buckets[i].load(std::memory_order_relaxed);
+            if (n == 0) continue;
+            ofs << stageName(Stage(s)) << ',' << i * BUCKET_NS / 1000 << ',';
+            if (i + 1 < BUCKET_COUNT) ofs << (i + 1) * BUCKET_NS / 1000;
+            ofs << ',' << n << '\n';
+        }
+    }
+    LOG_INFO << "[Latency] Saved to " << path.u8string();
+    return bool(ofs);
+}
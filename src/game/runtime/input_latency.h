@@ -0,0 +1,64 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include "common/beat.h"
+#include "common/types.h"
+
+// Latency of pad presses through the game, measured from the time stamped on the press: the kernel event time
+// with evdev, otherwise the poll that saw it. Each stage keeps a histogram every thread can record into without
+// locking. Shown in the FPS overlay; dumpCSV() writes the histograms for offline comparison.
+class InputLatency
+{
+public:
+    enum class Stage
+    {
+        POLL_INTERVAL,  // time between two input polls, not a press latency
+        INPUT,          // device -> InputWrapper (evdev only)
+        JUDGE,          // -> RulesetBMS::judgeNotePress
+        KEYSOUND,       // -> keysound handed to the sound driver
+        PRESENT,        // -> first frame presented after the press was handled
+
+        COUNT
+    };
+    static constexpr size_t STAGE_COUNT = static_cast<size_t>(Stage::COUNT);
+
+    // 0.1ms buckets up to 50ms; the last bucket also holds everything above
+    static constexpr long long BUCKET_NS = 100'000;
+    static constexpr size_t BUCKET_COUNT = 500;
+
+    struct Summary
+    {
+        uint64_t count = 0;
+        long long avgNs = 0;
+        long long p50Ns = 0;    // upper edge of the bucket
+        long long p99Ns = 0;
+        long long maxNs = 0;
+    };
+
+    static const char* stageName(Stage s);
+
+    static void record(Stage s, long long ns);
+    static void recordSince(Stage s, const lunaticvibes::Time& pressTime);
+
+    // Keeps the earliest press until framePresented() records it as PRESENT.
+    static void pressHandled(const lunaticvibes::Time& pressTime);
+    static void framePresented();
+
+    static Summary summary(Stage s);
+    static void reset();
+
+    // Columns: stage, bucket start us, bucket end us (empty for the last bucket), count. Empty buckets are skipped.
+    static bool dumpCSV(const Path& path);
+
+private:
+    struct Histogram
+    {
+        std::array<std::atomic<uint32_t>, BUCKET_COUNT> buckets{};
+        std::atomic<uint64_t> count{ 0 };
+        std::atomic<long long> sumNs{ 0 };
+        std::atomic<long long> maxNs{ 0 };
+    };
+    static std::array<Histogram, STAGE_COUNT> _histograms;
+    static std::atomic<long long> _pendingPressNs;
+};
@@ -2,7 +2,13 @@
 
 #include "common/types.h"
 
+#include <iterator>
+#include <memory>
+#include <thread>
+
 State State::_inst;
+thread_local State::Snapshot* State::_snapshot = nullptr;
+thread_local State::Batch* State::Batch::_active = nullptr;
 
 State::State()
 {
@@ -22,54 +28,64 @@ State::State()
 
 bool State::set(IndexBargraph ind, Ratio val)
 {
+	if (_snapshot) _snapshot->bargraphs.set(ind, val);
 	return _inst.gBargraphs.set(ind, val);
 }
 
 double State::get(IndexBargraph ind)
 {
+	if (_snapshot) return _snapshot->bargraphs.get(ind);
 	return _inst.gBargraphs.get(ind);
 }
 
 bool State::set(IndexNumber ind, int val)
 {
+	if (_snapshot) _snapshot->numbers.set(ind, val);
 	return _inst.gNumbers.set(ind, val);
 }
 
 int State::get(IndexNumber ind)
 {
+	if (_snapshot) return _snapshot->numbers.get(ind);
 	return _inst.gNumbers.get(ind);
 }
 
 
 bool State::set(IndexOption ind, unsigned val)
 {
+	if (_snapshot) _snapshot->options.set(ind, val);
 	return _inst.gOptions.set(ind, val);
 }
 
 unsigned State::get(IndexOption ind)
 {
+	if (_snapshot) return _snapshot->options.get(ind);
 	return _inst.gOptions.get(ind);
 }
 
 
 bool State::set(IndexSlider ind, Ratio val)
 {
+	if (_snapshot) _snapshot->sliders.set(ind, val);
 	return _inst.gSliders.set(ind, val);
 }
 
 double State::get(IndexSlider ind)
 {
+	if (_snapshot) return _snapshot->sliders.get(ind);
 	return _inst.gSliders.get(ind);
 }
 
 
 bool State::set(IndexSwitch ind, bool val)
 {
+	if (_snapshot) _snapshot->switches.set(ind, val);
 	return _inst.gSwitches.set(ind, val);
 }
 
 bool State::get(IndexSwitch ind)
 {
+	if (_snapshot) return _snapshot->switches.get(ind);
 	return _inst.gSwitches.get(ind);
 }
 
@@ -87,11 +103,13 @@ std::string State::get(IndexText ind)
 
 bool State::set(IndexTimer ind, long long val)
 {
+	if (_snapshot) _snapshot->timers.set(ind, val);
 	return _inst.gTimers.set(ind, val);
 }
 
 long long State::get(IndexTimer ind)
 {
+	if (_snapshot) return _snapshot->timers.get(ind);
 	return _inst.gTimers.get(ind);
 }
 
@@ -99,5 +117,102 @@ void State::resetTimer()
 {
 	long long customizeTimer = get(IndexTimer::_SCENE_CUSTOMIZE_START);
 	_inst.gTimers.reset();
+	if (_snapshot) _snapshot->timers.load(_inst.gTimers);
 	set(IndexTimer::_SCENE_CUSTOMIZE_START, customizeTimer);
 }
+
+void State::loadSnapshot(Snapshot& s) const
+{
+	for (;;)
+	{
+		unsigned seq = _commitSeq.load(std::memory_order_acquire);
+		if (seq & 1)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		s.bargraphs.load(gBargraphs);
+		s.numbers.load(gNumbers);
+		s.options.load(gOptions);
+		s.sliders.load(gSliders);
+		s.switches.load(gSwitches);
+		s.timers.load(gTimers);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (_commitSeq.load(std::memory_order_relaxed) == seq)
+			break;
+	}
+}
+
+
+State::Batch::Batch() : _outer(_active)
+{
+	_active = this;
+}
+
+State::Batch::~Batch()
+{
+	commit();
+	_active = _outer;
+}
+
+template <class T>
+static void appendTo(std::vector<T>& to, std::vector<T>& from)
+{
+	to.insert(to.end(), std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+	from.clear();
+}
+
+void State::Batch::commit()
+{
+	if (_outer)
+	{
+		appendTo(_outer->_bargraphs, _bargraphs);
+		appendTo(_outer->_numbers, _numbers);
+		appendTo(_outer->_options, _options);
+		appendTo(_outer->_sliders, _sliders);
+		appendTo(_outer->_switches, _switches);
+		appendTo(_outer->_texts, _texts);
+		appendTo(_outer->_timers, _timers);
+		return;
+	}
+
+	std::unique_lock l{ _inst._commitMutex };
+	unsigned seq = _inst._commitSeq.load(std::memory_order_relaxed);
+	_inst._commitSeq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	for (auto& [ind, val] : _bargraphs) State::set(ind, val);
+	for (auto& [ind, val] : _numbers) State::set(ind, val);
+	for (auto& [ind, val] : _options) State::set(ind, val);
+	for (auto& [ind, val] : _sliders) State::set(ind, val);
+	for (auto& [ind, val] : _switches) State::set(ind, val);
+	for (auto& [ind, val] : _texts) State::set(ind, val);
+	for (auto& [ind, val] : _timers) State::set(ind, val);
+
+	_inst._commitSeq.store(seq + 2, std::memory_order_release);
+
+	_bargraphs.clear();
+	_numbers.clear();
+	_options.clear();
+	_sliders.clear();
+	_switches.clear();
+	_texts.clear();
+	_timers.clear();
+}
+
+
+State::SnapshotScope::SnapshotScope() : _prev(_snapshot)
+{
+	if (_prev) return;
+
+	thread_local std::unique_ptr<Snapshot> storage = std::make_unique<Snapshot>();
+	_inst.loadSnapshot(*storage);
+	_snapshot = storage.get();
+}
+
+State::SnapshotScope::~SnapshotScope()
+{
+	_snapshot = _prev;
+}
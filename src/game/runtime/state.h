@@ -10,10 +10,12 @@
 #include "index/timer.h"
 
 #include <array>
+#include <atomic>
 #include <mutex>
-#include <shared_mutex>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 // Global state value manager
 class State
@@ -22,6 +24,7 @@ private:
 	static State _inst;
 
 protected:
+	// Scalar values. Each value is an atomic, so readers and writers never wait for each other.
 	template <class Key, class Value, size_t _size>
 	class StateContainer
 	{
@@ -30,16 +33,19 @@ protected:
 		using ValType = Value;
 
 	public:
-		StateContainer() : _data{ Value() }, _dataDefault{ Value() } { static_assert(_size > 0); }
+		StateContainer() : _dataDefault{ Value() }
+		{
+			static_assert(_size > 0);
+			reset();
+		}
 		StateContainer(Value defVal) : StateContainer()
 		{
-			_data.fill(defVal);
 			_dataDefault.fill(defVal);
+			reset();
 		}
 	private:
-		std::array<Value, _size> _data;
+		std::array<std::atomic<Value>, _size> _data;
 		std::array<Value, _size> _dataDefault;
-		mutable std::shared_mutex _mutex;
 
 	public:
 		Value get(Key n) const
@@ -47,8 +53,7 @@ protected:
 			size_t idx = (size_t)n;
 			if (idx < _size)
 			{
-				std::shared_lock l{_mutex};
-				return _data.data()[idx];
+				return _data[idx].load(std::memory_order_relaxed);
 			}
 			return Value();
 		}
@@ -58,8 +63,7 @@ protected:
 			size_t idx = (size_t)n;
 			if (idx < _size)
 			{
-				std::unique_lock l{_mutex};
-				_data[idx] = value;
+				_data[idx].store(value, std::memory_order_relaxed);
 				return true;
 			}
 			return false;
@@ -78,7 +82,108 @@ protected:
 
 		void reset()
 		{
-			_data = _dataDefault;
+			for (size_t i = 0; i < _size; ++i)
+				_data[i].store(_dataDefault[i], std::memory_order_relaxed);
+		}
+	};
+
+	// Texts. Each text is published as an immutable string; set() swaps in a new one, get() copies the current one.
+	// Replaced strings are freed later, once no reader that could have seen them is left. Readers only touch
+	// atomics; writers serialize among themselves.
+	template <class Key, size_t _size>
+	class TextContainer
+	{
+	public:
+		using KeyType = Key;
+		using ValType = std::string;
+
+	public:
+		TextContainer()
+		{
+			static_assert(_size > 0);
+			for (auto& p : _data)
+				p.store(new std::string());
+		}
+		~TextContainer()
+		{
+			for (auto& p : _data)
+				delete p.load();
+			for (auto& r : _retired)
+				for (auto p : r)
+					delete p;
+		}
+	private:
+		std::array<std::atomic<const std::string*>, _size> _data;
+		std::array<std::string, _size> _dataDefault;
+
+		// Readers register in the parity of the epoch they started in. Strings replaced in an epoch are freed
+		// when the epoch after next begins, which requires all readers from that epoch to have left.
+		std::atomic<unsigned> _epoch{ 0 };
+		mutable std::array<std::atomic<unsigned>, 2> _readers{};
+		std::mutex _writeMutex;
+		std::array<std::vector<const std::string*>, 2> _retired;
+
+		void publish(size_t idx, const std::string* p)
+		{
+			std::unique_lock l{ _writeMutex };
+			unsigned e = _epoch.load();
+			_retired[e & 1].push_back(_data[idx].exchange(p));
+			if (_readers[(e + 1) & 1].load() == 0)
+			{
+				for (auto old : _retired[(e + 1) & 1])
+					delete old;
+				_retired[(e + 1) & 1].clear();
+				_epoch.store(e + 1);
+			}
+		}
+
+	public:
+		std::string get(Key n) const
+		{
+			size_t idx = (size_t)n;
+			if (idx < _size)
+			{
+				unsigned e = _epoch.load();
+				_readers[e & 1].fetch_add(1);
+				while (_epoch.load() != e)
+				{
+					_readers[e & 1].fetch_sub(1);
+					e = _epoch.load();
+					_readers[e & 1].fetch_add(1);
+				}
+				std::string ret = *_data[idx].load();
+				_readers[e & 1].fetch_sub(1);
+				return ret;
+			}
+			return {};
+		}
+
+		bool set(Key n, std::string value)
+		{
+			size_t idx = (size_t)n;
+			if (idx < _size)
+			{
+				publish(idx, new std::string(std::move(value)));
+				return true;
+			}
+			return false;
+		}
+
+		bool setDefault(Key n, std::string value)
+		{
+			size_t idx = (size_t)n;
+			if (idx < _size)
+			{
+				_dataDefault[idx] = std::move(value);
+				return true;
+			}
+			return false;
+		}
+
+		void reset()
+		{
+			for (size_t i = 0; i < _size; ++i)
+				publish(i, new std::string(_dataDefault[i]));
 		}
 	};
 	StateContainer<IndexBargraph, Ratio, (size_t)IndexBargraph::BARGRAPH_COUNT> gBargraphs;
@@ -86,9 +191,40 @@ protected:
 	StateContainer<IndexOption, unsigned, (size_t)IndexOption::OPTION_COUNT> gOptions;
 	StateContainer<IndexSlider, Ratio, (size_t)IndexSlider::SLIDER_COUNT> gSliders;
 	StateContainer<IndexSwitch, bool, (size_t)IndexSwitch::SWITCH_COUNT> gSwitches;
-	StateContainer<IndexText, std::string, (size_t)IndexText::TEXT_COUNT> gTexts;
+	TextContainer<IndexText, (size_t)IndexText::TEXT_COUNT> gTexts;
 	StateContainer<IndexTimer, long long, (size_t)IndexTimer::TIMER_COUNT> gTimers{ TIMER_NEVER };
 
+	// Plain copy of one container, see SnapshotScope
+	template <class Key, class Value, size_t _size>
+	struct Values
+	{
+		std::array<Value, _size> data;
+
+		Value get(Key n) const { return (size_t)n < _size ? data[(size_t)n] : Value(); }
+		void set(Key n, Value value) { if ((size_t)n < _size) data[(size_t)n] = value; }
+		void load(const StateContainer<Key, Value, _size>& c)
+		{
+			for (size_t i = 0; i < _size; ++i)
+				data[i] = c.get(Key(i));
+		}
+	};
+	struct Snapshot
+	{
+		Values<IndexBargraph, Ratio, (size_t)IndexBargraph::BARGRAPH_COUNT> bargraphs;
+		Values<IndexNumber, int, (size_t)IndexNumber::NUMBER_COUNT> numbers;
+		Values<IndexOption, unsigned, (size_t)IndexOption::OPTION_COUNT> options;
+		Values<IndexSlider, Ratio, (size_t)IndexSlider::SLIDER_COUNT> sliders;
+		Values<IndexSwitch, bool, (size_t)IndexSwitch::SWITCH_COUNT> switches;
+		Values<IndexTimer, long long, (size_t)IndexTimer::TIMER_COUNT> timers;
+	};
+	static thread_local Snapshot* _snapshot;
+
+	// Batch commits are serialized, and bracketed by _commitSeq (odd while a commit is in progress)
+	std::mutex _commitMutex;
+	std::atomic<unsigned> _commitSeq{ 0 };
+
+	void loadSnapshot(Snapshot& s) const;
+
 private:
 	State();
 
@@ -114,4 +250,54 @@ public:
 	static bool set(IndexTimer ind, long long val);
 	static long long get(IndexTimer ind);
 	static void resetTimer();
+
+public:
+	// Collects changes and publishes them together on commit() or destruction, e.g. all score values of a tick.
+	// A batch created while another one is open on the same thread joins the outer one, which publishes once.
+	// Values set through a batch are not visible, even to this thread, until it is published.
+	class Batch
+	{
+	public:
+		Batch();
+		~Batch();
+		Batch(const Batch&) = delete;
+		Batch& operator=(const Batch&) = delete;
+
+		void set(IndexBargraph ind, Ratio val) { _bargraphs.emplace_back(ind, val); }
+		void set(IndexNumber ind, int val) { _numbers.emplace_back(ind, val); }
+		void set(IndexOption ind, unsigned val) { _options.emplace_back(ind, val); }
+		void set(IndexSlider ind, Ratio val) { _sliders.emplace_back(ind, val); }
+		void set(IndexSwitch ind, bool val) { _switches.emplace_back(ind, val); }
+		void set(IndexText ind, std::string_view val) { _texts.emplace_back(ind, std::string(val)); }
+		void set(IndexTimer ind, long long val) { _timers.emplace_back(ind, val); }
+
+		void commit();
+
+	private:
+		static thread_local Batch* _active;
+		Batch* _outer = nullptr;
+
+		std::vector<std::pair<IndexBargraph, Ratio>> _bargraphs;
+		std::vector<std::pair<IndexNumber, int>> _numbers;
+		std::vector<std::pair<IndexOption, unsigned>> _options;
+		std::vector<std::pair<IndexSlider, Ratio>> _sliders;
+		std::vector<std::pair<IndexSwitch, bool>> _switches;
+		std::vector<std::pair<IndexText, std::string>> _texts;
+		std::vector<std::pair<IndexTimer, long long>> _timers;
+	};
+
+	// While in scope, reads of scalar values on this thread come from a copy taken when the scope began, which
+	// contains either all or none of each batch. Writes on this thread update both the copy and the State.
+	// Texts are always read live. Nested scopes keep the outermost copy.
+	class SnapshotScope
+	{
+	public:
+		SnapshotScope();
+		~SnapshotScope();
+		SnapshotScope(const SnapshotScope&) = delete;
+		SnapshotScope& operator=(const SnapshotScope&) = delete;
+
+	private:
+		Snapshot* _prev;
+	};
 };
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "common/sysutil.h"
 #include "game/runtime/state.h"
 #include "game/runtime/generic_info.h"
+#include "game/runtime/input_latency.h"
 #include "game/skin/skin_mgr.h"
 #include "scene_context.h"
 #include "config/config_mgr.h"
@@ -19,6 +20,11 @@ SceneBase::SceneBase(SkinType skinType, unsigned rate, bool backgroundInput) :
     AsyncLooper("Scene Update", std::bind(&SceneBase::_updateAsync1, this), rate),
     _input(1000, backgroundInput)
 {
+    setThreadPolicy(AsyncLooper::ThreadPolicy::parse(
+        ConfigMgr::get('E', cfg::E_THREAD_UPDATE_CPUS, ""),
+        ConfigMgr::get('E', cfg::E_THREAD_UPDATE_SCHED, cfg::E_THREAD_SCHED_NORMAL),
+        ConfigMgr::get('E', cfg::E_THREAD_UPDATE_PRIORITY, 60)));
+
     unsigned inputPollingRate = ConfigMgr::get("P", cfg::P_INPUT_POLLING_RATE, 1000);
     if (inputPollingRate != 1000)
     {
@@ -123,11 +129,14 @@ SceneBase::~SceneBase()
 
 void SceneBase::update()
 {
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
     gUpdateContext.updateTime = t;
 
     if (pSkin)
     {
+        // read a consistent copy of the state values published by the update threads
+        State::SnapshotScope stateSnapshot;
+
         // update skin
         pSkin->update();
         auto [x, y] = _input.getCursorPos();
@@ -302,6 +311,39 @@ void SceneBase::updateImgui()
                     State::get(IndexNumber::FPS),
                     State::get(IndexNumber::INPUT_DETECT_FPS),
                     State::get(IndexNumber::SCENE_UPDATE_FPS));
+                for (const auto& [tag, stats] : AsyncLooper::getAllStats())
+                {
+                    ImGui::Text("%s: %u/s | late avg %lldus max %lldus | overrun %u",
+                        tag.c_str(), stats.ticks, stats.lateAvgNs / 1000, stats.lateMaxNs / 1000, stats.overruns);
+                }
+                for (size_t s = 0; s < InputLatency::STAGE_COUNT; ++s)
+                {
+                    auto stage = InputLatency::Stage(s);
+                    auto l = InputLatency::summary(stage);
+                    if (l.count == 0) continue;
+                    ImGui::Text("%s: avg %.2fms | p50 %.1fms p99 %.1fms max %.2fms | %llu",
+                        InputLatency::stageName(stage), l.avgNs / 1e6, l.p50Ns / 1e6, l.p99Ns / 1e6, l.maxNs / 1e6,
+                        (unsigned long long)l.count);
+                }
+                if (ImGui::Button("Save latency CSV"))
+                {
+                    Path p = "latency";
+                    p /= (boost::format("LV %04d-%02d-%02d %02d-%02d-%02d.csv")
+                        % State::get(IndexNumber::DATE_YEAR)
+                        % State::get(IndexNumber::DATE_MON)
+                        % State::get(IndexNumber::DATE_DAY)
+                        % State::get(IndexNumber::DATE_HOUR)
+                        % State::get(IndexNumber::DATE_MIN)
+                        % State::get(IndexNumber::DATE_SEC)).str();
+                    std::error_code ec;
+                    std::filesystem::create_directories(p.parent_path(), ec);
+                    InputLatency::dumpCSV(p);
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Reset latency"))
+                {
+                    InputLatency::reset();
+                }
                 ImGui::PopID();
             }
 
@@ -20,6 +20,7 @@ UpdateContextParams gUpdateContext;
 OverlayContextParams gOverlayContext;
 std::shared_ptr<SongDB> g_pSongDB;
 std::shared_ptr<ScoreDB> g_pScoreDB;
+std::shared_ptr<ChartFormatCache> g_pChartCache;
 
 std::pair<bool, Option::e_lamp_type> getSaveScoreType(bool byGauge)
 {
@@ -256,6 +257,7 @@ void loadSongList()
                 switch (f->getChart(idx)->type())
                 {
                 case eChartFormat::BMS:
+                case eChartFormat::BMSON:
                 {
                     auto p = std::reinterpret_pointer_cast<ChartFormatBMSMeta>(f->getChart(idx));
 
@@ -274,7 +276,7 @@ void loadSongList()
         case eEntryType::RIVAL_CHART:
         {
             auto f = std::reinterpret_pointer_cast<EntryChart>(e)->_file;
-            if (f->type() == eChartFormat::BMS)
+            if (f->type() == eChartFormat::BMS || f->type() == eChartFormat::BMSON)
             {
                 auto p = std::reinterpret_pointer_cast<ChartFormatBMSMeta>(f);
 
@@ -437,6 +439,7 @@ void updateEntryScore(size_t idx)
         switch (pf->type())
         {
         case eChartFormat::BMS:
+        case eChartFormat::BMSON:
         {
             auto pScore = g_pScoreDB->getChartScoreBMS(pf->fileHash);
             score = pScore;
@@ -606,6 +609,7 @@ void setBarInfo()
             switch (pf->type())
             {
             case eChartFormat::BMS:
+            case eChartFormat::BMSON:
             {
                 const auto bms = std::reinterpret_pointer_cast<const ChartFormatBMSMeta>(pf);
                 std::string name = entry->_name;
@@ -706,6 +710,7 @@ void setEntryInfo()
         switch (ps->_file->type())
         {
         case eChartFormat::BMS:
+        case eChartFormat::BMSON:
         {
             const auto bms = std::reinterpret_pointer_cast<const ChartFormatBMSMeta>(pf);
 
@@ -970,6 +975,7 @@ void setEntryInfo()
             switch (pf->type())
             {
             case eChartFormat::BMS:
+            case eChartFormat::BMSON:
             {
                 auto pScore = std::reinterpret_pointer_cast<ScoreBMS>(psc);
 
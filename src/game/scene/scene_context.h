@@ -7,6 +7,7 @@
 #include "scene.h"
 #include "common/types.h"
 #include "common/chartformat/chartformat.h"
+#include "common/chartformat/chartformat_cache.h"
 #include "game/chart/chart.h"
 #include "game/ruleset/ruleset.h"
 #include "game/graphics/texture_extra.h"
@@ -270,5 +271,6 @@ extern UpdateContextParams gUpdateContext;
 extern OverlayContextParams gOverlayContext;
 extern std::shared_ptr<SongDB> g_pSongDB;
 extern std::shared_ptr<ScoreDB> g_pScoreDB;
+extern std::shared_ptr<ChartFormatCache> g_pChartCache;
 
 ////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
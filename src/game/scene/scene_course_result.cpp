@@ -314,7 +314,7 @@ void SceneCourseResult::_updateAsync()
 
 void SceneCourseResult::updateDraw()
 {
-    auto t = lunaticvibes::Time();
+    auto t = lunaticvibes::Time::frame();
     auto rt = t - State::get(IndexTimer::SCENE_START);
 
     if (rt.norm() >= pSkin->info.timeResultRank)
@@ -341,7 +341,7 @@ void SceneCourseResult::updateRecord()
 
 void SceneCourseResult::updateFadeout()
 {
-    auto t = lunaticvibes::Time();
+    auto t = lunaticvibes::Time::frame();
     auto ft = t - State::get(IndexTimer::FADEOUT_BEGIN);
 
     if (ft >= pSkin->info.timeOutro)
@@ -108,7 +108,7 @@ void SceneCustomize::_updateAsync()
 
 void SceneCustomize::updateStart()
 {
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
     lunaticvibes::Time rt = t - State::get(IndexTimer::_SCENE_CUSTOMIZE_START);
     if (rt.norm() > pSkin->info.timeIntro)
     {
@@ -149,7 +149,7 @@ static void reload_preview(SkinType selectedMode)
 
 void SceneCustomize::updateMain()
 {
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
 
     // Mode has changed
     if (gCustomizeContext.mode != selectedMode)
@@ -355,7 +355,7 @@ void SceneCustomize::updateMain()
 
 void SceneCustomize::updateFadeout()
 {
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
     lunaticvibes::Time rt = t - State::get(IndexTimer::_SCENE_CUSTOMIZE_FADEOUT);
 
     if (rt.norm() > pSkin->info.timeOutro)
@@ -52,7 +52,7 @@ void SceneDecide::_updateAsync()
 
 void SceneDecide::updateStart()
 {
-    auto t = lunaticvibes::Time();
+    auto t = lunaticvibes::Time::frame();
     auto rt = t - State::get(IndexTimer::SCENE_START);
 
     if (!gInCustomize && rt.norm() >= pSkin->info.timeDecideExpiry)
@@ -63,7 +63,7 @@ void SceneDecide::updateStart()
 
 void SceneDecide::updateSkip()
 {
-    auto t = lunaticvibes::Time();
+    auto t = lunaticvibes::Time::frame();
     auto ft = t - State::get(IndexTimer::FADEOUT_BEGIN);
 
     if (ft.norm() >= pSkin->info.timeOutro)
@@ -74,7 +74,7 @@ void SceneDecide::updateSkip()
 
 void SceneDecide::updateCancel()
 {
-    auto t = lunaticvibes::Time();
+    auto t = lunaticvibes::Time::frame();
     auto ft = t - State::get(IndexTimer::FADEOUT_BEGIN);
 
     if (ft.norm() >= pSkin->info.timeOutro)
@@ -142,7 +142,7 @@ void SceneKeyConfig::_updateAsync()
 
 void SceneKeyConfig::updateStart()
 {
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
     lunaticvibes::Time rt = t - State::get(IndexTimer::SCENE_START);
     if (rt.norm() > pSkin->info.timeIntro)
     {
@@ -159,7 +159,7 @@ void SceneKeyConfig::updateStart()
 
 void SceneKeyConfig::updateMain()
 {
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
     if (exiting)
     {
         State::set(IndexTimer::FADEOUT_BEGIN, t.norm());
@@ -176,7 +176,7 @@ void SceneKeyConfig::updateMain()
 
 void SceneKeyConfig::updateFadeout()
 {
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
     lunaticvibes::Time rt = t - State::get(IndexTimer::FADEOUT_BEGIN);
 
     if (rt.norm() > pSkin->info.timeOutro)
@@ -481,7 +481,7 @@ void SceneKeyConfig::updateForceBargraphs()
 
     GameModeKeys keys = gKeyconfigContext.keys;
     const auto input = ConfigMgr::Input(keys);
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
 
     // update keyboard force bargraph
     for (Input::Keyboard k = Input::Keyboard::K_1; k != Input::Keyboard::K_COUNT; ++ * (unsigned*)&k)
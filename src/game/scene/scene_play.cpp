@@ -11,6 +11,7 @@
 #include "common/chartformat/chartformat_bms.h"
 #include "game/chart/chart_bms.h"
 #include "game/graphics/sprite_video.h"
+#include "game/runtime/input_latency.h"
 #include "config/config_mgr.h"
 #include "common/log.h"
 #include "common/sysutil.h"
@@ -148,6 +149,8 @@ ScenePlay::ScenePlay(): SceneBase(gPlayContext.mode, 1000, true)
     {
         _input.setMergeInput();
     }
+    // judge and keysounds run on the update thread, off the input thread
+    _input.setQueuedDispatch();
     _inputAvailable = INPUT_MASK_FUNC;
     _inputAvailable |= INPUT_MASK_1P | INPUT_MASK_2P;
 
@@ -202,7 +205,9 @@ ScenePlay::ScenePlay(): SceneBase(gPlayContext.mode, 1000, true)
         {
             gPlayContext.randomSeed = gPlayContext.replay->randomSeed;
         }
-        gChartContext.chart = ChartFormatBase::createFromFile(gChartContext.path, gPlayContext.randomSeed);
+        gChartContext.chart = g_pChartCache
+            ? g_pChartCache->loadOrParse(gChartContext.path, gChartContext.hash, gPlayContext.randomSeed)
+            : ChartFormatBase::createFromFile(gChartContext.path, gPlayContext.randomSeed);
     }
     if (gChartContext.chart == nullptr || !gChartContext.chart->isLoaded())
     {
@@ -220,7 +225,9 @@ ScenePlay::ScenePlay(): SceneBase(gPlayContext.mode, 1000, true)
 
     if (gPlayContext.replayMybest)
     {
-        gChartContext.chartMybest = ChartFormatBase::createFromFile(gChartContext.path, gPlayContext.replayMybest->randomSeed);
+        gChartContext.chartMybest = g_pChartCache
+            ? g_pChartCache->loadOrParse(gChartContext.path, gChartContext.hash, gPlayContext.replayMybest->randomSeed)
+            : ChartFormatBase::createFromFile(gChartContext.path, gPlayContext.replayMybest->randomSeed);
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////
@@ -743,6 +750,7 @@ bool ScenePlay::createChartObj()
     switch (gChartContext.chart->type())
     {
     case eChartFormat::BMS:
+    case eChartFormat::BMSON:
     {
         auto bms = std::reinterpret_pointer_cast<ChartFormatBMS>(gChartContext.chart);
 
@@ -764,7 +772,6 @@ bool ScenePlay::createChartObj()
         return true;
     }
 
-    case eChartFormat::BMSON:
     default:
         LOG_WARNING << "[Play] chart format not supported.";
         gNextScene = gQuitOnFinish ? SceneType::EXIT_TRANS : SceneType::SELECT;
@@ -785,6 +792,7 @@ bool ScenePlay::createRuleset()
         switch (gChartContext.chart->type())
         {
         case eChartFormat::BMS:
+        case eChartFormat::BMSON:
             if (int rank = 0; gChartContext.chart->getExtendedProperty("RANK", &rank))
             {
                 switch (rank)
@@ -800,7 +808,6 @@ bool ScenePlay::createRuleset()
                 }
             }
             break;
-        case eChartFormat::BMSON:
         default:
             LOG_WARNING << "[Play] chart format not supported.";
             break;
@@ -1351,6 +1358,8 @@ void ScenePlay::removeInputJudgeCallback()
 
 void ScenePlay::_updateAsync()
 {
+    _input.dispatchQueued();
+
     if (gNextScene != SceneType::PLAY) return;
 
     if (gAppIsExiting)
@@ -1358,7 +1367,7 @@ void ScenePlay::_updateAsync()
         gNextScene = SceneType::EXIT_TRANS;
     }
 
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
 
     // update lanecover / hispeed change
     updateAsyncLanecover(t);
@@ -1920,7 +1929,7 @@ void ScenePlay::updateAsyncAbsoluteAxis(const lunaticvibes::Time& t)
 
 void ScenePlay::updatePrepare()
 {
-	auto t = lunaticvibes::Time();
+	auto t = lunaticvibes::Time::frame();
     auto rt = t - State::get(IndexTimer::SCENE_START);
     if (rt.norm() > pSkin->info.timeIntro)
     {
@@ -1934,7 +1943,7 @@ void ScenePlay::updatePrepare()
 
 void ScenePlay::updateLoading()
 {
-	auto t = lunaticvibes::Time();
+	auto t = lunaticvibes::Time::frame();
     auto rt = t - State::get(IndexTimer::_LOAD_START);
 
     State::set(IndexNumber::PLAY_LOAD_PROGRESS_SYS, int(chartObjLoaded * 50 + rulesetLoaded * 50));
@@ -1985,7 +1994,7 @@ void ScenePlay::updateLoading()
 
 void ScenePlay::updateLoadEnd()
 {
-	auto t = lunaticvibes::Time();
+	auto t = lunaticvibes::Time::frame();
     auto rt = t - State::get(IndexTimer::PLAY_READY);
     spinTurntable(false);
     if (rt > pSkin->info.timeGetReady)
@@ -2009,24 +2018,28 @@ void ScenePlay::updateLoadEnd()
 
 void ScenePlay::updatePlaying()
 {
-	auto t = lunaticvibes::Time();
+	auto t = lunaticvibes::Time::frame();
 	auto rt = t - State::get(IndexTimer::PLAY_START);
     State::set(IndexTimer::MUSIC_BEAT, int(1000 * (gPlayContext.chartObj[PLAYER_SLOT_PLAYER]->getCurrentMetre() * 4.0)) % 1000);
 
     assert(gPlayContext.ruleset[PLAYER_SLOT_PLAYER] != nullptr);
     {
+        // publish the results of all players of this tick at once
+        State::Batch batch;
+
         gPlayContext.chartObj[PLAYER_SLOT_PLAYER]->update(rt);
         gPlayContext.ruleset[PLAYER_SLOT_PLAYER]->update(t);
-    }
-    if (gPlayContext.ruleset[PLAYER_SLOT_MYBEST] != nullptr)
-    {
-        gPlayContext.chartObj[PLAYER_SLOT_MYBEST]->update(rt);
-        gPlayContext.ruleset[PLAYER_SLOT_MYBEST]->update(t);
-    }
-    if (gPlayContext.ruleset[PLAYER_SLOT_TARGET] != nullptr)
-    {
-        gPlayContext.chartObj[PLAYER_SLOT_TARGET]->update(rt);
-        gPlayContext.ruleset[PLAYER_SLOT_TARGET]->update(t);
+
+        if (gPlayContext.ruleset[PLAYER_SLOT_MYBEST] != nullptr)
+        {
+            gPlayContext.chartObj[PLAYER_SLOT_MYBEST]->update(rt);
+            gPlayContext.ruleset[PLAYER_SLOT_MYBEST]->update(t);
+        }
+        if (gPlayContext.ruleset[PLAYER_SLOT_TARGET] != nullptr)
+        {
+            gPlayContext.chartObj[PLAYER_SLOT_TARGET]->update(rt);
+            gPlayContext.ruleset[PLAYER_SLOT_TARGET]->update(t);
+        }
     }
 
     // update replay key timers and lanecover values
@@ -2398,7 +2411,7 @@ void ScenePlay::updatePlaying()
 
 void ScenePlay::updateFadeout()
 {
-    auto t = lunaticvibes::Time();
+    auto t = lunaticvibes::Time::frame();
     auto rt = t - State::get(IndexTimer::PLAY_START);
     auto ft = t - State::get(IndexTimer::FADEOUT_BEGIN);
 
@@ -2650,7 +2663,7 @@ void ScenePlay::updateFadeout()
 
 void ScenePlay::updateFailed()
 {
-    auto t = lunaticvibes::Time();
+    auto t = lunaticvibes::Time::frame();
     auto rt = t - State::get(IndexTimer::PLAY_START);
     auto ft = t - State::get(IndexTimer::FAIL_BEGIN);
 
@@ -2694,7 +2707,7 @@ void ScenePlay::updateFailed()
 
 void ScenePlay::updateWaitArena()
 {
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
     auto rt = t - State::get(IndexTimer::PLAY_START);
 
     gPlayContext.chartObj[PLAYER_SLOT_PLAYER]->update(rt);
@@ -2810,14 +2823,20 @@ void ScenePlay::changeKeySampleMapping(const lunaticvibes::Time& t)
     auto changeKeySample = [&](Input::Pad k, int slot)
     {
         chart::NoteLaneIndex idx[3] = { chart::NoteLaneIndex::_, chart::NoteLaneIndex::_, chart::NoteLaneIndex::_ };
-        HitableNote* pNote[3] = { nullptr, nullptr, nullptr };
+        bool hasNote[3] = { false, false, false };
         long long time[3] = { TIMER_NEVER, TIMER_NEVER, TIMER_NEVER };
+        long long sample[3] = { 0, 0, 0 };
 
         idx[0] = gPlayContext.chartObj[slot]->getLaneFromKey(chart::NoteLaneCategory::Note, k);
         if (idx[0] != chart::NoteLaneIndex::_)
         {
-            pNote[0] = &*gPlayContext.chartObj[slot]->incomingNote(chart::NoteLaneCategory::Note, idx[0]);
-            time[0] = pNote[0]->time.hres();
+            auto itNote = gPlayContext.chartObj[slot]->incomingNote(chart::NoteLaneCategory::Note, idx[0]);
+            if (!gPlayContext.chartObj[slot]->isLastNote(chart::NoteLaneCategory::Note, idx[0], itNote))
+            {
+                hasNote[0] = true;
+                time[0] = itNote->time.hres();
+                sample[0] = itNote->dvalue;
+            }
         }
 
         idx[1] = gPlayContext.chartObj[slot]->getLaneFromKey(chart::NoteLaneCategory::LN, k);
@@ -2828,8 +2847,9 @@ void ScenePlay::changeKeySampleMapping(const lunaticvibes::Time& t)
             {
                 if (!(itLNNote->flags & Note::Flags::LN_TAIL))
                 {
-                    pNote[1] = &*itLNNote;
-                    time[1] = pNote[1]->time.hres();
+                    hasNote[1] = true;
+                    time[1] = itLNNote->time.hres();
+                    sample[1] = itLNNote->dvalue;
                     break;
                 }
                 itLNNote++;
@@ -2839,11 +2859,16 @@ void ScenePlay::changeKeySampleMapping(const lunaticvibes::Time& t)
         idx[2] = gPlayContext.chartObj[slot]->getLaneFromKey(chart::NoteLaneCategory::Invs, k);
         if (idx[2] != chart::NoteLaneIndex::_)
         {
-            pNote[2] = &*gPlayContext.chartObj[slot]->incomingNote(chart::NoteLaneCategory::Invs, idx[2]);
-            time[2] = pNote[2]->time.hres();
+            auto itNote = gPlayContext.chartObj[slot]->incomingNote(chart::NoteLaneCategory::Invs, idx[2]);
+            if (!gPlayContext.chartObj[slot]->isLastNote(chart::NoteLaneCategory::Invs, idx[2], itNote))
+            {
+                hasNote[2] = true;
+                time[2] = itNote->time.hres();
+                sample[2] = itNote->dvalue;
+            }
         }
 
-        HitableNote* pNoteKey = nullptr;
+        size_t idxNoteKey = 3;
         std::vector<std::pair<long long, size_t>> sortTmp;
         for (size_t i = 0; i < 3; ++i)
         {
@@ -2852,20 +2877,19 @@ void ScenePlay::changeKeySampleMapping(const lunaticvibes::Time& t)
         std::sort(sortTmp.begin(), sortTmp.end());
         for (size_t i = 0; i < 3; ++i)
         {
-            size_t idxNoteKey = sortTmp[i].second;
-            if (pNote[idxNoteKey])
+            if (hasNote[sortTmp[i].second])
             {
-                pNoteKey = pNote[idxNoteKey];
+                idxNoteKey = sortTmp[i].second;
                 break;
             }
         }
 
-        if (pNoteKey && pNoteKey->time - t <= MIN_REMAP_INTERVAL)
+        if (idxNoteKey < 3 && lunaticvibes::Time(time[idxNoteKey], true) - t <= MIN_REMAP_INTERVAL)
         {
-            keySampleIndex[(size_t)k] = (size_t)pNoteKey->dvalue;
+            keySampleIndex[(size_t)k] = (size_t)sample[idxNoteKey];
 
-            if (k == Input::S1L) keySampleIndex[Input::S1R] = (size_t)pNoteKey->dvalue;
-            if (k == Input::S2L) keySampleIndex[Input::S2R] = (size_t)pNoteKey->dvalue;
+            if (k == Input::S1L) keySampleIndex[Input::S1R] = (size_t)sample[idxNoteKey];
+            if (k == Input::S2L) keySampleIndex[Input::S2R] = (size_t)sample[idxNoteKey];
         }
     };
 
@@ -3057,6 +3081,11 @@ void ScenePlay::inputGamePress(InputMask& m, const lunaticvibes::Time& t)
     {
         inputGamePressTimer(input, t);
         inputGamePressPlayKeysounds(input, t);
+        if ((input & (INPUT_MASK_1P | INPUT_MASK_2P)).any())
+        {
+            InputLatency::recordSince(InputLatency::Stage::KEYSOUND, t);
+            InputLatency::pressHandled(t);
+        }
     }
     if (gChartContext.started && gPlayContext.replayNew)
     {
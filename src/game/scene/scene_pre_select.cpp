@@ -36,6 +36,8 @@ ScenePreSelect::ScenePreSelect(): SceneBase(SkinType::PRE_SELECT, 240)
 
     if (gNextScene == SceneType::PRE_SELECT)
     {
+        isStartup = true;
+
         // score db
         LOG_INFO << "[List] Initializing score.db...";
         g_pScoreDB = std::make_shared<ScoreDB>(ConfigMgr::Profile()->getPath() / "score.db");
@@ -46,6 +48,10 @@ ScenePreSelect::ScenePreSelect(): SceneBase(SkinType::PRE_SELECT, 240)
         Path dbPath = Path(GAMEDATA_PATH) / "database";
         if (!fs::exists(dbPath)) fs::create_directories(dbPath);
         g_pSongDB = std::make_shared<SongDB>(dbPath / "song.db");
+        g_pSongDB->scanAlwaysHash = ConfigMgr::get('E', cfg::E_SCAN_ALWAYS_HASH, false);
+
+        // parsed chart cache
+        g_pChartCache = std::make_shared<ChartFormatCache>(Path(GAMEDATA_PATH) / "cache" / "chart");
 
         std::unique_lock l(gSelectContext._mutex);
         gSelectContext.entries.clear();
@@ -108,13 +114,29 @@ void ScenePreSelect::updateLoadSongs()
                 pathList.emplace_back(f);
             }
 
-            LOG_INFO << "[List] Refreshing folders...";
-            g_pSongDB->initializeFolders(pathList);
-            LOG_INFO << "[List] Refreshing folders complete.";
+            // at startup, browse the saved catalog right away and check the folders in background
+            loadedFromSnapshot = isStartup && g_pSongDB->loadCacheSnapshot();
+            if (loadedFromSnapshot)
+            {
+                LOG_INFO << "[List] Loaded song list cache from snapshot, refreshing folders in background";
+                g_pSongDB->initializeFoldersAsync(pathList);
+            }
+            else
+            {
+                LOG_INFO << "[List] Refreshing folders...";
+                g_pSongDB->initializeFolders(pathList);
+                LOG_INFO << "[List] Refreshing folders complete.";
 
-            LOG_INFO << "[List] Building song list cache...";
-            g_pSongDB->prepareCache();
-            LOG_INFO << "[List] Building song list cache finished.";
+                LOG_INFO << "[List] Building song list cache...";
+                g_pSongDB->prepareCache();
+                LOG_INFO << "[List] Building song list cache finished.";
+            }
+
+            if (ConfigMgr::get('E', cfg::E_WATCH_FOLDERS, true))
+            {
+                g_pSongDB->stopWatching();
+                g_pSongDB->startWatching(pathList);
+            }
 
             LOG_INFO << "[List] Generating root folders...";
             auto top = g_pSongDB->browse(ROOT_FOLDER_HASH, false);
@@ -185,15 +207,17 @@ void ScenePreSelect::updateLoadSongs()
         prevChartLoaded = g_pSongDB->addChartTaskFinishCount;
         textHint = (
             boost::format(i18n::c(i18nText::LOADING_CHARTS))
-                % g_pSongDB->addChartTaskFinishCount
-                % g_pSongDB->addChartTaskCount
+                % g_pSongDB->addChartTaskFinishCount.load()
+                % g_pSongDB->addChartTaskCount.load()
             ).str();
         textHint2 = g_pSongDB->addCurrentPath;
     }
     
     if (loadSongEnd.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
     {
-        g_pSongDB->waitLoadingFinish();
+        // the background scan owns its pipeline
+        if (!loadedFromSnapshot)
+            g_pSongDB->waitLoadingFinish();
         loadSongEnd.get();
         LOG_INFO << "[List] Loading songs complete.";
         LOG_INFO << "[List] ------------------------------------------------------------";
@@ -34,6 +34,10 @@ protected:
     std::string textHint;
     std::string textHint2;
     bool loadingFinished = false;
+    // game start rather than a song list reload from select
+    bool isStartup = false;
+    // song list came from the catalog snapshot, folder scan runs in background
+    bool loadedFromSnapshot = false;
 
 public:
     bool isLoadingFinished() const;
@@ -256,7 +256,7 @@ void SceneResult::_updateAsync()
 
 void SceneResult::updateDraw()
 {
-    auto t = lunaticvibes::Time();
+    auto t = lunaticvibes::Time::frame();
     auto rt = t - State::get(IndexTimer::SCENE_START);
 
     if (rt.norm() >= pSkin->info.timeResultRank)
@@ -283,7 +283,7 @@ void SceneResult::updateRecord()
 
 void SceneResult::updateFadeout()
 {
-    auto t = lunaticvibes::Time();
+    auto t = lunaticvibes::Time::frame();
     auto ft = t - State::get(IndexTimer::FADEOUT_BEGIN);
 
     if (ft >= pSkin->info.timeOutro)
@@ -523,7 +523,7 @@ void SceneResult::updateWaitArena()
 {
     assert(gArenaData.isOnline());
 
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
     if (!gArenaData.isOnline() || !gSelectContext.isArenaReady)
     {
         State::set(IndexTimer::FADEOUT_BEGIN, t.norm());
@@ -543,7 +543,7 @@ void SceneSelect::_updateAsync()
 {
     if (gNextScene != SceneType::SELECT) return;
 
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
 
     if (gAppIsExiting)
     {
@@ -552,6 +552,20 @@ void SceneSelect::_updateAsync()
 
     _updateCallback();
 
+    // pick up changes applied by the song folder watcher or the startup scan. The catalog is rebuilt in background
+    // and swapped in when ready; entries are refreshed from it when browsed again
+    if (!refreshingSongList && g_pSongDB->libraryGeneration != g_pSongDB->cacheGeneration)
+    {
+        g_pSongDB->prepareCacheAsync();
+    }
+
+    // F8 in a folder: the background refresh finished
+    if (folderRefreshFinished->exchange(false))
+    {
+        rebrowseCurrentFolder();
+        refreshingSongList = false;
+    }
+
     if (gSelectContext.optionChangePending)
     {
         gSelectContext.optionChangePending = false;
@@ -845,7 +859,7 @@ void SceneSelect::_updateAsync()
 
 void SceneSelect::updatePrepare()
 {
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
     lunaticvibes::Time rt = t - State::get(IndexTimer::SCENE_START);
 
     if (rt.norm() >= pSkin->info.timeIntro)
@@ -880,7 +894,7 @@ void SceneSelect::updatePrepare()
 
 void SceneSelect::updateSelect()
 {
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
 
     if (!refreshingSongList)
     {
@@ -1093,7 +1107,7 @@ void SceneSelect::updateSelect()
 
 void SceneSelect::updateFadeout()
 {
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
     lunaticvibes::Time ft = t - State::get(IndexTimer::FADEOUT_BEGIN);
 
     if (ft >= pSkin->info.timeOutro)
@@ -1365,6 +1379,50 @@ void SceneSelect::inputGameRelease(InputMask& m, const lunaticvibes::Time& t)
 }
 
 
+void SceneSelect::rebrowseCurrentFolder()
+{
+    if (!isInVersionList)
+        selectDownTimestamp = -1;
+
+    // simplified navigateBack(t)
+    {
+        std::unique_lock<std::shared_mutex> u(gSelectContext._mutex);
+
+        gSelectContext.selectedEntryIndex = 0;
+        gSelectContext.backtrace.pop_front();
+        auto& parent = gSelectContext.backtrace.front();
+        gSelectContext.entries = parent.displayEntries;
+        gSelectContext.selectedEntryIndex = parent.index;
+
+        if (parent.ignoreFilters)
+        {
+            // change display only
+            State::set(IndexOption::SELECT_FILTER_DIFF, Option::DIFF_ANY);
+            State::set(IndexOption::SELECT_FILTER_KEYS, Option::FILTER_KEYS_ALL);
+        }
+        else
+        {
+            // restore prev
+            State::set(IndexOption::SELECT_FILTER_DIFF, gSelectContext.filterDifficulty);
+            int keys = 0;
+            switch (gSelectContext.filterKeys)
+            {
+             case 1: keys = Option::FILTER_KEYS_SINGLE; break;
+             case 7: keys = Option::FILTER_KEYS_7; break;
+             case 5: keys = Option::FILTER_KEYS_5; break;
+             case 2: keys = Option::FILTER_KEYS_DOUBLE; break;
+             case 14: keys = Option::FILTER_KEYS_14; break;
+             case 10: keys = Option::FILTER_KEYS_10; break;
+             case 9: keys = Option::FILTER_KEYS_9; break;
+            }
+            State::set(IndexOption::SELECT_FILTER_KEYS, keys);
+        }
+    }
+
+    // reset infos, play sound
+    navigateEnter(lunaticvibes::Time());
+}
+
 void SceneSelect::inputGamePressSelect(InputMask& input, const lunaticvibes::Time& t)
 {
     if (input[Input::Pad::F8])
@@ -1377,73 +1435,32 @@ void SceneSelect::inputGamePressSelect(InputMask& input, const lunaticvibes::Tim
 
         if (gSelectContext.backtrace.size() >= 2)
         {
-            // only update current folder
+            // only update current folder, in background; browsed again by _updateAsync() when finished
             const auto [hasPath, path] = g_pSongDB->getFolderPath(gSelectContext.backtrace.front().folder);
             if (hasPath)
             {
                 LOG_INFO << "[List] Refreshing folder " << path;
                 State::set(IndexText::_OVERLAY_TOPLEFT, (boost::format(i18n::c(i18nText::REFRESH_FOLDER)) % path.u8string()).str());
 
-                g_pSongDB->resetAddSummary();
-                g_pSongDB->addSubFolder(path, gSelectContext.backtrace.front().parent);
-                g_pSongDB->waitLoadingFinish();
-
-                LOG_INFO << "[List] Building chart hash cache...";
-                g_pSongDB->prepareCache();
-                LOG_INFO << "[List] Building chart hash cache finished.";
-
-                int added = g_pSongDB->addChartSuccess - g_pSongDB->addChartModified;
-                int updated = g_pSongDB->addChartModified;
-                int deleted = g_pSongDB->addChartDeleted;
-                if (added || updated || deleted)
-                {
-                    createNotification((boost::format(i18n::c(i18nText::REFRESH_FOLDER_DETAIL)) % path.u8string() % added % updated % deleted).str());
-                }
-                State::set(IndexText::_OVERLAY_TOPLEFT, "");
-                State::set(IndexText::_OVERLAY_TOPLEFT2, "");
-            }
-
-            // re-browse
-            if (!isInVersionList)
-                selectDownTimestamp = -1;
-
-            // simplified navigateBack(t)
-            {
-                std::unique_lock<std::shared_mutex> u(gSelectContext._mutex);
-
-                gSelectContext.selectedEntryIndex = 0;
-                gSelectContext.backtrace.pop_front();
-                auto& parent = gSelectContext.backtrace.front();
-                gSelectContext.entries = parent.displayEntries;
-                gSelectContext.selectedEntryIndex = parent.index;
-
-                if (parent.ignoreFilters)
+                auto onFinished = [finished = folderRefreshFinished, folderPath = path]
                 {
-                    // change display only
-                    State::set(IndexOption::SELECT_FILTER_DIFF, Option::DIFF_ANY);
-                    State::set(IndexOption::SELECT_FILTER_KEYS, Option::FILTER_KEYS_ALL);
-                }
-                else
-                {
-                    // restore prev
-                    State::set(IndexOption::SELECT_FILTER_DIFF, gSelectContext.filterDifficulty);
-                    int keys = 0;
-                    switch (gSelectContext.filterKeys)
+                    int added = g_pSongDB->addChartSuccess - g_pSongDB->addChartModified;
+                    int updated = g_pSongDB->addChartModified;
+                    int deleted = g_pSongDB->addChartDeleted;
+                    if (added || updated || deleted)
                     {
-                     case 1: keys = Option::FILTER_KEYS_SINGLE; break;
-                     case 7: keys = Option::FILTER_KEYS_7; break;
-                     case 5: keys = Option::FILTER_KEYS_5; break;
-                     case 2: keys = Option::FILTER_KEYS_DOUBLE; break;
-                     case 14: keys = Option::FILTER_KEYS_14; break;
-                     case 10: keys = Option::FILTER_KEYS_10; break;
-                     case 9: keys = Option::FILTER_KEYS_9; break;
+                        createNotification((boost::format(i18n::c(i18nText::REFRESH_FOLDER_DETAIL)) % folderPath.u8string() % added % updated % deleted).str());
                     }
-                    State::set(IndexOption::SELECT_FILTER_KEYS, keys);
-                }
+                    State::set(IndexText::_OVERLAY_TOPLEFT, "");
+                    State::set(IndexText::_OVERLAY_TOPLEFT2, "");
+                    *finished = true;
+                };
+                if (g_pSongDB->refreshSubFolderAsync(path, gSelectContext.backtrace.front().parent, onFinished))
+                    return;
+                State::set(IndexText::_OVERLAY_TOPLEFT, "");
             }
 
-            // reset infos, play sound
-            navigateEnter(lunaticvibes::Time());
+            rebrowseCurrentFolder();
         }
         else
         {
@@ -1991,7 +2008,7 @@ void SceneSelect::decide()
 
         // set gamemode
         gChartContext.isDoubleBattle = false;
-        if (gChartContext.chart->type() == eChartFormat::BMS)
+        if (gChartContext.chart->type() == eChartFormat::BMS || gChartContext.chart->type() == eChartFormat::BMSON)
         {
             auto pBMS = std::reinterpret_pointer_cast<ChartFormatBMSMeta>(gChartContext.chart);
             switch (pBMS->gamemode)
@@ -2947,27 +2964,27 @@ void SceneSelect::searchSong(const std::string& text)
     SoundMgr::playSysSample(SoundChannelType::KEY_SYS, eSoundSample::SOUND_F_OPEN);
 }
 
-// returns empty Path on error.
-Path getChartPath(const std::shared_ptr<EntryBase>& entry)
+// returns nullptr if the entry has no chart.
+static std::shared_ptr<ChartFormatBase> getEntryChart(const std::shared_ptr<EntryBase>& entry)
 {
     if (entry == nullptr)
-        return {};
+        return nullptr;
 
     const auto type = entry->type();
 
     if (type == eEntryType::SONG || type == eEntryType::RIVAL_SONG)
-    {
-        auto chart = std::reinterpret_pointer_cast<EntryFolderSong>(entry)->getCurrentChart();
-        if (chart)
-            return chart->absolutePath;
-    }
+        return std::reinterpret_pointer_cast<EntryFolderSong>(entry)->getCurrentChart();
     else if (type == eEntryType::CHART || type == eEntryType::RIVAL_CHART)
-    {
-        auto chart = std::reinterpret_pointer_cast<EntryChart>(entry)->_file;
-        if (chart)
-            return chart->absolutePath;
-    }
+        return std::reinterpret_pointer_cast<EntryChart>(entry)->_file;
+
+    return nullptr;
+}
 
+// returns empty Path on error.
+Path getChartPath(const std::shared_ptr<EntryBase>& entry)
+{
+    if (auto chart = getEntryChart(entry))
+        return chart->absolutePath;
     return {};
 }
 
@@ -3024,11 +3041,16 @@ void SceneSelect::updatePreview()
     case PREVIEW_START_CHART_LOADING:
     {
         Path previewChartPath;
+        HashMD5 previewChartHash;
         size_t entryIndex;
         {
             std::shared_lock l{gSelectContext._mutex};
             entryIndex = gSelectContext.selectedEntryIndex;
-            previewChartPath = getChartPath(gSelectContext.entries[entryIndex].first);
+            if (auto chart = getEntryChart(gSelectContext.entries[entryIndex].first))
+            {
+                previewChartPath = chart->absolutePath;
+                previewChartHash = chart->fileHash;
+            }
         }
         if (previewChartPath.empty())
         {
@@ -3047,9 +3069,10 @@ void SceneSelect::updatePreview()
 
         if (_previewChartLoading.joinable())
             _previewChartLoading.join();
-        _previewChartLoading = std::thread([&, previewChartPath, entryIndex]() {
-            std::shared_ptr<ChartFormatBase> previewChartTmp =
-                ChartFormatBase::createFromFile(previewChartPath, gPlayContext.randomSeed);
+        _previewChartLoading = std::thread([&, previewChartPath, previewChartHash, entryIndex]() {
+            std::shared_ptr<ChartFormatBase> previewChartTmp = g_pChartCache
+                ? g_pChartCache->loadOrParse(previewChartPath, previewChartHash, gPlayContext.randomSeed)
+                : ChartFormatBase::createFromFile(previewChartPath, gPlayContext.randomSeed);
             if (std::shared_lock l{gSelectContext._mutex}; entryIndex != gSelectContext.selectedEntryIndex)
             {
                 LOG_DEBUG << "[Select] Chart changed, discarding";
@@ -3085,6 +3108,7 @@ void SceneSelect::updatePreview()
         switch (previewChartTmp->type())
         {
         case eChartFormat::BMS:
+        case eChartFormat::BMSON:
         {
             auto bms = std::reinterpret_pointer_cast<ChartFormatBMS>(previewChartTmp);
 
@@ -3175,8 +3199,7 @@ void SceneSelect::updatePreview()
             break;
         }
 
-        case eChartFormat::UNKNOWN:
-        case eChartFormat::BMSON: assert(false);
+        case eChartFormat::UNKNOWN: assert(false);
         }
 
         break;
@@ -3248,7 +3271,7 @@ void SceneSelect::updatePreview()
         }
         else
         {
-            auto t = lunaticvibes::Time();
+            auto t = lunaticvibes::Time::frame();
             auto rt = t - previewStartTime;
             previewChartObj->update(rt);
             previewRuleset->update(t);
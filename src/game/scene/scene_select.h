@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -76,6 +77,10 @@ private:
     // F8
     std::shared_ptr<ScenePreSelect> _virtualSceneLoadSongs;
     bool refreshingSongList = false;
+    // set by the background refresh, which may outlive the scene
+    std::shared_ptr<std::atomic<bool>> folderRefreshFinished = std::make_shared<std::atomic<bool>>(false);
+    // F8 in a folder: browse the refreshed folder again, as if leaving and entering it
+    void rebrowseCurrentFolder();
 
     // 5+7 / 6+7
     bool isHoldingK15 = false;
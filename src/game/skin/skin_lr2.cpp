@@ -4319,7 +4319,7 @@ void SkinLR2::update()
     // update op
     updateDstOpt();
 
-    lunaticvibes::Time t;
+    auto t = lunaticvibes::Time::frame();
 
     // update turntables
     {
@@ -5,10 +5,29 @@
 #include "game/ruleset/ruleset_network.h"
 #include "game/ruleset/ruleset_bms.h"
 
-static std::shared_mutex _mutex;
-static std::bitset<900> _op;
+// Options are built in _op and _customOp under _mutex, then published to _opPublished as atomic words, so
+// getDstOpt() never waits for an update in progress.
+// 0-899: built-in options, 900-999: skin custom options, 1000+: extended options
+static constexpr size_t DST_OPTION_COUNT = 2000;
+static std::mutex _mutex;
+static std::bitset<DST_OPTION_COUNT> _op;
 static std::bitset<100> _customOp;
-std::map<size_t, bool> _extendedOp;
+static std::array<std::atomic<uint64_t>, (DST_OPTION_COUNT + 63) / 64> _opPublished{};
+
+static void publishDstOpt()
+{
+	auto bits = _op;
+	for (size_t i = 0; i < _customOp.size(); ++i)
+		bits[900 + i] = _customOp[i];
+
+	for (size_t w = 0; w < _opPublished.size(); ++w)
+	{
+		uint64_t word = 0;
+		for (size_t b = 0; b < 64 && w * 64 + b < DST_OPTION_COUNT; ++b)
+			if (bits[w * 64 + b]) word |= 1ull << b;
+		_opPublished[w].store(word, std::memory_order_relaxed);
+	}
+}
 
 inline bool dst(IndexOption option_entry, std::initializer_list<unsigned> entries)
 {
@@ -35,10 +54,8 @@ inline bool sw(IndexSwitch entry)
 
 inline void set(int idx, bool val = true)
 {
-	if (idx >= 1000)
-		_extendedOp[idx] = val;
-	else
-		_op.set(idx, val); 
+	if (idx < (int)DST_OPTION_COUNT)
+		_op.set(idx, val);
 }
 inline void set(std::initializer_list<int> idx, bool val = true)
 {
@@ -47,10 +64,7 @@ inline void set(std::initializer_list<int> idx, bool val = true)
 }
 inline bool get(int idx)
 {
-	if (idx >= 1000)
-		return _extendedOp[idx];
-	else
-		return _op[idx]; 
+	return idx < (int)DST_OPTION_COUNT && _op[idx];
 }
 
 bool getDstOpt(int d)
@@ -58,22 +72,14 @@ bool getDstOpt(int d)
 	bool result = false;
 	dst_option op = (dst_option)std::abs(d);
 
-	std::shared_lock l(_mutex);
 	if (d == 9999)	// Lunatic Vibes flag
 		result = true;
 	else if (d == DST_TRUE)
 		result = true;
 	else if (d == DST_FALSE)
 		result = false;
-	else if (op < 900)
-		result = _op[op];
-	else if (op >= 900) 
-	{
-		if (op > 999)
-			result = _extendedOp[op];
-		else
-			result = _customOp[op - 900];
-	}
+	else if ((size_t)op < DST_OPTION_COUNT)
+		result = (_opPublished[(size_t)op / 64].load(std::memory_order_relaxed) >> ((size_t)op % 64)) & 1;
 	return (d >= 0) ? result : !result;
 }
 
@@ -82,12 +88,14 @@ void setCustomDstOpt(unsigned base, size_t offset, bool val)
     if (base + offset < 900 || base + offset > 999) return;
 	std::unique_lock l(_mutex);
     _customOp[base + offset - 900] = val;
+	publishDstOpt();
 }
 
 void clearCustomDstOpt()
 {
 	std::unique_lock l(_mutex);
 	_customOp.reset();
+	publishDstOpt();
 }
 
 void updateDstOpt()
@@ -95,9 +103,6 @@ void updateDstOpt()
 	std::unique_lock l(_mutex);
 	_op.reset();
 
-	for (auto& [i, o] : _extendedOp)
-		o = false;
-
 	// 0 常にtrue
 	set(0);
 	// 1 選択中バーがフォルダ
@@ -1241,4 +1246,6 @@ void updateDstOpt()
 			set(1401 + i, gArenaData.isPlayerReady(i));
 		}
 	}
+
+	publishDstOpt();
 }
\ No newline at end of file
@@ -16,6 +16,11 @@
 
 SoundDriverFMOD::SoundDriverFMOD(): SoundDriver(std::bind(&SoundDriverFMOD::update, this))
 {
+    setThreadPolicy(AsyncLooper::ThreadPolicy::parse(
+        ConfigMgr::get('E', cfg::E_THREAD_SOUND_CPUS, ""),
+        ConfigMgr::get('E', cfg::E_THREAD_SOUND_SCHED, cfg::E_THREAD_SCHED_NORMAL),
+        ConfigMgr::get('E', cfg::E_THREAD_SOUND_PRIORITY, 70)));
+
     // load device
     int driver = -1;
     FMOD_OUTPUTTYPE outputType = FMOD_OUTPUTTYPE_AUTODETECT;
@@ -906,6 +911,8 @@ void SoundDriverFMOD::update()
 {
     if (!fmodSystem) return;
 
+    auto t = lunaticvibes::Time::frame();
+
     if (sysVolume != sysVolumeGradientEnd)
     {
         if (sysVolumeGradientLength == 0)
@@ -914,7 +921,7 @@ void SoundDriverFMOD::update()
         }
         else
         {
-            double progress = double((lunaticvibes::Time() - sysVolumeGradientBeginTime).norm()) / sysVolumeGradientLength;
+            double progress = double((t - sysVolumeGradientBeginTime).norm()) / sysVolumeGradientLength;
             if (progress >= 1.0)
             {
                 sysVolume = sysVolumeGradientEnd;
@@ -935,7 +942,7 @@ void SoundDriverFMOD::update()
         }
         else
         {
-            double progress = double((lunaticvibes::Time() - noteVolumeGradientBeginTime).norm()) / noteVolumeGradientLength;
+            double progress = double((t - noteVolumeGradientBeginTime).norm()) / noteVolumeGradientLength;
             if (progress >= 1.0)
             {
                 noteVolume = noteVolumeGradientEnd;
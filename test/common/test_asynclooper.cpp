@@ -0,0 +1,61 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <gmock/gmock.h>
+
+#include <common/asynclooper.h>
+
+TEST(AsyncLooper, ParseThreadPolicy)
+{
+    using Policy = AsyncLooper::ThreadPolicy;
+
+    auto p = Policy::parse("2, 4-6,x,9-8", "fifo", 80);
+    EXPECT_EQ(p.cpus, (std::vector<unsigned>{ 2, 4, 5, 6 }));
+    EXPECT_EQ(p.scheduler, Policy::Scheduler::FIFO);
+    EXPECT_EQ(p.priority, 80);
+
+    p = Policy::parse("", "RR", 1);
+    EXPECT_TRUE(p.cpus.empty());
+    EXPECT_EQ(p.scheduler, Policy::Scheduler::RR);
+
+    p = Policy::parse("0", "Normal", 0);
+    EXPECT_EQ(p.cpus, (std::vector<unsigned>{ 0 }));
+    EXPECT_EQ(p.scheduler, Policy::Scheduler::NORMAL);
+}
+
+TEST(AsyncLooper, NextDeadline)
+{
+    // on time or early
+    EXPECT_EQ(AsyncLooper::nextDeadline(1000, 100, 1050), 1100);
+    EXPECT_EQ(AsyncLooper::nextDeadline(1000, 100, 900), 1100);
+    // late by less than a period: run the next tick right away to catch up
+    EXPECT_EQ(AsyncLooper::nextDeadline(1000, 100, 1150), 1100);
+    // late by a period or more: skip to the first boundary after now
+    EXPECT_EQ(AsyncLooper::nextDeadline(1000, 100, 1200), 1300);
+    EXPECT_EQ(AsyncLooper::nextDeadline(1000, 100, 1250), 1300);
+    EXPECT_EQ(AsyncLooper::nextDeadline(1000, 100, 1999), 2000);
+    // no rate
+    EXPECT_EQ(AsyncLooper::nextDeadline(1000, 0, 5000), 1000);
+}
+
+#ifndef _WIN32
+TEST(AsyncLooper, KeepsRateWithSlowBody)
+{
+    // the body takes half of the period; a sleep-after-body loop would run at about 2/3 of the rate
+    std::atomic<int> count{ 0 };
+    AsyncLooper looper("test", [&]() {
+        ++count;
+        auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(5000);
+        while (std::chrono::steady_clock::now() < until);
+    }, 100);
+
+    looper.loopStart();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    looper.loopEnd();
+
+    // loose bounds for loaded machines; NextDeadline checks the arithmetic
+    EXPECT_GE(count, 75);
+    EXPECT_LE(count, 105);
+}
+#endif
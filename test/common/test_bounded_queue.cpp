@@ -0,0 +1,47 @@
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include <common/bounded_queue.h>
+
+TEST(BoundedQueue, PopsInOrderAndDrainsAfterClose)
+{
+    lunaticvibes::BoundedQueue<int> q{4};
+    EXPECT_TRUE(q.push(1));
+    EXPECT_TRUE(q.push(2));
+    q.close();
+    EXPECT_FALSE(q.push(3));
+
+    int v = 0;
+    EXPECT_TRUE(q.pop(v));
+    EXPECT_EQ(v, 1);
+    EXPECT_TRUE(q.pop(v));
+    EXPECT_EQ(v, 2);
+    EXPECT_FALSE(q.pop(v));
+}
+
+TEST(BoundedQueue, ProducerBlocksUntilConsumed)
+{
+    lunaticvibes::BoundedQueue<int> q{2};
+    static constexpr int COUNT = 1000;
+
+    std::thread producer([&] {
+        for (int i = 0; i < COUNT; ++i)
+            q.push(i);
+        q.close();
+    });
+
+    std::vector<int> received;
+    int v = 0;
+    while (q.pop(v))
+    {
+        EXPECT_LE(q.size(), 2u);
+        received.push_back(v);
+    }
+    producer.join();
+
+    ASSERT_EQ(received.size(), static_cast<size_t>(COUNT));
+    for (int i = 0; i < COUNT; ++i)
+        EXPECT_EQ(received[i], i);
+}
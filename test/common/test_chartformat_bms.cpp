@@ -1,5 +1,6 @@
 #include "gmock/gmock.h"
 #include "common/chartformat/chartformat_bms.h"
+#include "game/chart/chart_bms.h"
 #include "../../src/common/utils.h"
 
 bool ExpectNotePosition(const ChartFormatBMS& bms, LaneCode area, int ch, int bar, int res, const std::vector<int>& segments)
@@ -302,4 +303,46 @@ TEST(tBMS, ln)
 	EXPECT_TRUE(ExpectNotePosition(*bms, bms::LaneCode::NOTELN1, 0, 4, 4, std::vector<int>{ 2, 3 }));
 	EXPECT_TRUE(ExpectNotePosition(*bms, bms::LaneCode::NOTELN2, 0, 4, 4, std::vector<int>{ 3 }));
 	EXPECT_TRUE(ExpectNotePosition(*bms, bms::LaneCode::NOTELN2, 0, 5, 4, std::vector<int>{ 0 }));
-}
\ No newline at end of file
+}
+TEST(tBMS, metadata_only)
+{
+	for (const char* file : { "bms/5k.bms", "bms/7k.bme", "bms/10k.bms", "bms/14k.bme", "bms/ln.bme", "bms/bpm.bms", "bms/stop.bms", "bms/bar.bms", "bms/bgm32.bms" })
+	{
+		SCOPED_TRACE(file);
+		std::shared_ptr<ChartFormatBMS> bms, meta;
+		ASSERT_NO_THROW(bms = std::make_shared<ChartFormatBMS>(file));
+		ASSERT_NO_THROW(meta = ChartFormatBMS::createMetadataFromFile(file));
+		ASSERT_EQ(meta->isLoaded(), true);
+		EXPECT_TRUE(meta->isMetadataOnly());
+
+		EXPECT_EQ(meta->fileHash, bms->fileHash);
+		EXPECT_EQ(meta->title, bms->title);
+		EXPECT_EQ(meta->gamemode, bms->gamemode);
+		EXPECT_EQ(meta->player, bms->player);
+		EXPECT_EQ(meta->lastBarIdx, bms->lastBarIdx);
+		EXPECT_FLOAT_EQ(meta->minBPM, bms->minBPM);
+		EXPECT_FLOAT_EQ(meta->maxBPM, bms->maxBPM);
+		EXPECT_EQ(meta->haveLN, bms->haveLN);
+		EXPECT_EQ(meta->haveStop, bms->haveStop);
+		EXPECT_EQ(meta->notes_total, bms->notes_total);
+		EXPECT_EQ(meta->notes_scratch, bms->notes_scratch);
+		EXPECT_EQ(meta->notes_key, bms->notes_key);
+		EXPECT_EQ(meta->notes_scratch_ln, bms->notes_scratch_ln);
+		EXPECT_EQ(meta->notes_key_ln, bms->notes_key_ln);
+		EXPECT_EQ(meta->totalNotes, static_cast<int>(bms->notes_total));
+	}
+
+	// 1.6s + 3.2s + 1.2s + 1.6s, plus one measure after the last bar
+	auto meta = ChartFormatBMS::createMetadataFromFile("bms/bar.bms");
+	EXPECT_EQ(meta->totalLength, 9);
+
+	// same length as a full load, with BPM changes, stops and long notes
+	for (const char* file : { "bms/bpm.bms", "bms/stop.bms", "bms/ln.bme" })
+	{
+		SCOPED_TRACE(file);
+		auto bms = std::make_shared<ChartFormatBMS>(file);
+		ChartObjectBMS chart(0, bms);
+		meta = ChartFormatBMS::createMetadataFromFile(file);
+		EXPECT_EQ(meta->totalLength, static_cast<int>(chart.getTotalLength().norm() / 1000));
+	}
+}
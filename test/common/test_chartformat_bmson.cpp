@@ -0,0 +1,137 @@
+#include "gmock/gmock.h"
+#include "common/chartformat/chartformat_bmson.h"
+
+static std::vector<std::pair<unsigned, unsigned>> LaneNotes(const ChartFormatBMS& bms, LaneCode code, unsigned ch, unsigned bar, unsigned* resolution = nullptr)
+{
+	std::vector<std::pair<unsigned, unsigned>> ret;
+	auto lane = bms.getLane(code, ch, bar);
+	for (const auto& n : lane.notes)
+		ret.push_back({ n.segment, n.value });
+	if (resolution) *resolution = lane.resolution;
+	return ret;
+}
+
+TEST(tBMSON, file_not_exist)
+{
+	std::shared_ptr<ChartFormatBMSON> bmson = nullptr;
+	ASSERT_NO_THROW(bmson = std::make_shared<ChartFormatBMSON>("bmson/asdlfkjasdlfkjsdalgjsdalgjasd.bmson"));
+	EXPECT_EQ(bmson->isLoaded(), false);
+}
+
+TEST(tBMSON, invalid_json)
+{
+	std::shared_ptr<ChartFormatBMSON> bmson = nullptr;
+	ASSERT_NO_THROW(bmson = ChartFormatBMSON::createMetadataFromBuffer("bmson/invalid.bmson", R"({"version": "1.0.0", "info": {)"));
+	EXPECT_EQ(bmson->isLoaded(), false);
+	ASSERT_NO_THROW(bmson = ChartFormatBMSON::createMetadataFromBuffer("bmson/legacy.bmson", R"({"info": {"initBPM": 120}})"));
+	EXPECT_EQ(bmson->isLoaded(), false);
+}
+
+TEST(tBMSON, meta_basic)
+{
+	auto chart = ChartFormatBase::createFromFile("bmson/7k.bmson", 0);
+	ASSERT_NE(chart, nullptr);
+	ASSERT_EQ(chart->isLoaded(), true);
+	EXPECT_EQ(chart->type(), eChartFormat::BMSON);
+
+	auto bmson = std::reinterpret_pointer_cast<ChartFormatBMSON>(chart);
+	EXPECT_EQ(bmson->title, "Test");
+	EXPECT_EQ(bmson->artist, "A");
+	EXPECT_EQ(bmson->artist2, "obj:B illust:C");
+	EXPECT_EQ(bmson->genre, "G");
+	EXPECT_EQ(bmson->version, "HYPER");
+	EXPECT_EQ(bmson->difficulty, 3);
+	EXPECT_EQ(bmson->playLevel, 7);
+	EXPECT_EQ(bmson->gamemode, 7);
+	EXPECT_EQ(bmson->player, 1);
+	EXPECT_EQ(bmson->rank, 3);
+	EXPECT_EQ(bmson->total, 320);
+	EXPECT_EQ(bmson->extraCommands["PREVIEW"], "pre.ogg");
+	EXPECT_DOUBLE_EQ(bmson->startBPM, 120.0);
+	EXPECT_DOUBLE_EQ(bmson->minBPM, 120.0);
+	EXPECT_DOUBLE_EQ(bmson->maxBPM, 180.0);
+
+	EXPECT_EQ(bmson->wavFiles[1], "a.wav");
+	EXPECT_EQ(bmson->wavFiles[2], "b.wav");
+	EXPECT_EQ(bmson->wavFiles[3], "bgm.wav");
+	EXPECT_EQ(bmson->wavFiles[4], "inv.wav");
+	EXPECT_EQ(bmson->bgaFiles[1], "bg.png");
+
+	EXPECT_EQ(bmson->notes_key, 2);
+	EXPECT_EQ(bmson->notes_scratch, 1);
+	EXPECT_EQ(bmson->notes_key_ln, 1);
+	EXPECT_EQ(bmson->notes_mine, 1);
+	EXPECT_EQ(bmson->notes_total, 4);
+	EXPECT_TRUE(bmson->haveLN);
+	EXPECT_TRUE(bmson->haveMine);
+	EXPECT_TRUE(bmson->haveInvisible);
+	EXPECT_TRUE(bmson->haveBPMChange);
+	EXPECT_TRUE(bmson->haveStop);
+	EXPECT_TRUE(bmson->haveMetricMod);
+	EXPECT_TRUE(bmson->haveBGA);
+
+	// 4 beats at 120, 3 beats at 180, stop for 1 beat at 180, 4 beats at 180
+	EXPECT_EQ(bmson->totalLength, 4);
+	EXPECT_EQ(bmson->totalNotes, 4);
+}
+
+TEST(tBMSON, lanes)
+{
+	auto bmson = std::make_shared<ChartFormatBMSON>("bmson/7k.bmson");
+	ASSERT_EQ(bmson->isLoaded(), true);
+
+	// the bar after the last object is kept
+	ASSERT_EQ(bmson->lastBarIdx, 3);
+	EXPECT_EQ(bmson->metres[0], Metre(1, 1));
+	EXPECT_EQ(bmson->metres[1], Metre(3, 4));
+	EXPECT_EQ(bmson->metres[2], Metre(1, 1));
+	EXPECT_EQ(bmson->metres[3], Metre(1, 1));
+
+	using v = std::vector<std::pair<unsigned, unsigned>>;
+	unsigned res = 0;
+	EXPECT_EQ(LaneNotes(*bmson, LaneCode::NOTE1, 1, 0, &res), (v{ { 0, 1 } }));
+	EXPECT_EQ(res, 960);
+	EXPECT_EQ(LaneNotes(*bmson, LaneCode::NOTE1, 0, 0), (v{ { 240, 1 } }));
+
+	// LN tail in the next bar
+	EXPECT_EQ(LaneNotes(*bmson, LaneCode::NOTELN1, 2, 0), (v{ { 480, 2 } }));
+	EXPECT_EQ(LaneNotes(*bmson, LaneCode::NOTELN1, 2, 1, &res), (v{ { 0, 2 } }));
+	EXPECT_EQ(res, 720);
+
+	// continued slice is silent
+	EXPECT_EQ(LaneNotes(*bmson, LaneCode::NOTE1, 3, 2), (v{ { 0, 0 } }));
+
+	// BGM at the same pulse are spread into layers, continued BGM is dropped
+	EXPECT_EQ(bmson->bgmLayersCount[0], 2);
+	EXPECT_EQ(LaneNotes(*bmson, LaneCode::BGM, 0, 0), (v{ { 0, 1 } }));
+	EXPECT_EQ(LaneNotes(*bmson, LaneCode::BGM, 1, 0), (v{ { 0, 2 } }));
+	EXPECT_EQ(bmson->bgmLayersCount[2], 0);
+
+	// BPM change to the same value is dropped
+	EXPECT_EQ(LaneNotes(*bmson, LaneCode::EXBPM, 0, 1), (v{ { 0, 1 } }));
+	EXPECT_DOUBLE_EQ(bmson->exBPM[1], 180.0);
+	EXPECT_EQ(LaneNotes(*bmson, LaneCode::STOP, 0, 2), (v{ { 0, 1 } }));
+	EXPECT_DOUBLE_EQ(bmson->stop[1], 48.0);
+
+	EXPECT_EQ(LaneNotes(*bmson, LaneCode::NOTEMINE1, 4, 2), (v{ { 240, 20 } }));
+	EXPECT_EQ(LaneNotes(*bmson, LaneCode::NOTEINV1, 5, 2), (v{ { 240, 4 } }));
+	EXPECT_EQ(LaneNotes(*bmson, LaneCode::BGABASE, 0, 0), (v{ { 0, 1 } }));
+}
+
+TEST(tBMSON, metadata_only)
+{
+	auto bmson = std::make_shared<ChartFormatBMSON>("bmson/7k.bmson");
+	auto meta = ChartFormatBMSON::createMetadataFromFile("bmson/7k.bmson");
+	ASSERT_EQ(meta->isLoaded(), true);
+	EXPECT_TRUE(meta->isMetadataOnly());
+	EXPECT_EQ(meta->type(), eChartFormat::BMSON);
+
+	EXPECT_EQ(meta->fileHash, bmson->fileHash);
+	EXPECT_EQ(meta->title, bmson->title);
+	EXPECT_EQ(meta->gamemode, bmson->gamemode);
+	EXPECT_EQ(meta->lastBarIdx, bmson->lastBarIdx);
+	EXPECT_EQ(meta->notes_total, bmson->notes_total);
+	EXPECT_EQ(meta->totalLength, bmson->totalLength);
+	EXPECT_TRUE(meta->wavFiles.empty());
+	EXPECT_TRUE(meta->getLane(LaneCode::NOTE1, 1, 0).notes.empty());
+}
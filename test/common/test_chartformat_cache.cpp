@@ -0,0 +1,99 @@
+#include <fstream>
+
+#include "gmock/gmock.h"
+#include "common/chartformat/chartformat_bms.h"
+#include "common/chartformat/chartformat_cache.h"
+
+class tChartCache : public ::testing::Test
+{
+protected:
+	Path cacheDir = "chartcache_test";
+	Path chartDir = "chartcache_test_charts";
+
+	void SetUp() override
+	{
+		fs::remove_all(cacheDir);
+		fs::remove_all(chartDir);
+		fs::create_directories(chartDir);
+	}
+	void TearDown() override
+	{
+		fs::remove_all(cacheDir);
+		fs::remove_all(chartDir);
+	}
+};
+
+static void ExpectSameLane(const ChartFormatBMS& a, const ChartFormatBMS& b, LaneCode code, unsigned ch)
+{
+	for (unsigned bar = 0; bar <= a.lastBarIdx; ++bar)
+	{
+		auto la = a.getLane(code, ch, bar);
+		auto lb = b.getLane(code, ch, bar);
+		ASSERT_EQ(la.resolution, lb.resolution) << "bar " << bar;
+		ASSERT_EQ(la.notes.size(), lb.notes.size()) << "bar " << bar;
+		for (auto ia = la.notes.begin(), ib = lb.notes.begin(); ia != la.notes.end(); ++ia, ++ib)
+		{
+			EXPECT_EQ(ia->segment, ib->segment);
+			EXPECT_EQ(ia->value, ib->value);
+			EXPECT_EQ(ia->flags, ib->flags);
+		}
+	}
+}
+
+TEST_F(tChartCache, round_trip)
+{
+	fs::copy_file("bms/ln.bme", chartDir / "ln.bme");
+	ChartFormatCache cache(cacheDir);
+
+	auto parsed = cache.loadOrParse(chartDir / "ln.bme", {}, 0);
+	ASSERT_NE(parsed, nullptr);
+	ASSERT_TRUE(parsed->isLoaded());
+
+	auto cached = cache.load(chartDir / "ln.bme", {}, 0);
+	ASSERT_NE(cached, nullptr);
+	ASSERT_TRUE(cached->isLoaded());
+
+	auto& a = *std::reinterpret_pointer_cast<ChartFormatBMS>(parsed);
+	auto& b = *std::reinterpret_pointer_cast<ChartFormatBMS>(cached);
+	EXPECT_EQ(a.fileHash, b.fileHash);
+	EXPECT_EQ(a.absolutePath, b.absolutePath);
+	EXPECT_EQ(a.title, b.title);
+	EXPECT_EQ(a.wavFiles, b.wavFiles);
+	EXPECT_EQ(a.totalLength, b.totalLength);
+	EXPECT_EQ(a.notes_key_ln, b.notes_key_ln);
+	EXPECT_EQ(a.lastBarIdx, b.lastBarIdx);
+	for (unsigned ch = 0; ch < 20; ++ch)
+	{
+		ExpectSameLane(a, b, LaneCode::NOTE1, ch);
+		ExpectSameLane(a, b, LaneCode::NOTELN1, ch);
+	}
+	ExpectSameLane(a, b, LaneCode::BPM, 0);
+	EXPECT_EQ(a.bgmLayersCount, b.bgmLayersCount);
+	ExpectSameLane(a, b, LaneCode::BGM, 0);
+}
+
+TEST_F(tChartCache, modified_file_is_not_loaded)
+{
+	fs::copy_file("bms/5k.bms", chartDir / "5k.bms");
+	ChartFormatCache cache(cacheDir);
+
+	auto parsed = cache.loadOrParse(chartDir / "5k.bms", {}, 0);
+	ASSERT_NE(parsed, nullptr);
+	HashMD5 hash = parsed->fileHash;
+	ASSERT_NE(cache.load(chartDir / "5k.bms", hash, 0), nullptr);
+
+	{
+		std::ofstream ofs(chartDir / "5k.bms", std::ios::binary | std::ios::app);
+		ofs << "\r\n#00111:01\r\n";
+	}
+	EXPECT_EQ(cache.load(chartDir / "5k.bms", hash, 0), nullptr);
+	EXPECT_EQ(cache.load(chartDir / "5k.bms", {}, 0), nullptr);
+}
+
+TEST_F(tChartCache, metadata_only_is_not_saved)
+{
+	ChartFormatCache cache(cacheDir);
+	auto bms = ChartFormatBMS::createMetadataFromFile("bms/5k.bms");
+	ASSERT_TRUE(bms->isLoaded());
+	EXPECT_FALSE(cache.save(*bms, 0));
+}
@@ -14,6 +14,38 @@ TEST(Encoding, CanDetermineFileEncoding)
     EXPECT_EQ(getFileEncoding("encoding/utf8.txt"_p), eFileEncoding::UTF8);
 }
 
+TEST(Encoding, CanDetermineBufferEncoding)
+{
+    for (const auto& [file, encoding] : { std::pair{ "encoding/euc_kr.txt", eFileEncoding::EUC_KR },
+                                          std::pair{ "encoding/sjis.txt", eFileEncoding::SHIFT_JIS },
+                                          std::pair{ "encoding/utf8.txt", eFileEncoding::UTF8 } })
+    {
+        std::ifstream ifs(file, std::ios::binary);
+        ASSERT_FALSE(ifs.fail());
+        std::string contents{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+        EXPECT_EQ(getContentEncoding(std::string_view(contents)), encoding) << file;
+    }
+    EXPECT_EQ(getContentEncoding(std::string_view("#TITLE ascii\r\n")), eFileEncoding::LATIN1);
+}
+
+TEST(Encoding, CanConvertBuffer)
+{
+    std::ifstream ifs("encoding/sjis.txt", std::ios::binary);
+    ASSERT_FALSE(ifs.fail());
+    std::string contents{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+    std::string converted = to_utf8_buffer(contents, eFileEncoding::SHIFT_JIS);
+    EXPECT_EQ(converted.substr(0, converted.find('\n')), "SUBTITLE \xE8\xB5\xA4\xE3\x81\x84\xE4\xBA\xBA"); // 赤い人
+
+    // not limited by any buffer size
+    std::string large(100000, 'a');
+    large += "\xE0";
+    EXPECT_EQ(to_utf8_buffer(large, eFileEncoding::LATIN1), std::string(100000, 'a') + "\xC3\xA0");
+
+    // invalid bytes don't fail the rest of the buffer
+    EXPECT_EQ(to_utf8_buffer("abc\xFF" "def", eFileEncoding::SHIFT_JIS), "abc?def");
+    EXPECT_EQ(to_utf8_buffer("abc\x81", eFileEncoding::SHIFT_JIS), "abc?");
+}
+
 // Not about 'Encoding' per se but sure.
 TEST(Encoding, CanOpenUtf8FilePath)
 {
@@ -1,5 +1,5 @@
 #include "gmock/gmock.h"
-#include "common/fraction.h"
+#include "common/beat.h"
 TEST(Fraction, trim)
 {
     EXPECT_EQ(fraction(1, 2), fraction(2, 4));
@@ -131,3 +131,32 @@ TEST(Fraction, mulbasic3)
     fraction f2(1, 3);
     EXPECT_EQ(f1 * f2, fraction(5, 4));
 }
+
+TEST(Metre, exact)
+{
+    EXPECT_EQ(Metre(4, 4), Metre(1, 1));
+    EXPECT_EQ(Metre(3, 4), Metre(0.75));
+    EXPECT_EQ(Metre(1, 192) + Metre(191, 192), Metre(1, 1));
+    EXPECT_EQ(Metre(1, 3) * fraction(3, 7), Metre(1, 7));
+    EXPECT_EQ(fraction(1, 256) * Metre(3, 4), Metre(3, 1024));
+    EXPECT_LT(Metre(1, 3), Metre(0.3334));
+    EXPECT_DOUBLE_EQ(Metre(5, 8).toDouble(), 0.625);
+}
+
+TEST(Metre, large)
+{
+    EXPECT_EQ(Metre(999, 1).ticks(), 999 * Metre::RESOLUTION);
+    EXPECT_EQ(Metre(999 * 960, 960) * fraction(1, 2), Metre(999, 2));
+    EXPECT_GT(Metre::infinite() + Metre(1, 1), Metre(1000, 1));
+}
+
+TEST(Metre, rounded)
+{
+    // truncating would give 0 for all of these
+    EXPECT_EQ((Metre::fromTicks(2) * fraction(1, 3)).ticks(), 1);
+    EXPECT_EQ((Metre::fromTicks(-2) * fraction(1, 3)).ticks(), -1);
+    EXPECT_EQ((Metre::fromTicks(1) * fraction(1, 2)).ticks(), 1);
+    EXPECT_EQ(Metre(2, 3 * Metre::RESOLUTION).ticks(), 1);
+    EXPECT_EQ((Metre::fromTicks(1) * fraction(1, 3)).ticks(), 0);
+    EXPECT_EQ(Metre(1, 3 * Metre::RESOLUTION).ticks(), 0);
+}
@@ -0,0 +1,54 @@
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include <common/spsc_ring.h>
+
+TEST(SpscRing, PopsInOrderAndRejectsWhenFull)
+{
+    lunaticvibes::SpscRing<int, 4> q;
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(q.tryPush(i));
+    EXPECT_FALSE(q.tryPush(4));
+    EXPECT_EQ(q.size(), 4u);
+
+    int v = -1;
+    EXPECT_TRUE(q.tryPop(v));
+    EXPECT_EQ(v, 0);
+    EXPECT_TRUE(q.tryPush(4));
+    for (int i = 1; i <= 4; ++i)
+    {
+        EXPECT_TRUE(q.tryPop(v));
+        EXPECT_EQ(v, i);
+    }
+    EXPECT_FALSE(q.tryPop(v));
+    EXPECT_EQ(q.size(), 0u);
+}
+
+TEST(SpscRing, ConcurrentProducerConsumer)
+{
+    lunaticvibes::SpscRing<int, 64> q;
+    static constexpr int COUNT = 200000;
+
+    std::thread producer([&] {
+        for (int i = 0; i < COUNT; ++i)
+            while (!q.tryPush(i))
+                std::this_thread::yield();
+    });
+
+    std::vector<int> received;
+    received.reserve(COUNT);
+    int v = 0;
+    while (received.size() < static_cast<size_t>(COUNT))
+    {
+        if (q.tryPop(v))
+            received.push_back(v);
+        else
+            std::this_thread::yield();
+    }
+    producer.join();
+
+    for (int i = 0; i < COUNT; ++i)
+        ASSERT_EQ(received[i], i);
+}
@@ -0,0 +1,144 @@
+#include <filesystem>
+
+#include <gmock/gmock.h>
+#include <sqlite3.h>
+
+#include <db/db_conn.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+class TestDB : public SQLite
+{
+public:
+    TestDB(const char* path = ":memory:") : SQLite(path, "TEST") {}
+    using SQLite::enableReadPool;
+    using SQLite::exec;
+    using SQLite::execAs;
+    using SQLite::query;
+    using SQLite::queryAs;
+    using SQLite::queryRead;
+    using SQLite::queryReadAs;
+};
+
+} // namespace
+
+TEST(SQLite, TypedQueryRoundTrip)
+{
+    TestDB db;
+    ASSERT_EQ(db.execAs("CREATE TABLE t(name TEXT, count INTEGER, rate REAL)"), SQLITE_OK);
+    ASSERT_EQ(db.execAs("INSERT INTO t VALUES(?,?,?)", std::string("a"), 1, 0.5), SQLITE_OK);
+    ASSERT_EQ(db.execAs("INSERT INTO t VALUES(?,?,?)", "b", 2LL, 1.5), SQLITE_OK);
+    ASSERT_EQ(db.execAs("INSERT INTO t VALUES(?,?,?)", nullptr, 3, 2.5), SQLITE_OK);
+
+    auto rows = db.queryAs<std::string, long long, double>("SELECT name,count,rate FROM t ORDER BY count");
+    ASSERT_EQ(rows.size(), 3u);
+    EXPECT_EQ(rows[0], std::make_tuple(std::string("a"), 1LL, 0.5));
+    EXPECT_EQ(rows[1], std::make_tuple(std::string("b"), 2LL, 1.5));
+    // NULL reads as empty
+    EXPECT_EQ(std::get<0>(rows[2]), "");
+
+    auto filtered = db.queryAs<int>("SELECT count FROM t WHERE name=?", std::string_view("b"));
+    ASSERT_EQ(filtered.size(), 1u);
+    EXPECT_EQ(std::get<0>(filtered[0]), 2);
+}
+
+TEST(SQLite, CachedStatementIsReusedWithFreshBindings)
+{
+    TestDB db;
+    ASSERT_EQ(db.exec("CREATE TABLE t(v INTEGER)"), SQLITE_OK);
+    for (int i = 0; i < 10; ++i)
+        ASSERT_EQ(db.exec("INSERT INTO t VALUES(?)", { i }), SQLITE_OK);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        auto rows = db.query("SELECT v FROM t WHERE v=?", { i });
+        ASSERT_EQ(rows.size(), 1u);
+        EXPECT_EQ(ANY_INT(rows[0][0]), i);
+    }
+
+    // Statement is reset after use, so the next query starts from the first row again.
+    EXPECT_EQ(db.queryAs<long long>("SELECT v FROM t ORDER BY v").size(), 10u);
+    EXPECT_EQ(db.queryAs<long long>("SELECT v FROM t ORDER BY v").size(), 10u);
+}
+
+TEST(SQLite, StatementCacheEvictsLeastRecentlyUsed)
+{
+    sqlite3* db = nullptr;
+    ASSERT_EQ(sqlite3_open(":memory:", &db), SQLITE_OK);
+    auto prepare = [db](const std::string& sql) {
+        sqlite3_stmt* stmt = nullptr;
+        sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
+        return stmt;
+    };
+    auto liveStatements = [db] {
+        int n = 0;
+        for (sqlite3_stmt* s = sqlite3_next_stmt(db, nullptr); s; s = sqlite3_next_stmt(db, s))
+            ++n;
+        return n;
+    };
+
+    {
+        SQLiteStatementCache cache(2);
+        cache.put("SELECT 1", prepare("SELECT 1"));
+        cache.put("SELECT 2", prepare("SELECT 2"));
+        cache.put("SELECT 2", prepare("SELECT 2"));
+
+        // touch SELECT 1 so SELECT 2 is the oldest
+        sqlite3_stmt* one = cache.take("SELECT 1");
+        ASSERT_NE(one, nullptr);
+        EXPECT_EQ(cache.take("SELECT 1"), nullptr);
+        cache.put("SELECT 1", one);
+
+        cache.put("SELECT 3", prepare("SELECT 3"));
+        EXPECT_EQ(cache.size(), 2u);
+        EXPECT_EQ(liveStatements(), 2);
+        EXPECT_EQ(cache.take("SELECT 2"), nullptr);
+
+        // dynamic SQL stays within the bound
+        for (int i = 0; i < 100; ++i)
+        {
+            std::string sql = "SELECT " + std::to_string(100 + i);
+            cache.put(sql, prepare(sql));
+        }
+        EXPECT_EQ(cache.size(), 2u);
+        EXPECT_EQ(liveStatements(), 2);
+    }
+    EXPECT_EQ(liveStatements(), 0);
+    sqlite3_close(db);
+}
+
+TEST(SQLite, ReadPoolSeesCommittedDataOnly)
+{
+    const char* path = "test_read_pool.db";
+    {
+        TestDB db(path);
+        ASSERT_TRUE(db.enableReadPool(2));
+        ASSERT_EQ(db.exec("CREATE TABLE t(v INTEGER)"), SQLITE_OK);
+        ASSERT_EQ(db.exec("INSERT INTO t VALUES(1)"), SQLITE_OK);
+
+        db.transactionStart();
+        ASSERT_EQ(db.exec("INSERT INTO t VALUES(2)"), SQLITE_OK);
+        // the writer sees its own transaction, readers don't wait for it
+        EXPECT_EQ(db.queryAs<long long>("SELECT v FROM t").size(), 2u);
+        EXPECT_EQ(db.queryReadAs<long long>("SELECT v FROM t").size(), 1u);
+        EXPECT_EQ(db.queryRead("SELECT v FROM t").size(), 1u);
+        db.transactionStop();
+
+        EXPECT_EQ(db.queryReadAs<long long>("SELECT v FROM t").size(), 2u);
+    }
+    fs::remove(path);
+    fs::remove(std::string(path) + "-wal");
+    fs::remove(std::string(path) + "-shm");
+}
+
+TEST(SQLite, ReadPoolUnavailableInMemory)
+{
+    TestDB db;
+    EXPECT_FALSE(db.enableReadPool(2));
+    ASSERT_EQ(db.exec("CREATE TABLE t(v INTEGER)"), SQLITE_OK);
+    ASSERT_EQ(db.exec("INSERT INTO t VALUES(1)"), SQLITE_OK);
+    // falls back to the main connection
+    EXPECT_EQ(db.queryReadAs<long long>("SELECT v FROM t").size(), 1u);
+}
@@ -0,0 +1,172 @@
+#include <chrono>
+#include <fstream>
+#include <string>
+
+#include <gmock/gmock.h>
+
+#include <db/db_song.h>
+
+class SongDBTest : public SongDB
+{
+public:
+    using SongDB::SongDB;
+    using SongDB::exec;
+    using SongDB::ftsAvailable;
+    using SongDB::queryAs;
+    using SongDB::backgroundScan;
+    using SongDB::cacheBuild;
+    using SongDB::folderRefresh;
+};
+
+class tSongDB : public ::testing::Test
+{
+protected:
+    Path dir;
+    Path songs;
+
+    void SetUp() override
+    {
+        // folder paths are stored relative to the executable when inside it
+        if (executablePath.empty())
+            executablePath = GetExecutablePath();
+
+        dir = fs::temp_directory_path() / "lv_test_songdb";
+        fs::remove_all(dir);
+        songs = dir / "songs";
+        fs::create_directories(songs);
+    }
+    void TearDown() override
+    {
+        fs::remove_all(dir);
+    }
+
+    Path writeChart(const std::string& folder, const std::string& title, const std::string& artist)
+    {
+        fs::create_directories(songs / folder);
+        Path p = songs / folder / (folder + ".bms");
+        std::ofstream ofs(p, std::ios::binary);
+        ofs << "#PLAYER 1\n#GENRE Test\n#TITLE " << title << "\n#ARTIST " << artist << "\n"
+            << "#BPM 120\n#PLAYLEVEL 5\n#RANK 2\n#TOTAL 200\n#WAV01 a.wav\n#00111:01010101\n";
+        return p;
+    }
+};
+
+TEST_F(tSongDB, TouchedChartIsHashedOnce)
+{
+    Path chart = writeChart("song1", "Lunatic Vibes", "Alpha");
+
+    SongDBTest db(dir / "song.db");
+    db.initializeFolders({ songs });
+    ASSERT_EQ(db.addChartSuccess, 1);
+
+    // touched only: hashed once, then the new signature is stored
+    fs::last_write_time(chart, fs::last_write_time(chart) + std::chrono::seconds(10));
+    db.refreshFolders({ songs / "song1" });
+    EXPECT_EQ(db.addChartHashed, 1);
+    EXPECT_EQ(db.addChartModified, 0);
+    db.refreshFolders({ songs / "song1" });
+    EXPECT_EQ(db.addChartHashed, 0);
+
+    // rows migrated from before signatures were stored
+    ASSERT_EQ(SQLITE_OK, db.exec("UPDATE song SET filesize=0,filemtime=0,fileino=0"));
+    db.refreshFolders({ songs / "song1" });
+    EXPECT_EQ(db.addChartHashed, 1);
+    db.refreshFolders({ songs / "song1" });
+    EXPECT_EQ(db.addChartHashed, 0);
+    db.prepareCache();
+    EXPECT_EQ(db.findChartByHash(md5file(chart)).size(), 1u);
+}
+
+TEST_F(tSongDB, ScanAfterStop)
+{
+    writeChart("song1", "Lunatic Vibes", "Alpha");
+
+    SongDB db(dir / "song.db");
+    db.stopLoading();
+    db.initializeFolders({ songs });
+    EXPECT_EQ(db.addChartSuccess, 1);
+}
+
+TEST_F(tSongDB, StopWhileScanIsQueued)
+{
+    writeChart("song1", "Lunatic Vibes", "Alpha");
+
+    SongDBTest db(dir / "song.db");
+    {
+        // the scan waits for the mutex, as behind a watcher refresh
+        std::unique_lock l(db.scanMutex);
+        db.initializeFoldersAsync({ songs });
+        db.stopLoading();
+    }
+    db.backgroundScan.wait();
+    EXPECT_EQ(db.addChartSuccess, 0);
+    EXPECT_TRUE(db.queryAs<long long>("SELECT 1 FROM song").empty());
+
+    // later requests are not affected
+    db.initializeFolders({ songs });
+    EXPECT_EQ(db.addChartSuccess, 1);
+}
+
+TEST_F(tSongDB, PrepareCacheAsync)
+{
+    Path chart = writeChart("song1", "Lunatic Vibes", "Alpha");
+
+    SongDBTest db(dir / "song.db");
+    db.initializeFolders({ songs });
+    db.libraryGeneration++;
+    EXPECT_TRUE(db.findChartByHash(md5file(chart)).empty());
+
+    db.prepareCacheAsync();
+    db.cacheBuild.wait();
+    EXPECT_EQ(db.cacheGeneration, db.libraryGeneration);
+    EXPECT_EQ(db.findChartByHash(md5file(chart)).size(), 1u);
+}
+
+TEST_F(tSongDB, RefreshSubFolderAsync)
+{
+    writeChart("song1", "Lunatic Vibes", "Alpha");
+
+    SongDBTest db(dir / "song.db");
+    db.initializeFolders({ songs });
+    Path chart = writeChart("song2", "Lunatic Vibes 2", "Beta");
+
+    int added = -1;
+    {
+        // one refresh at a time; the running one waits for the mutex
+        std::unique_lock l(db.scanMutex);
+        EXPECT_TRUE(db.refreshSubFolderAsync(songs, ROOT_FOLDER_HASH, [&] { added = db.addChartSuccess; }));
+        EXPECT_FALSE(db.refreshSubFolderAsync(songs, ROOT_FOLDER_HASH, nullptr));
+    }
+    db.folderRefresh.wait();
+    EXPECT_EQ(added, 1);
+    EXPECT_EQ(db.findChartByHash(md5file(chart)).size(), 1u);
+}
+
+TEST_F(tSongDB, FindChartByName)
+{
+    writeChart("song1", "Lunatic Vibes", "Alpha");
+    writeChart("song2", "Another Song", "Beta");
+
+    SongDBTest db(dir / "song.db");
+    db.initializeFolders({ songs });
+    ASSERT_EQ(db.addChartSuccess, 2);
+
+    // shorter than a trigram, LIKE fallback
+    auto r = db.findChartByName(ROOT_FOLDER_HASH, "ta");
+    ASSERT_EQ(r.size(), 1u);
+    EXPECT_EQ(r[0]->artist, "Beta");
+    EXPECT_EQ(db.findChartByName(ROOT_FOLDER_HASH, "So").size(), 1u);
+    EXPECT_EQ(db.findChartByName(ROOT_FOLDER_HASH, "s").size(), 2u);
+
+    if (!db.ftsAvailable)
+        GTEST_SKIP() << "sqlite built without the FTS5 trigram tokenizer";
+
+    // trigram index, case insensitive
+    r = db.findChartByName(ROOT_FOLDER_HASH, "vibes");
+    ASSERT_EQ(r.size(), 1u);
+    EXPECT_EQ(r[0]->title, "Lunatic Vibes");
+    r = db.findChartByName(ROOT_FOLDER_HASH, "alph");
+    ASSERT_EQ(r.size(), 1u);
+    EXPECT_EQ(r[0]->artist, "Alpha");
+    EXPECT_TRUE(db.findChartByName(ROOT_FOLDER_HASH, "gamma").empty());
+}
@@ -0,0 +1,155 @@
+#include <fstream>
+
+#include <gmock/gmock.h>
+
+#include <db/db_song_catalog.h>
+
+TEST(SongCatalog, InternDeduplicates)
+{
+    SongCatalog c;
+    auto a = c.intern("artist");
+    auto b = c.intern("title");
+    EXPECT_NE(a, b);
+    EXPECT_EQ(c.intern("artist"), a);
+    EXPECT_EQ(c.intern(""), 0u);
+    EXPECT_EQ(c.str(a), "artist");
+    EXPECT_EQ(c.str(b), "title");
+    EXPECT_EQ(c.str(0), "");
+}
+
+TEST(SongCatalog, LookupByHashAndParent)
+{
+    const HashMD5 folderA = md5("a"), folderB = md5("b");
+    const HashMD5 chart1 = md5("1"), chart2 = md5("2");
+
+    SongCatalog c;
+    auto& s = c.songColumns();
+    auto addSong = [&](const HashMD5& hash, const HashMD5& parent, std::string_view file)
+    {
+        s.md5.push_back(hash);
+        s.parent.push_back(parent);
+        s.file.push_back(c.intern(file));
+    };
+    addSong(chart1, folderA, "x.bms");
+    addSong(chart2, folderB, "y.bms");
+    addSong(chart1, folderB, "z.bms");
+    c.finalize();
+
+    auto byHash = c.findSongsByHash(chart1);
+    ASSERT_EQ(byHash.size(), 2u);
+    // table order is kept within equal keys
+    EXPECT_EQ(c.str(s.file[byHash.begin()[0]]), "x.bms");
+    EXPECT_EQ(c.str(s.file[byHash.begin()[1]]), "z.bms");
+
+    auto byParent = c.findSongsByParent(folderB);
+    ASSERT_EQ(byParent.size(), 2u);
+    EXPECT_EQ(c.str(s.file[byParent.begin()[0]]), "y.bms");
+    EXPECT_EQ(c.str(s.file[byParent.begin()[1]]), "z.bms");
+
+    EXPECT_TRUE(c.findSongsByHash(md5("3")).empty());
+    EXPECT_TRUE(c.findFoldersByParent(folderA).empty());
+}
+
+static void addFullSong(SongCatalog& c, const HashMD5& hash, const HashMD5& parent, std::string_view title)
+{
+    auto& s = c.songColumns();
+    s.md5.push_back(hash);
+    s.parent.push_back(parent);
+    s.file.push_back(c.intern(std::string(title) + ".bms"));
+    s.type.push_back(0);
+    s.title.push_back(c.intern(title));
+    for (auto* col : { &s.title2, &s.artist, &s.artist2, &s.genre, &s.version, &s.stagefile, &s.bannerfile })
+        col->push_back(0);
+    for (auto* col : { &s.level, &s.bpm, &s.minbpm, &s.maxbpm })
+        col->push_back(150.0);
+    for (auto* col : { &s.length, &s.totalnotes, &s.gamemode, &s.judgerank, &s.total, &s.playlevel, &s.difficulty })
+        col->push_back(7);
+    s.flags.push_back(SongCatalog::SONG_LN);
+    s.addtime.push_back(1234567890123LL);
+}
+
+TEST(SongCatalog, SnapshotRoundTrip)
+{
+    const Path file = "test_song_catalog.snapshot";
+    const HashMD5 folder = md5("folder");
+    const SongCatalog::SnapshotKey key{ 42, 7 };
+
+    {
+        SongCatalog c;
+        addFullSong(c, md5("1"), folder, "one");
+        addFullSong(c, md5("2"), folder, "two");
+        auto& f = c.folderColumns();
+        f.pathmd5.push_back(folder);
+        f.parent.push_back(HashMD5());
+        f.name.push_back(c.intern("folder"));
+        f.type.push_back(1);
+        f.path.push_back(c.intern("/songs/folder"));
+        f.modtime.push_back(99);
+        c.finalize();
+        ASSERT_TRUE(c.saveSnapshot(file, key));
+    }
+
+    {
+        auto c = SongCatalog::loadSnapshot(file, key);
+        ASSERT_NE(c, nullptr);
+        EXPECT_EQ(c->songCount(), 2u);
+        EXPECT_EQ(c->folderCount(), 1u);
+
+        auto rows = c->findSongsByHash(md5("2"));
+        ASSERT_EQ(rows.size(), 1u);
+        const auto row = *rows.begin();
+        EXPECT_EQ(c->str(c->songs().title[row]), "two");
+        EXPECT_EQ(c->str(c->songs().file[row]), "two.bms");
+        EXPECT_EQ(c->songs().flags[row], SongCatalog::SONG_LN);
+        EXPECT_EQ(c->songs().addtime[row], 1234567890123LL);
+        EXPECT_EQ(c->findSongsByParent(folder).size(), 2u);
+
+        auto folders = c->findFoldersByHash(folder);
+        ASSERT_EQ(folders.size(), 1u);
+        EXPECT_EQ(c->str(c->folders().path[*folders.begin()]), "/songs/folder");
+    }
+
+    // stale after the DB changed
+    EXPECT_EQ(SongCatalog::loadSnapshot(file, { 42, 8 }), nullptr);
+    EXPECT_EQ(SongCatalog::loadSnapshot(file, { 43, 7 }), nullptr);
+
+    fs::remove(file);
+}
+
+TEST(SongCatalog, SnapshotWithBadIdsIsRejected)
+{
+    const Path file = "test_song_catalog_bad.snapshot";
+    const HashMD5 folder = md5("folder");
+    const SongCatalog::SnapshotKey key{ 42, 7 };
+
+    auto save = [&](SongCatalog::StrId name) {
+        SongCatalog c;
+        addFullSong(c, md5("1"), folder, "one");
+        auto& f = c.folderColumns();
+        f.pathmd5.push_back(folder);
+        f.parent.push_back(HashMD5());
+        f.name.push_back(name);
+        f.type.push_back(1);
+        f.path.push_back(c.intern("/songs/folder"));
+        f.modtime.push_back(99);
+        c.finalize();
+        return c.saveSnapshot(file, key);
+    };
+
+    // string id past the pool
+    ASSERT_TRUE(save(1000000));
+    EXPECT_EQ(SongCatalog::loadSnapshot(file, key), nullptr);
+
+    // row index past the row count; the folder-by-parent index is the last section
+    ASSERT_TRUE(save(0));
+    ASSERT_NE(SongCatalog::loadSnapshot(file, key), nullptr);
+    {
+        std::fstream fsm(file, std::ios::binary | std::ios::in | std::ios::out);
+        fsm.seekp(-static_cast<std::streamoff>(sizeof(SongCatalog::Row)), std::ios::end);
+        const SongCatalog::Row bad = 5;
+        fsm.write(reinterpret_cast<const char*>(&bad), sizeof(bad));
+    }
+    EXPECT_EQ(SongCatalog::loadSnapshot(file, key), nullptr);
+
+    fs::remove(file);
+}
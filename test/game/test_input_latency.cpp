@@ -0,0 +1,77 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <gmock/gmock.h>
+
+#include "game/runtime/input_latency.h"
+
+TEST(InputLatency, Summary)
+{
+    using Stage = InputLatency::Stage;
+    InputLatency::reset();
+    EXPECT_EQ(InputLatency::summary(Stage::JUDGE).count, 0u);
+
+    // 99 presses at 0.25ms, one at 3ms
+    for (int i = 0; i < 99; ++i)
+        InputLatency::record(Stage::JUDGE, 250'000);
+    InputLatency::record(Stage::JUDGE, 3'000'000);
+
+    auto s = InputLatency::summary(Stage::JUDGE);
+    EXPECT_EQ(s.count, 100u);
+    EXPECT_EQ(s.avgNs, (99 * 250'000LL + 3'000'000LL) / 100);
+    EXPECT_EQ(s.p50Ns, 300'000);
+    EXPECT_EQ(s.p99Ns, 300'000);
+    EXPECT_EQ(s.maxNs, 3'000'000);
+    EXPECT_EQ(InputLatency::summary(Stage::KEYSOUND).count, 0u);
+
+    // beyond the last bucket
+    InputLatency::record(Stage::KEYSOUND, 80'000'000);
+    EXPECT_EQ(InputLatency::summary(Stage::KEYSOUND).p50Ns, 80'000'000);
+
+    InputLatency::reset();
+    EXPECT_EQ(InputLatency::summary(Stage::JUDGE).count, 0u);
+}
+
+TEST(InputLatency, PresentKeepsEarliestPress)
+{
+    using Stage = InputLatency::Stage;
+    InputLatency::reset();
+
+    lunaticvibes::Time now;
+    InputLatency::pressHandled(now - lunaticvibes::Time(2));
+    InputLatency::pressHandled(now - lunaticvibes::Time(1));
+    InputLatency::framePresented();
+    InputLatency::framePresented();
+
+    auto s = InputLatency::summary(Stage::PRESENT);
+    EXPECT_EQ(s.count, 1u);
+    EXPECT_GE(s.maxNs, 2'000'000);
+    InputLatency::reset();
+}
+
+TEST(InputLatency, DumpCSV)
+{
+    using Stage = InputLatency::Stage;
+    InputLatency::reset();
+    InputLatency::record(Stage::INPUT, 150'000);
+    InputLatency::record(Stage::INPUT, 199'999);
+    InputLatency::record(Stage::JUDGE, 1'000'000'000);
+
+    Path path = std::filesystem::temp_directory_path() / "lv_input_latency.csv";
+    ASSERT_TRUE(InputLatency::dumpCSV(path));
+
+    std::ifstream ifs(path);
+    std::string line;
+    std::getline(ifs, line);
+    EXPECT_EQ(line, "stage,from_us,to_us,count");
+    std::getline(ifs, line);
+    EXPECT_EQ(line, "Input,100,200,2");
+    std::getline(ifs, line);
+    EXPECT_EQ(line, "Judge,49900,,1");
+    EXPECT_FALSE(std::getline(ifs, line));
+
+    ifs.close();
+    std::filesystem::remove(path);
+    InputLatency::reset();
+}
@@ -0,0 +1,66 @@
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include "game/input/input_wrapper.h"
+
+class InputWrapperTest : public InputWrapper
+{
+public:
+    using InputWrapper::InputWrapper;
+    using InputWrapper::QueuedEvent;
+    using InputWrapper::_pushEvent;
+    using InputWrapper::_pollEvents;
+#ifdef __linux__
+    using InputWrapper::_evdevEvents;
+#endif
+};
+
+#ifdef __linux__
+TEST(InputWrapper, DispatchQueuedInDetectionOrder)
+{
+    using Type = InputWrapperTest::QueuedEvent::Type;
+    using lunaticvibes::Time;
+
+    InputWrapperTest input;
+    input.setQueuedDispatch();
+
+    std::vector<std::string> dispatched;
+    auto record = [&](char type)
+    {
+        return [&dispatched, type](InputMask& m, const Time& t)
+        {
+            dispatched.push_back(type + std::to_string(m.to_ulong()) + "@" + std::to_string(t.norm()));
+        };
+    };
+    input.register_p("p", record('P'));
+    input.register_h("h", record('H'));
+    input.register_r("r", record('R'));
+
+    const InputMask a = 1 << Input::K11, b = 1 << Input::K12, c = 1 << Input::K13, d = 1 << Input::K14;
+
+    // tick 10: polled press; the evdev thread sends a press with its older kernel time
+    input._pushEvent(input._pollEvents, { Type::PRESS, a, { 0., 0. }, Time(10), Time(10) }, a);
+    input._pushEvent(input._evdevEvents, { Type::PRESS, b, { 0., 0. }, Time(9), Time(11) }, b);
+    // tick 20: evdev release with its kernel time goes before the hold; a press detected before the tick
+    // but pushed after it is kept behind
+    input._pushEvent(input._evdevEvents, { Type::RELEASE, c, { 0., 0. }, Time(12), Time(20) }, b | c);
+    input._pushEvent(input._evdevEvents, { Type::HOLD, b, { 0., 0. }, Time(20), Time(20) }, b | c);
+    input._pushEvent(input._evdevEvents, { Type::PRESS, d, { 0., 0. }, Time(15), Time(15) }, b | d);
+    input._pushEvent(input._pollEvents, { Type::HOLD, a, { 0., 0. }, Time(20), Time(20) }, a);
+    // tick 30
+    input._pushEvent(input._pollEvents, { Type::RELEASE, a, { 0., 0. }, Time(30), Time(30) }, a);
+
+    input.dispatchQueued();
+
+    auto s = [](char type, const InputMask& m, int t) { return type + std::to_string(m.to_ulong()) + "@" + std::to_string(t); };
+    EXPECT_THAT(dispatched, ::testing::ElementsAre(
+        s('P', a, 10),
+        s('P', b, 9),
+        s('R', c, 12),
+        s('H', a | b, 20),  // holds of both queues for one tick go out as one mask
+        s('P', d, 15),
+        s('R', a, 30)));
+}
+#endif
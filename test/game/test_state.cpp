@@ -0,0 +1,121 @@
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <game/runtime/state.h>
+
+TEST(State, TextSetGet)
+{
+    EXPECT_TRUE(State::set(IndexText::PLAYER_NAME, "abc"));
+    EXPECT_EQ(State::get(IndexText::PLAYER_NAME), "abc");
+    EXPECT_TRUE(State::set(IndexText::PLAYER_NAME, ""));
+    EXPECT_EQ(State::get(IndexText::PLAYER_NAME), "");
+    EXPECT_FALSE(State::set(IndexText::TEXT_COUNT, "abc"));
+    EXPECT_EQ(State::get(IndexText::TEXT_COUNT), "");
+}
+
+TEST(State, TextConcurrentReadWrite)
+{
+    // Readers must only ever see one of the whole values written.
+    const std::string a(64, 'a');
+    const std::string b(64, 'b');
+    std::atomic<bool> stop{ false };
+    std::atomic<int> torn{ 0 };
+
+    std::thread reader([&]() {
+        while (!stop)
+        {
+            auto s = State::get(IndexText::PLAY_FULLTITLE);
+            if (!s.empty() && s != a && s != b)
+                ++torn;
+        }
+    });
+    for (int i = 0; i < 100000; ++i)
+        State::set(IndexText::PLAY_FULLTITLE, (i & 1) ? a : b);
+    stop = true;
+    reader.join();
+
+    EXPECT_EQ(torn, 0);
+    EXPECT_EQ(State::get(IndexText::PLAY_FULLTITLE), a);
+}
+
+TEST(State, NumberConcurrentReadWrite)
+{
+    std::atomic<bool> stop{ false };
+    std::atomic<int> backwards{ 0 };
+
+    std::thread reader([&]() {
+        int last = 0;
+        while (!stop)
+        {
+            int n = State::get(IndexNumber::PLAY_1P_SCORE);
+            if (n < last)
+                ++backwards;
+            last = n;
+        }
+    });
+    for (int i = 0; i <= 100000; ++i)
+        State::set(IndexNumber::PLAY_1P_SCORE, i);
+    stop = true;
+    reader.join();
+
+    EXPECT_EQ(backwards, 0);
+    EXPECT_EQ(State::get(IndexNumber::PLAY_1P_SCORE), 100000);
+}
+
+TEST(State, BatchPublishesOnCommit)
+{
+    State::set(IndexNumber::PLAY_1P_EXSCORE, 0);
+    State::set(IndexNumber::PLAY_1P_RATE, 0);
+    {
+        State::Batch batch;
+        batch.set(IndexNumber::PLAY_1P_EXSCORE, 10);
+        {
+            // joins the outer batch
+            State::Batch inner;
+            inner.set(IndexNumber::PLAY_1P_RATE, 50);
+        }
+        EXPECT_EQ(State::get(IndexNumber::PLAY_1P_EXSCORE), 0);
+        EXPECT_EQ(State::get(IndexNumber::PLAY_1P_RATE), 0);
+    }
+    EXPECT_EQ(State::get(IndexNumber::PLAY_1P_EXSCORE), 10);
+    EXPECT_EQ(State::get(IndexNumber::PLAY_1P_RATE), 50);
+}
+
+TEST(State, SnapshotSeesWholeBatches)
+{
+    std::atomic<bool> stop{ false };
+    std::atomic<int> torn{ 0 };
+
+    std::thread reader([&]() {
+        while (!stop)
+        {
+            State::SnapshotScope snapshot;
+            int exscore = State::get(IndexNumber::PLAY_1P_EXSCORE);
+            int rate = State::get(IndexNumber::PLAY_1P_RATE);
+            if (rate != exscore * 2)
+                ++torn;
+        }
+    });
+    for (int i = 0; i < 100000; ++i)
+    {
+        State::Batch batch;
+        batch.set(IndexNumber::PLAY_1P_EXSCORE, i);
+        batch.set(IndexNumber::PLAY_1P_RATE, i * 2);
+    }
+    stop = true;
+    reader.join();
+
+    EXPECT_EQ(torn, 0);
+}
+
+TEST(State, SnapshotReadsOwnWrites)
+{
+    State::set(IndexNumber::PLAY_1P_SCORE, 1);
+    State::SnapshotScope snapshot;
+    EXPECT_EQ(State::get(IndexNumber::PLAY_1P_SCORE), 1);
+    State::set(IndexNumber::PLAY_1P_SCORE, 2);
+    EXPECT_EQ(State::get(IndexNumber::PLAY_1P_SCORE), 2);
+}